@@ -10,9 +10,13 @@
 namespace taco {
 
 enum ModeType {
-  Dense,   // e.g. first  mode in CSR
-  Sparse,  // e.g. second mode in CSR
-  Fixed    // e.g. second mode in ELL
+  Dense,     // e.g. first  mode in CSR
+  Sparse,    // e.g. second mode in CSR
+  Fixed,     // e.g. second mode in ELL
+  Singleton, // e.g. second mode in COO
+  Hashed,    // e.g. second mode of a result assembled in any order
+  Bitmap,    // e.g. second mode of a matrix with medium density rows
+  Diagonal   // e.g. second mode in DIA
 };
 
 class Format {
@@ -46,6 +50,11 @@ public:
   /// position i is specifed by element i of the returned vector.
   const std::vector<size_t>& getModeOrdering() const;
 
+  /// Returns true if the coordinates of a level are unique within each of its
+  /// segments. A level is not unique if it is followed by a singleton level,
+  /// e.g. the first level of COO stores the row of every nonzero.
+  bool isUnique(size_t level) const;
+
   /// Gets the types of the coordinate arrays for each level
   const std::vector<std::vector<DataType>>& getLevelArrayTypes() const;
 
@@ -58,10 +67,19 @@ public:
   /// Sets the types of the coordinate arrays for each level
   void setLevelArrayTypes(std::vector<std::vector<DataType>> levelArrayTypes);
 
+  /// Gets the number of coordinates stored in each segment of fixed or diagonal
+  /// level i, or 0 if it is not known because the level has not been packed
+  size_t getFixedSize(int level) const;
+
+  /// Sets the number of coordinates stored in each segment of each level, which
+  /// is only used for fixed and diagonal levels
+  void setFixedSizes(std::vector<size_t> fixedSizes);
+
 private:
   std::vector<ModeType> modeTypes;
   std::vector<size_t>   modeOrdering;
   std::vector<std::vector<DataType>> levelArrayTypes;
+  std::vector<size_t>   fixedSizes;
 };
 
 bool operator==(const Format&, const Format&);
@@ -77,6 +95,10 @@ extern const Format CSC;
 extern const Format DCSR;
 extern const Format DCSC;
 
+/// Blocked CSR: a CSR matrix of dense blocks, stored as an order-4 tensor whose
+/// modes are block row, block column, row in block and column in block.
+extern const Format BCSR;
+
 /// True if all modes are Dense
 bool isDense(const Format&);
 
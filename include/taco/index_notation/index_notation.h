@@ -571,9 +571,17 @@ public:
   /// Set the name of the tensor variable.
   void setName(std::string name);
 
+  /// Set the format of the tensor variable, e.g. to change its index array
+  /// types before the expressions that use it are compiled.
+  void setFormat(const Format& format);
+
   /// Set the index assignment statement that computes the tensor's values.
   void setAssignment(Assignment assignment);
 
+  /// Set the schedule of the tensor var, which describes how to compile and
+  /// execute it's expression.
+  void setSchedule(const Schedule& schedule);
+
   bool defined() const;
 
   /// Create an index expression that accesses (reads) this tensor.
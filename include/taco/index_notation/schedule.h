@@ -1,6 +1,7 @@
 #ifndef TACO_SCHEDULE_H
 #define TACO_SCHEDULE_H
 
+#include <map>
 #include <memory>
 #include <vector>
 
@@ -28,6 +29,27 @@ private:
 std::ostream& operator<<(std::ostream&, const OperatorSplit&);
 
 
+/// A split of the loop over an index variable into a loop over blocks of
+/// `factor` iterations (outer) around a loop over the iterations of each block
+/// (inner). The inner loop iterates over the coordinates of the split variable.
+class IndexVarSplit {
+public:
+  IndexVarSplit(IndexVar var, IndexVar outer, IndexVar inner, size_t factor);
+
+  IndexVar getVar() const;
+  IndexVar getOuter() const;
+  IndexVar getInner() const;
+  size_t getFactor() const;
+
+private:
+  struct Content;
+  std::shared_ptr<Content> content;
+};
+
+/// Print an index variable split.
+std::ostream& operator<<(std::ostream&, const IndexVarSplit&);
+
+
 /// A schedule controls code generation and determines how index expression
 /// should be computed.
 class Schedule {
@@ -46,6 +68,48 @@ public:
   /// Removes operator splits from the schedule.
   void clearOperatorSplits();
 
+  /// Strip-mine the loop over `var` into a loop over blocks of `factor`
+  /// iterations, `outer`, around a loop over the iterations of each block,
+  /// `inner`. Other directives refer to the two loops as `outer` and `inner`.
+  void split(IndexVar var, IndexVar outer, IndexVar inner, size_t factor);
+
+  /// Order the loops over `vars` as listed, outermost first. The operand
+  /// formats must allow the order. The outer loop of a split may be ordered
+  /// above loops that enclose the split loop, which tiles the loop nest, if
+  /// the split variable is free and only indexes dense levels of a dense
+  /// result.
+  void reorder(std::vector<IndexVar> vars);
+
+  /// Order the loops by the estimated cost of iterating over the operands,
+  /// which is derived from their formats and, for operands that have been
+  /// packed, the sizes of their levels. The order is chosen every time an
+  /// expression is compiled with the schedule, without changing the schedule,
+  /// and only if the schedule does not order the loops itself.
+  void autoReorder();
+
+  /// Unroll the loop over `var` by `factor`, followed by a loop over the
+  /// iterations that remain.
+  void unroll(IndexVar var, size_t factor);
+
+  /// Run the loop over `var` in parallel, or serially if `parallel` is false.
+  /// Loops without a directive run in parallel where it is safe and useful.
+  void parallelize(IndexVar var, bool parallel=true);
+
+  /// Returns the index variable splits in the schedule.
+  std::vector<IndexVarSplit> getSplits() const;
+
+  /// Returns the loop order of the schedule, which is empty if unconstrained.
+  std::vector<IndexVar> getLoopOrder() const;
+
+  /// Returns true iff the loop order is chosen by the cost model.
+  bool getAutoReorder() const;
+
+  /// Returns the unroll factors of loops in the schedule.
+  std::map<IndexVar,size_t> getUnrollFactors() const;
+
+  /// Returns the loops the schedule runs in parallel (true) or serially.
+  std::map<IndexVar,bool> getParallelLoops() const;
+
 private:
   struct Content;
   std::shared_ptr<Content> content;
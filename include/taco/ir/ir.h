@@ -29,6 +29,9 @@ enum class IRNodeType {
   Max,
   BitAnd,
   BitOr,
+  Shl,
+  Shr,
+  Popcount,
   Not,
   Eq,
   Neq,
@@ -39,6 +42,7 @@ enum class IRNodeType {
   And,
   Or,
   Cast,
+  Ternary,
   IfThenElse,
   Case,
   Switch,
@@ -51,6 +55,7 @@ enum class IRNodeType {
   Function,
   VarAssign,
   Allocate,
+  Free,
   Comment,
   BlankLine,
   Print,
@@ -340,6 +345,38 @@ public:
   static const IRNodeType _type_info = IRNodeType::BitOr;
 };
 
+/** Left shift: a << b */
+struct Shl : public ExprNode<Shl> {
+public:
+  Expr a;
+  Expr b;
+
+  static Expr make(Expr a, Expr b);
+
+  static const IRNodeType _type_info = IRNodeType::Shl;
+};
+
+/** Right shift: a >> b */
+struct Shr : public ExprNode<Shr> {
+public:
+  Expr a;
+  Expr b;
+
+  static Expr make(Expr a, Expr b);
+
+  static const IRNodeType _type_info = IRNodeType::Shr;
+};
+
+/** The number of set bits in a 64-bit unsigned integer */
+struct Popcount : public ExprNode<Popcount> {
+public:
+  Expr a;
+
+  static Expr make(Expr a);
+
+  static const IRNodeType _type_info = IRNodeType::Popcount;
+};
+
 /** Equality: a==b. */
 struct Eq : public ExprNode<Eq> {
 public:
@@ -438,6 +475,19 @@ public:
   static const IRNodeType _type_info = IRNodeType::Cast;
 };
 
+/** Conditional expression: cond ? a : b. Only the selected operand is
+ * evaluated, so it may guard loads that are out of bounds otherwise. */
+struct Ternary : public ExprNode<Ternary> {
+public:
+  Expr cond;
+  Expr a;
+  Expr b;
+
+  static Expr make(Expr cond, Expr a, Expr b);
+
+  static const IRNodeType _type_info = IRNodeType::Ternary;
+};
+
 /** A load from an array: arr[loc]. */
 struct Load : public ExprNode<Load> {
 public:
@@ -462,24 +512,29 @@ public:
   static const IRNodeType _type_info = IRNodeType::Block;
 };
 
-/** A variable scope. */
+/** A variable scope. A braced scope is emitted as a block of its own, so the
+ * variables it declares may also be declared outside it. */
 struct Scope : public StmtNode<Scope> {
 public:
   Stmt scopedStmt;
+  bool braced;
 
-  static Stmt make(Stmt scopedStmt);
+  static Stmt make(Stmt scopedStmt, bool braced=false);
 
   static const IRNodeType _type_info = IRNodeType::Scope;
 };
 
-/** A store to an array location: arr[loc] = data */
+/** A store to an array location: arr[loc] = data. An atomic store adds to
+ * arr[loc] (data is arr[loc] + x) as one indivisible update, so threads may
+ * store to the same location concurrently. */
 struct Store : public StmtNode<Store> {
 public:
   Expr arr;
   Expr loc;
   Expr data;
+  bool use_atomics;
 
-  static Stmt make(Expr arr, Expr loc, Expr data);
+  static Stmt make(Expr arr, Expr loc, Expr data, bool use_atomics=false);
 
   static const IRNodeType _type_info = IRNodeType::Store;
 };
@@ -528,6 +583,10 @@ enum class LoopKind {Serial, Static, Dynamic, Vectorized};
  * If the loop is vectorized, the width says which vector width
  * to use.  By default (0), it will not set a specific width and
  * let clang determine the width to use.
+ *
+ * A parallel loop may add into the scalars listed in its reductions. Every
+ * thread then adds into a private copy that starts at zero, and the copies
+ * are added into the originals when the loop ends.
  */
 struct For : public StmtNode<For> {
 public:
@@ -538,10 +597,12 @@ public:
   Stmt contents;
   LoopKind kind;
   int vec_width;  // vectorization width
+  std::vector<Expr> reductions;
   
   static Stmt make(Expr var, Expr start, Expr end, Expr increment,
                    Stmt contents, LoopKind kind=LoopKind::Serial,
-                   int vec_width=0);
+                   int vec_width=0,
+                   std::vector<Expr> reductions={});
   
   static const IRNodeType _type_info = IRNodeType::For;
 };
@@ -599,6 +660,16 @@ public:
   static const IRNodeType _type_info = IRNodeType::Allocate;
 };
 
+/** A Free node that releases the memory allocated for a Var */
+struct Free : public StmtNode<Free> {
+public:
+  Expr var;   // must be a Var
+
+  static Stmt make(Expr var);
+
+  static const IRNodeType _type_info = IRNodeType::Free;
+};
+
 /** A comment */
 struct Comment : public StmtNode<Comment> {
 public:
@@ -33,6 +33,9 @@ protected:
   virtual void visit(const Max*);
   virtual void visit(const BitAnd*);
   virtual void visit(const BitOr*);
+  virtual void visit(const Shl*);
+  virtual void visit(const Shr*);
+  virtual void visit(const Popcount*);
   virtual void visit(const Eq*);
   virtual void visit(const Neq*);
   virtual void visit(const Gt*);
@@ -42,6 +45,7 @@ protected:
   virtual void visit(const And*);
   virtual void visit(const Or*);
   virtual void visit(const Cast*);
+  virtual void visit(const Ternary*);
   virtual void visit(const IfThenElse*);
   virtual void visit(const Case*);
   virtual void visit(const Switch*);
@@ -54,6 +58,7 @@ protected:
   virtual void visit(const Function*);
   virtual void visit(const VarAssign*);
   virtual void visit(const Allocate*);
+  virtual void visit(const Free*);
   virtual void visit(const Comment*);
   virtual void visit(const BlankLine*);
   virtual void visit(const Print*);
@@ -74,6 +79,7 @@ protected:
     REM = 5,
     ADD = 6,
     SUB = 6,
+    SHIFT = 7,
     EQ = 10,
     GT = 9,
     LT = 9,
@@ -84,6 +90,7 @@ protected:
     BOR = 11,
     LAND = 14,
     LOR = 15,
+    TERNARY = 16,
     TOP = 20
   };
   Precedence parentPrecedence;
@@ -36,6 +36,9 @@ protected:
   virtual void visit(const Max* op);
   virtual void visit(const BitAnd* op);
   virtual void visit(const BitOr* op);
+  virtual void visit(const Shl* op);
+  virtual void visit(const Shr* op);
+  virtual void visit(const Popcount* op);
   virtual void visit(const Eq* op);
   virtual void visit(const Neq* op);
   virtual void visit(const Gt* op);
@@ -45,6 +48,7 @@ protected:
   virtual void visit(const And* op);
   virtual void visit(const Or* op);
   virtual void visit(const Cast* op);
+  virtual void visit(const Ternary* op);
   virtual void visit(const IfThenElse* op);
   virtual void visit(const Case* op);
   virtual void visit(const Switch* op);
@@ -57,6 +61,7 @@ protected:
   virtual void visit(const Function* op);
   virtual void visit(const VarAssign* op);
   virtual void visit(const Allocate* op);
+  virtual void visit(const Free* op);
   virtual void visit(const Comment* op);
   virtual void visit(const BlankLine* op);
   virtual void visit(const Print* op);
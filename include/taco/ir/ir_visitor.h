@@ -16,6 +16,9 @@ struct Min;
 struct Max;
 struct BitAnd;
 struct BitOr;
+struct Shl;
+struct Shr;
+struct Popcount;
 struct Eq;
 struct Neq;
 struct Gt;
@@ -25,6 +28,7 @@ struct Lte;
 struct And;
 struct Or;
 struct Cast;
+struct Ternary;
 struct IfThenElse;
 struct Case;
 struct Switch;
@@ -37,6 +41,7 @@ struct Scope;
 struct Function;
 struct VarAssign;
 struct Allocate;
+struct Free;
 struct Comment;
 struct BlankLine;
 struct Print;
@@ -59,6 +64,9 @@ public:
   virtual void visit(const Max*) = 0;
   virtual void visit(const BitAnd*) = 0;
   virtual void visit(const BitOr*) = 0;
+  virtual void visit(const Shl*) = 0;
+  virtual void visit(const Shr*) = 0;
+  virtual void visit(const Popcount*) = 0;
   virtual void visit(const Eq*) = 0;
   virtual void visit(const Neq*) = 0;
   virtual void visit(const Gt*) = 0;
@@ -68,6 +76,7 @@ public:
   virtual void visit(const And*) = 0;
   virtual void visit(const Or*) = 0;
   virtual void visit(const Cast*) = 0;
+  virtual void visit(const Ternary*) = 0;
   virtual void visit(const IfThenElse*) = 0;
   virtual void visit(const Case*) = 0;
   virtual void visit(const Switch*) = 0;
@@ -80,6 +89,7 @@ public:
   virtual void visit(const Function*) = 0;
   virtual void visit(const VarAssign*) = 0;
   virtual void visit(const Allocate*) = 0;
+  virtual void visit(const Free*) = 0;
   virtual void visit(const Comment*) = 0;
   virtual void visit(const BlankLine*) = 0;
   virtual void visit(const Print*) = 0;
@@ -105,6 +115,9 @@ public:
   virtual void visit(const Max* op);
   virtual void visit(const BitAnd* op);
   virtual void visit(const BitOr* op);
+  virtual void visit(const Shl* op);
+  virtual void visit(const Shr* op);
+  virtual void visit(const Popcount* op);
   virtual void visit(const Eq* op);
   virtual void visit(const Neq* op);
   virtual void visit(const Gt* op);
@@ -114,6 +127,7 @@ public:
   virtual void visit(const And* op);
   virtual void visit(const Or* op);
   virtual void visit(const Cast* op);
+  virtual void visit(const Ternary* op);
   virtual void visit(const IfThenElse* op);
   virtual void visit(const Case* op);
   virtual void visit(const Switch* op);
@@ -126,6 +140,7 @@ public:
   virtual void visit(const Function* op);
   virtual void visit(const VarAssign* op);
   virtual void visit(const Allocate* op);
+  virtual void visit(const Free* op);
   virtual void visit(const Comment* op);
   virtual void visit(const BlankLine* op);
   virtual void visit(const Print* op);
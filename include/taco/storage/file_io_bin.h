@@ -0,0 +1,34 @@
+/// Read and write the taco binary tensor format, which stores packed tensor
+/// storage so that it can be memory mapped instead of parsed.
+
+#ifndef TACO_FILE_IO_BIN_H
+#define TACO_FILE_IO_BIN_H
+
+#include <istream>
+#include <ostream>
+#include <string>
+
+namespace taco {
+class TensorBase;
+class Format;
+
+/// Read a binary tensor from a file. The file is memory mapped and the
+/// returned tensor's index and value arrays point into the mapping, which is
+/// private to the process and unmapped when the last array is destroyed. The
+/// stored tensor must have the mode types and ordering of `format`. Binary
+/// tensors are always packed, so `pack` is ignored.
+TensorBase readBin(std::string filename, const Format& format, bool pack=true);
+
+/// Read a binary tensor from a stream. Streams cannot be mapped, so the index
+/// and value arrays are read into newly allocated memory.
+TensorBase readBin(std::istream& stream, const Format& format, bool pack=true);
+
+/// Write the packed storage of a tensor to a binary file.
+void writeBin(std::string filename, const TensorBase& tensor);
+
+/// Write the packed storage of a tensor to a binary stream.
+void writeBin(std::ostream& stream, const TensorBase& tensor);
+
+}
+
+#endif
@@ -5,21 +5,40 @@
 #include <ostream>
 #include <string>
 
+#include "taco/tensor.h"
+
 namespace taco {
-class TensorBase;
-class Format;
 
-/// Read an mtx matrix from a file.
-TensorBase readMTX(std::string filename, const Format& format, bool pack=true);
+/// Read an mtx matrix from a file. If `pack` is true, the values of duplicate
+/// coordinates are combined as `policy` says.
+TensorBase readMTX(std::string filename, const Format& format, bool pack=true,
+                   DuplicatePolicy policy=DuplicatePolicy::First);
 
-/// Read an mtx matrix from a stream.
-TensorBase readMTX(std::istream& stream, const Format& format, bool pack=true);
+/// Read an mtx matrix from a stream. If `pack` is true, the values of
+/// duplicate coordinates are combined as `policy` says.
+TensorBase readMTX(std::istream& stream, const Format& format, bool pack=true,
+                   DuplicatePolicy policy=DuplicatePolicy::First);
 
 TensorBase readSparse(std::istream& stream,
                       const Format& format, bool symm = false);
 TensorBase readDense(std::istream& stream,
                      const Format& format, bool symm = false);
 
+/// Returns true if mtx coordinates can be read straight into the format, which
+/// must be {Dense,Sparse} with int index arrays (CSR, or CSC when the modes are
+/// stored transposed).
+bool isCompressedMatrix(const Format& format);
+
+/// Read mtx coordinates directly into the packed storage of a matrix in a
+/// format accepted by `isCompressedMatrix`. The first pass over the stream
+/// counts the entries of each row and the second scatters them into the final
+/// index and value arrays, so peak memory stays close to the size of the
+/// result. The stream must therefore be seekable. The values of duplicate
+/// coordinates are combined as `policy` says.
+TensorBase readSparseCompressed(std::istream& stream,
+                                const Format& format, bool symm = false,
+                                DuplicatePolicy policy=DuplicatePolicy::First);
+
 /// Write an mtx matrix to a file.
 void writeMTX(std::string filename, const TensorBase& tensor);
 
@@ -40,6 +40,10 @@ public:
   /// Returns the index size, which is the number of values it describes.
   size_t getSize() const;
 
+  /// Returns the number of positions in each level of the index, where the
+  /// last level has one position per value.
+  std::vector<size_t> getLevelSizes() const;
+
 private:
   struct Content;
   std::shared_ptr<Content> content;
@@ -0,0 +1,26 @@
+#ifndef TACO_STORAGE_INDEX_DISPATCH_H
+#define TACO_STORAGE_INDEX_DISPATCH_H
+
+#include <cstdint>
+
+#include "taco/type.h"
+#include "taco/error.h"
+
+/// Expands to the statement that follows `T`, with `T` defined as the C++ type
+/// of the integer DataType `type`. Used to select a typed instantiation once
+/// per call instead of switching on the type of every index value.
+#define DISPATCH_INDEX_TYPE(type, T, ...)                                     \
+  switch ((type).getKind()) {                                                 \
+    case taco::DataType::Int8:   { typedef int8_t   T; __VA_ARGS__; break; }  \
+    case taco::DataType::Int16:  { typedef int16_t  T; __VA_ARGS__; break; }  \
+    case taco::DataType::Int32:  { typedef int32_t  T; __VA_ARGS__; break; }  \
+    case taco::DataType::Int64:  { typedef int64_t  T; __VA_ARGS__; break; }  \
+    case taco::DataType::UInt8:  { typedef uint8_t  T; __VA_ARGS__; break; }  \
+    case taco::DataType::UInt16: { typedef uint16_t T; __VA_ARGS__; break; }  \
+    case taco::DataType::UInt32: { typedef uint32_t T; __VA_ARGS__; break; }  \
+    case taco::DataType::UInt64: { typedef uint64_t T; __VA_ARGS__; break; }  \
+    default:                                                                  \
+      taco_ierror << "Index arrays must have an integer type";                \
+  }
+
+#endif
@@ -1,6 +1,7 @@
 #ifndef TACO_STORAGE_TYPED_VECTOR_H
 #define TACO_STORAGE_TYPED_VECTOR_H
 #include <vector>
+#include <cstring>
 #include <taco/type.h>
 #include <taco/storage/array.h>
 #include <taco/storage/typed_value.h>
@@ -5,7 +5,9 @@
 #ifndef TACO_TENSOR_T_DEFINED
 #define TACO_TENSOR_T_DEFINED
 
-typedef enum { taco_mode_dense, taco_mode_sparse } taco_mode_t;
+typedef enum { taco_mode_dense, taco_mode_sparse, taco_mode_singleton,
+               taco_mode_hashed, taco_mode_bitmap, taco_mode_fixed,
+               taco_mode_diagonal } taco_mode_t;
 
 typedef struct {
   int32_t      order;         // tensor order (number of modes)
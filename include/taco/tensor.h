@@ -1,9 +1,11 @@
 #ifndef TACO_TENSOR_H
 #define TACO_TENSOR_H
 
+#include <bitset>
 #include <memory>
 #include <string>
 #include <vector>
+#include <future>
 #include <cassert>
 
 #include "taco/type.h"
@@ -12,6 +14,7 @@
 #include "taco/error/error_messages.h"
 
 #include "taco/index_notation/index_notation.h"
+#include "taco/index_notation/schedule.h"
 
 #include "taco/storage/storage.h"
 #include "taco/storage/index.h"
@@ -19,11 +22,24 @@
 #include "taco/storage/array_util.h"
 #include "taco/storage/typed_vector.h"
 #include "taco/util/name_generator.h"
+#include "taco/util/parallel.h"
 #include "taco/storage/typed_index.h"
+#include "taco/storage/index_dispatch.h"
 
 
 namespace taco {
 
+/// How `pack` combines the values of a coordinate that was inserted more than
+/// once.
+enum class DuplicatePolicy {
+  First,  /// Keep the first inserted value and warn (the default)
+  Last,   /// Keep the last inserted value
+  Sum,    /// Sum the values
+  Max,    /// Keep the largest value
+  Min,    /// Keep the smallest value
+  Error   /// Report an error
+};
+
 /// TensorBase is the super-class for all tensors. You can use it directly to
 /// avoid templates, or you can use the templated `Tensor<T>` that inherits from
 /// `TensorBase`.
@@ -122,6 +138,11 @@ public:
     coordinateBufferUsed += coordinateSize;
   }
 
+  /// Insert many values at once. `coordinates` holds one entry per value, made
+  /// of `getOrder()` int coordinates followed by the value, which is the layout
+  /// `insert` uses. If nothing has been inserted since the last pack the
+  /// entries are taken over without a copy.
+  void insertCoordinates(std::vector<char>&& coordinates);
 
   /// Returns the storage for this tensor. Tensor values are stored according
   /// to the format of the tensor.
@@ -131,9 +152,60 @@ public:
   /// to the format of the tensor.
   storage::Storage& getStorage();
 
+  /// Returns the number of values stored by the tensor, including the zeros
+  /// stored in dense levels.
+  size_t getNumStoredValues() const;
+
+  /// Compute the coordinates of the stored values at positions [begin,end) of
+  /// the value array. Coordinate m of value p is written to
+  /// `coordinates[m][(p-begin)*stride]`. The levels are walked bottom up, one
+  /// level at a time, with loops specialized to the level's index array types.
+  void getCoordinates(size_t begin, size_t end, int* const* coordinates,
+                      size_t stride=1) const;
+
   /// Pack tensor into the given format
   void pack();
 
+  /// Set how `pack` combines the values of coordinates that were inserted more
+  /// than once.
+  void setDuplicatePolicy(DuplicatePolicy policy);
+
+  /// Returns how `pack` combines the values of duplicate coordinates.
+  DuplicatePolicy getDuplicatePolicy() const;
+
+  /// Store each index array with the narrowest integer type that fits it, to
+  /// cut the memory traffic of kernels that stream through the index. Idx
+  /// arrays are sized by the dimension of their mode. Pos arrays are sized by
+  /// the most entries the level can hold, and `pack` then narrows them to the
+  /// number of entries it actually holds. The chosen types are recorded in the
+  /// format's level array types, so expressions that use the tensor must be
+  /// compiled after it is packed.
+  void setNarrowIndexTypes(bool narrow);
+
+  /// Returns whether index arrays use the narrowest integer type that fits.
+  bool getNarrowIndexTypes() const;
+
+  /// Use caller-owned index arrays and values as the tensor storage, without
+  /// copying them. `indices` holds the arrays of each level in storage order:
+  /// none for a dense level, the pos and idx arrays for a sparse level and the
+  /// idx array for a singleton level. Other level types cannot be adopted.
+  /// The arrays must have the types of the format's level array types and be
+  /// at least as large as the dimensions and pos arrays say. Arrays are freed
+  /// as their policies say, and arrays the caller owns must outlive their use
+  /// by the tensor. If `validate` is true the arrays are checked in one pass to
+  /// have non-decreasing pos arrays starting at zero, and strictly increasing
+  /// in-bounds coordinates within each segment. This is not an overload of
+  /// `adopt`, because braced lists of int* arrays would also match the
+  /// iterator-range vector constructor.
+  void adoptArrays(const std::vector<std::vector<storage::Array>>& indices,
+                   void* values, bool validate=true);
+
+  /// Use caller-owned int index arrays and values as the tensor storage, for
+  /// formats whose level array types are all int. Array sizes are derived from
+  /// the dimensions and pos arrays, and the arrays are not freed by taco.
+  void adopt(const std::vector<std::vector<int*>>& indices, void* values,
+             bool validate=true);
+
   /// Zero out the values
   void zero();
 
@@ -164,13 +236,29 @@ public:
   /// Set the expression to be evaluated when calling compute or assemble.
   void setAssignment(Assignment assignment);
 
-  /// Compile the tensor expression.
+  /// Set the schedule that the expression is compiled with, e.g. to split,
+  /// reorder, unroll or parallelize its loops.
+  void setSchedule(const Schedule& schedule);
+
+  /// Compile the tensor expression. Expressions that are identical up to tensor
+  /// and index variable names, and whose tensors have the same types, shapes
+  /// and formats, share the kernels of whichever was compiled first.
   void compile(bool assembleWhileCompute=false);
 
+  /// Compile the tensor expression without waiting for the C compiler, which
+  /// runs on a bounded pool of worker threads.  Lowering and code generation
+  /// still happen in the calling thread.  `assemble` and `compute` wait for
+  /// the compilation to finish, or the returned handle can be waited on.
+  std::shared_future<void> compileAsync(bool assembleWhileCompute=false);
+
   /// Assemble the tensor storage, including index and value arrays.
   void assemble();
 
   /// Compute the given expression and put the values in the tensor storage.
+  /// A hashed mode of the result is then compacted into a sparse mode: the
+  /// tensor's format silently becomes the format with a `Sparse` last mode and
+  /// its kernels are dropped, so computing again without recompiling fails
+  /// with `error::compute_without_compile`.
   void compute();
 
   /// Compile, assemble and compute as needed.
@@ -224,6 +312,34 @@ private:
   struct Content;
   std::shared_ptr<Content> content;
 
+  /// Lower the tensor expression, or fetch its kernels from the kernel cache,
+  /// and compile them either synchronously or on the compiler worker pool.
+  std::shared_future<void> compile(bool assembleWhileCompute, bool async);
+
+  /// Returns the packed kernel arguments (the result followed by the
+  /// operands). They are packed on the first call and later calls only point
+  /// them at the tensors' current storage.
+  std::vector<void*>& bindArguments();
+
+  /// Free the packed kernel arguments, e.g. when the expression changes.
+  void unbindArguments();
+
+  /// Record that kernels were compiled against the index array types of the
+  /// tensor and its operands.
+  void markIndexTypesCompiled();
+
+  /// Change the index array types of the tensor's format, converting the index
+  /// arrays that have already been packed.
+  void setLevelArrayTypes(const std::vector<std::vector<DataType>>& types);
+
+  /// Record the segment sizes of the fixed levels in the tensor's format,
+  /// keeping its storage.
+  void setFixedSizes(const std::vector<size_t>& fixedSizes);
+
+  /// Run the kernel `funcName` to build the hashed last level of the result,
+  /// rerunning it with larger segments until every coordinate fits.
+  void assembleHashed(const std::string& funcName);
+
   std::shared_ptr<std::vector<char>> coordinateBuffer;
   size_t                             coordinateBufferUsed;
   size_t                             coordinateSize;
@@ -262,6 +378,20 @@ public:
         " components to a Tensor<" << type<CType>() << ">";
   }
 
+  /// Use caller-owned index arrays and values as the tensor storage, without
+  /// copying them. See `TensorBase::adopt`.
+  void adopt(const std::vector<std::vector<int*>>& indices, CType* values,
+             bool validate=true) {
+    TensorBase::adopt(indices, values, validate);
+  }
+
+  /// Use index arrays of any integer type and caller-owned values as the
+  /// tensor storage, without copying them. See `TensorBase::adoptArrays`.
+  void adoptArrays(const std::vector<std::vector<storage::Array>>& indices,
+                   CType* values, bool validate=true) {
+    TensorBase::adoptArrays(indices, values, validate);
+  }
+
   /// Simple transpose that packs a new tensor from the values in the current tensor
   Tensor<CType> transpose(std::string name, std::vector<int> newModeOrdering) const {
     return transpose(name, newModeOrdering, getFormat());
@@ -280,17 +410,118 @@ public:
     }
 
     Tensor<CType> newTensor(name, newDimensions, format);
-    for (const std::pair<std::vector<size_t>,CType>& value : *this) {
-      std::vector<int> newCoordinate;
-      for (int mode : newModeOrdering) {
-        newCoordinate.push_back((int) value.first[mode]);
+    std::vector<int> newCoordinate(newModeOrdering.size());
+    forEach([&](const int* coordinate, CType value) {
+      for (size_t i = 0; i < newModeOrdering.size(); i++) {
+        newCoordinate[i] = coordinate[newModeOrdering[i]];
       }
-      newTensor.insert(newCoordinate, value.second);
+      newTensor.insert(newCoordinate, value);
+    });
+    newTensor.pack();
+    return newTensor;
+  }
+
+  /// Packs a blocked copy of the tensor. The first `getOrder()` modes of the
+  /// result index blocks of size `blockDimensions` and the last `getOrder()`
+  /// modes index components within a block, so e.g. a matrix blocked by {3,3}
+  /// in the BCSR format is stored as a CSR matrix of dense 3x3 blocks.
+  /// Dimensions that are not multiples of the block size are padded with zeros.
+  Tensor<CType> block(std::vector<int> blockDimensions, Format format) const {
+    return block(util::uniqueName('A'), blockDimensions, format);
+  }
+  Tensor<CType> block(std::string name, std::vector<int> blockDimensions,
+                      Format format) const {
+    const size_t order = getOrder();
+    taco_uassert(blockDimensions.size() == order) <<
+        "Expected " << order << " block dimensions but got " <<
+        blockDimensions.size();
+    taco_uassert(format.getOrder() == 2 * order) <<
+        "A blocked tensor of order " << order << " must have a format of " <<
+        "order " << 2 * order;
+
+    std::vector<int> newDimensions(2 * order);
+    for (size_t i = 0; i < order; i++) {
+      taco_uassert(blockDimensions[i] > 0) << "Block dimensions must be positive";
+      newDimensions[i] = (getDimension(i) + blockDimensions[i] - 1) /
+                         blockDimensions[i];
+      newDimensions[order + i] = blockDimensions[i];
     }
+
+    Tensor<CType> newTensor(name, newDimensions, format);
+    std::vector<int> newCoordinate(2 * order);
+    forEach([&](const int* coordinate, CType value) {
+      for (size_t i = 0; i < order; i++) {
+        newCoordinate[i] = coordinate[i] / blockDimensions[i];
+        newCoordinate[order + i] = coordinate[i] % blockDimensions[i];
+      }
+      newTensor.insert(newCoordinate, value);
+    });
     newTensor.pack();
     return newTensor;
   }
 
+  /// Call `visit(coordinate, value)` for every stored value in storage order,
+  /// where `coordinate` points to `getOrder()` ints. This walks the index
+  /// arrays directly and is much faster than the iterator. If `parallel` is
+  /// set, contiguous ranges of values are visited concurrently and `visit`
+  /// must be safe to call from several threads. The ranges are split at
+  /// arbitrary values, so the values of one top-level slice may be visited by
+  /// several threads.
+  template <typename Visitor>
+  void forEach(Visitor visit, bool parallel=false) const {
+    const size_t order = getOrder();
+    const CType* values = (const CType*)getStorage().getValues().getData();
+    auto visitRange = [&](size_t begin, size_t end) {
+      const size_t blockSize = 1 << 12;
+      std::vector<int> block(blockSize * std::max(order, (size_t)1));
+      std::vector<int*> coordinates(order);
+      for (size_t m = 0; m < order; m++) {
+        coordinates[m] = &block[m];
+      }
+      for (size_t blockBegin = begin; blockBegin < end;
+           blockBegin += blockSize) {
+        size_t blockEnd = std::min(blockBegin + blockSize, end);
+        getCoordinates(blockBegin, blockEnd, coordinates.data(), order);
+        for (size_t p = blockBegin; p < blockEnd; p++) {
+          visit((const int*)&block[(p - blockBegin) * order], values[p]);
+        }
+      }
+    };
+
+    const size_t numValues = getNumStoredValues();
+    if (parallel) {
+      util::parallelFor(numValues, [&](size_t, size_t begin, size_t end) {
+        visitRange(begin, end);
+      });
+    }
+    else {
+      visitRange(0, numValues);
+    }
+  }
+
+  /// Export the stored values as coordinate lists in storage order: one vector
+  /// of coordinates per mode and one vector of values.
+  void exportCOO(std::vector<std::vector<int>>* coordinates,
+                 std::vector<CType>* values, bool parallel=true) const {
+    const size_t numValues = getNumStoredValues();
+    coordinates->assign(getOrder(), std::vector<int>(numValues));
+    const CType* data = (const CType*)getStorage().getValues().getData();
+    values->assign(data, data + numValues);
+    auto exportRange = [&](size_t, size_t begin, size_t end) {
+      std::vector<int*> modeCoordinates;
+      for (auto& modeCoordinate : *coordinates) {
+        modeCoordinates.push_back(modeCoordinate.data() + begin);
+      }
+      getCoordinates(begin, end, modeCoordinates.data());
+    };
+    if (parallel) {
+      util::parallelFor(numValues, exportRange);
+    }
+    else {
+      exportRange(0, 0, numValues);
+    }
+  }
+
   template<typename T>
   class const_iterator {
   public:
@@ -332,13 +563,67 @@ public:
   private:
     friend class Tensor;
 
+    /// Advances the iterator within one level, whose body is instantiated for
+    /// the types of the level's index arrays.
+    typedef bool (const_iterator::*LevelAdvancer)(size_t lvl);
+
     const_iterator(const Tensor<CType>* tensor, bool isEnd = false) :
         tensor(tensor),
-        coord(storage::TypedIndexVector(type<T>(), tensor->getOrder())),
-        ptrs(storage::TypedIndexVector(type<T>(), tensor->getOrder())),
+        coord(tensor->getOrder()),
+        ptrs(tensor->getOrder()),
         curVal({std::vector<T>(tensor->getOrder()), 0}),
         count(1 + (size_t)isEnd * tensor->getStorage().getIndex().getSize()),
         advance(false) {
+      using namespace taco::storage;
+
+      // Select the typed advancer of every level once per traversal instead of
+      // switching on the index types of every element
+      const storage::Storage& storage = tensor->getStorage();
+      values = (const CType*)storage.getValues().getData();
+      for (size_t i = 0; i < tensor->getOrder(); ++i) {
+        const auto& modeIndex = storage.getIndex().getModeIndex(i);
+        const Array& posArray = modeIndex.getIndexArray(0);
+        const Array& idxArray =
+            modeIndex.getIndexArray(modeIndex.numIndexArrays() - 1);
+        pos.push_back(posArray.getData());
+        idx.push_back(idxArray.getData());
+        sizes.push_back(0);
+        words.push_back(nullptr);
+        switch (tensor->getFormat().getModeTypes()[i]) {
+          case Dense:
+            sizes[i] = (T)posArray.get(0).getAsIndex();
+            advancers.push_back(&const_iterator::advanceDense);
+            break;
+          case Bitmap:
+            sizes[i] = (T)posArray.get(0).getAsIndex();
+            words[i] = (const uint64_t*)modeIndex.getIndexArray(1).getData();
+            DISPATCH_INDEX_TYPE(idxArray.getType(), R,
+                advancers.push_back(&const_iterator::advanceBitmap<R>));
+            break;
+          case Sparse:
+            DISPATCH_INDEX_TYPE(posArray.getType(), P,
+              DISPATCH_INDEX_TYPE(idxArray.getType(), I,
+                advancers.push_back(&const_iterator::advanceSparse<P,I>)));
+            break;
+          case Fixed:
+            sizes[i] = (T)posArray.get(0).getAsIndex();
+            DISPATCH_INDEX_TYPE(idxArray.getType(), I,
+                advancers.push_back(&const_iterator::advanceFixed<I>));
+            break;
+          case Diagonal:
+            sizes[i] = (T)posArray.get(0).getAsIndex();
+            DISPATCH_INDEX_TYPE(idxArray.getType(), I,
+                advancers.push_back(&const_iterator::advanceDiagonal<I>));
+            break;
+          case Singleton:
+            DISPATCH_INDEX_TYPE(idxArray.getType(), I,
+                advancers.push_back(&const_iterator::advanceSingleton<I>));
+            break;
+          default:
+            taco_not_supported_yet;
+            break;
+        }
+      }
       advanceIndex();
     }
 
@@ -348,106 +633,173 @@ public:
     }
 
     bool advanceIndex(size_t lvl) {
-      using namespace taco::storage;
-
-      const auto& modeTypes = tensor->getFormat().getModeTypes();
-      const auto& modeOrdering = tensor->getFormat().getModeOrdering();
-
       if (lvl == tensor->getOrder()) {
         if (advance) {
           advance = false;
           return false;
         }
 
-        const TypedIndexVal idx = (lvl == 0) ? TypedIndexVal(type<T>(), 0) : ptrs[lvl - 1];
-        curVal.second = ((CType *)tensor->getStorage().getValues().getData())[idx.getAsIndex()];
+        const auto& modeOrdering = tensor->getFormat().getModeOrdering();
+        const T p = (lvl == 0) ? 0 : ptrs[lvl - 1];
+        curVal.second = values[p];
 
         for (size_t i = 0; i < lvl; ++i) {
           const size_t mode = modeOrdering[i];
-          curVal.first[mode] = coord[i].getAsIndex();
+          curVal.first[mode] = coord[i];
         }
 
         advance = true;
         return true;
       }
-      
-      const auto storage = tensor->getStorage();
-      const auto modeIndex = storage.getIndex().getModeIndex(lvl);
-
-      switch (modeTypes[lvl]) {
-        case Dense: {
-          const TypedIndexVal size = TypedIndexVal(type<T>(), modeIndex.getIndexArray(0)[0].getAsIndex());
-          TypedIndexVal base = ptrs[lvl - 1] * size;
-          if (lvl == 0) base.set(0);
-
-          if (advance) {
-            goto resume_dense;  // obligatory xkcd: https://xkcd.com/292/
-          }
 
-          for (coord[lvl] = 0; coord[lvl] < size; ++coord[lvl]) {
-            ptrs[lvl] = base + coord[lvl];
+      return (this->*advancers[lvl])(lvl);
+    }
 
-          resume_dense:
-            if (advanceIndex(lvl + 1)) {
-              return true;
-            }
-          }
-          break;
+    bool advanceDense(size_t lvl) {
+      const T size = sizes[lvl];
+      const T base = (lvl == 0) ? 0 : ptrs[lvl - 1] * size;
+
+      if (advance) {
+        goto resume_dense;  // obligatory xkcd: https://xkcd.com/292/
+      }
+
+      for (coord[lvl] = 0; coord[lvl] < size; ++coord[lvl]) {
+        ptrs[lvl] = base + coord[lvl];
+
+      resume_dense:
+        if (advanceIndex(lvl + 1)) {
+          return true;
         }
-        case Sparse: {
-          const auto& pos = modeIndex.getIndexArray(0);
-          const auto& idx = modeIndex.getIndexArray(1);
-          const TypedIndexVal  k   = (lvl == 0) ? TypedIndexVal(type<T>(), 0) : ptrs[lvl - 1];
+      }
+      return false;
+    }
 
-          if (advance) {
-            goto resume_sparse;
-          }
+    template <typename R>
+    bool advanceBitmap(size_t lvl) {
+      // Bits are numbered like dense positions and the rank (idx) array counts
+      // the set bits before every word
+      const R* rank = (const R*)idx[lvl];
+      const T size = sizes[lvl];
+      const T base = (lvl == 0) ? 0 : ptrs[lvl - 1] * size;
 
-          for (ptrs[lvl] = pos.get(k.getAsIndex()).getAsIndex();
-               ptrs[lvl] < pos.get(k.getAsIndex()+1).getAsIndex();
-               ++ptrs[lvl]) {
-            coord[lvl] = idx.get(ptrs[lvl].getAsIndex()).getAsIndex();
+      if (advance) {
+        goto resume_bitmap;
+      }
 
-          resume_sparse:
-            if (advanceIndex(lvl + 1)) {
-              return true;
-            }
+      for (coord[lvl] = 0; coord[lvl] < size; ++coord[lvl]) {
+        {
+          const size_t bit = (size_t)(base + coord[lvl]);
+          const uint64_t word = words[lvl][bit / 64];
+          const uint64_t below = ((uint64_t)1 << (bit % 64)) - 1;
+          if (!((word >> (bit % 64)) & 1)) {
+            continue;
           }
-          break;
+          ptrs[lvl] = (T)rank[bit / 64] +
+                      (T)std::bitset<64>(word & below).count();
         }
-        case Fixed: {
-          TypedIndexVal  elems = TypedIndexVal();
-          elems.set(modeIndex.getIndexArray(0)[0]);
-          const TypedIndexVal  base  = (lvl == 0) ? TypedIndexVal(type<T>(), 0) : (ptrs[lvl - 1] * elems);
-          const auto& vals  = modeIndex.getIndexArray(1);
-
-          if (advance) {
-            goto resume_fixed;
-          }
 
-          for (ptrs[lvl] = base;
-               ptrs[lvl] < base + elems && vals.get(ptrs[lvl].getAsIndex()) >= 0;
-               ++ptrs[lvl]) {
-            coord[lvl] = vals.get(ptrs[lvl].getAsIndex()).getAsIndex();
+      resume_bitmap:
+        if (advanceIndex(lvl + 1)) {
+          return true;
+        }
+      }
+      return false;
+    }
 
-          resume_fixed:
-            if (advanceIndex(lvl + 1)) {
-              return true;
-            }
-          }
-          break;
+    template <typename P, typename I>
+    bool advanceSparse(size_t lvl) {
+      const P* segments = (const P*)pos[lvl];
+      const I* coords = (const I*)idx[lvl];
+      const T k = (lvl == 0) ? 0 : ptrs[lvl - 1];
+
+      if (advance) {
+        goto resume_sparse;
+      }
+
+      for (ptrs[lvl] = (T)segments[k]; ptrs[lvl] < (T)segments[k+1];
+           ++ptrs[lvl]) {
+        coord[lvl] = (T)coords[ptrs[lvl]];
+
+      resume_sparse:
+        if (advanceIndex(lvl + 1)) {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    template <typename I>
+    bool advanceFixed(size_t lvl) {
+      const I* coords = (const I*)idx[lvl];
+      const T elems = sizes[lvl];
+      const T base  = (lvl == 0) ? 0 : ptrs[lvl - 1] * elems;
+
+      if (advance) {
+        goto resume_fixed;
+      }
+
+      for (ptrs[lvl] = base;
+           ptrs[lvl] < base + elems && (long long)coords[ptrs[lvl]] >= 0;
+           ++ptrs[lvl]) {
+        coord[lvl] = (T)coords[ptrs[lvl]];
+
+      resume_fixed:
+        if (advanceIndex(lvl + 1)) {
+          return true;
         }
-        default:
-          taco_not_supported_yet;
-          break;
+      }
+      return false;
+    }
+
+    template <typename I>
+    bool advanceDiagonal(size_t lvl) {
+      // Coordinates are offsets from the row, clamped to the matrix
+      const I* offsets = (const I*)idx[lvl];
+      const T numDiagonals = sizes[lvl];
+      const T base = ptrs[lvl - 1] * numDiagonals;
+      const long long last = (long long)tensor->getDimension(
+          tensor->getFormat().getModeOrdering()[lvl]) - 1;
+
+      if (advance) {
+        goto resume_diagonal;
       }
 
+      for (ptrs[lvl] = base; ptrs[lvl] < base + numDiagonals; ++ptrs[lvl]) {
+        coord[lvl] = (T)std::max(0LL, std::min(last,
+            (long long)coord[lvl - 1] + (long long)offsets[ptrs[lvl] - base]));
+
+      resume_diagonal:
+        if (advanceIndex(lvl + 1)) {
+          return true;
+        }
+      }
       return false;
     }
 
+    template <typename I>
+    bool advanceSingleton(size_t lvl) {
+      const I* coords = (const I*)idx[lvl];
+
+      if (advance) {
+        goto resume_singleton;
+      }
+
+      ptrs[lvl] = ptrs[lvl - 1];
+      coord[lvl] = (T)coords[ptrs[lvl]];
+
+    resume_singleton:
+      return advanceIndex(lvl + 1);
+    }
+
     const Tensor<CType>*              tensor;
-    storage::TypedIndexVector         coord;
-    storage::TypedIndexVector         ptrs;
+    const CType*                      values;
+    std::vector<LevelAdvancer>        advancers;
+    std::vector<const void*>          pos;
+    std::vector<const void*>          idx;
+    std::vector<T>                    sizes;
+    std::vector<const uint64_t*>      words;
+    std::vector<T>                    coord;
+    std::vector<T>                    ptrs;
     std::pair<std::vector<T>,CType>   curVal;
     size_t                            count;
     bool                              advance;
@@ -496,7 +848,13 @@ enum class FileType {
   ttx,
 
   /// .rb  - The rutherford-boeing sparse matrix format.
-  rb
+  rb,
+
+  /// .bin - The taco binary format.  It stores the packed index and value
+  ///        arrays of a tensor together with its format and dimensions, so
+  ///        that reading it memory maps the file instead of parsing it.  It
+  ///        must be read with the format it was written in.
+  bin
 };
 
 /// Read a tensor from a file. The file format is inferred from the filename
@@ -622,6 +980,10 @@ void getCSCArrays(const TensorBase& tensor,
 /// Pack the operands in the given expression.
 void packOperands(const TensorBase& tensor);
 
+/// Compile the expressions of several tensors, running the C compiler for
+/// independent kernels concurrently.
+void compile(std::vector<TensorBase> tensors, bool assembleWhileCompute=false);
+
 /// Iterate over the typed values of a TensorBase.
 template <typename CType>
 Tensor<CType> iterate(const TensorBase& tensor) {
@@ -2,6 +2,8 @@
 #define SRC_UTIL_ENV_H_
 
 #include <string>
+#include <cerrno>
+#include <cstdlib>
 #include <cstring>
 #include <unistd.h>
 
@@ -10,6 +12,7 @@
 namespace taco {
 namespace util {
 std::string getFromEnv(std::string flag, std::string dflt);
+size_t getSizeFromEnv(std::string flag, size_t dflt);
 std::string getTmpdir();
 extern std::string cachedtmpdir;
 extern void cachedtmpdirCleanup(void);
@@ -23,6 +26,23 @@ inline std::string getFromEnv(std::string flag, std::string dflt) {
   }
 }
 
+/// Returns the non-negative integer that the environment variable `flag` is
+/// set to, or `dflt` if it is not set. Malformed values are ignored with a
+/// warning.
+inline size_t getSizeFromEnv(std::string flag, size_t dflt) {
+  std::string value = getFromEnv(flag, std::to_string(dflt));
+  char* end = nullptr;
+  errno = 0;
+  unsigned long long size = strtoull(value.c_str(), &end, 10);
+  if (value.empty() || *end != '\0' || errno == ERANGE ||
+      value.find('-') != std::string::npos) {
+    taco_uwarning << "Ignoring malformed " << flag << " " << value <<
+        "; using the default";
+    return dflt;
+  }
+  return (size_t)size;
+}
+
 inline std::string getTmpdir() {
   if (cachedtmpdir == ""){
     // use posix logic for finding a temp dir
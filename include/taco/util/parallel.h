@@ -0,0 +1,43 @@
+#ifndef TACO_UTIL_PARALLEL_H
+#define TACO_UTIL_PARALLEL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace taco {
+namespace util {
+
+/// Returns the number of threads used by parallel library routines, which is
+/// given by `setNumThreads` or else by `TACO_NUM_THREADS`, and defaults to the
+/// hardware concurrency. The environment variable is read once.
+size_t getNumThreads();
+
+/// Override the number of threads used by parallel library routines, or
+/// restore the default if `numThreads` is zero.
+void setNumThreads(size_t numThreads);
+
+/// Returns the number of chunks `parallelFor` splits a range of `size`
+/// elements into: one per thread, but no chunk smaller than `minChunkSize`
+/// elements.
+size_t getNumChunks(size_t size, size_t minChunkSize=(1<<14));
+
+/// Split [0,size) into `getNumChunks(size, minChunkSize)` contiguous chunks and
+/// call `body(chunk, begin, end)` for each of them on its own thread.  A range
+/// with a single chunk runs on the calling thread.
+void parallelFor(size_t size,
+                 const std::function<void(size_t,size_t,size_t)>& body,
+                 size_t minChunkSize=(1<<14));
+
+/// Replace each element of `v` by the sum of the elements before it, and
+/// return the sum of all elements.
+size_t parallelExclusiveScan(std::vector<size_t>& v);
+
+/// Stable LSD radix sort of `keys`, of which only the low `numKeyBits` bits
+/// may be set. `values` is permuted along with the keys.
+void parallelRadixSort(std::vector<uint64_t>& keys, std::vector<size_t>& values,
+                       int numKeyBits);
+
+}}
+#endif
@@ -0,0 +1,52 @@
+#ifndef TACO_UTIL_THREAD_POOL_H
+#define TACO_UTIL_THREAD_POOL_H
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include "taco/util/uncopyable.h"
+
+namespace taco {
+namespace util {
+
+/// A fixed-size pool of worker threads that run submitted tasks in FIFO
+/// order.  Destroying the pool finishes the queued tasks and joins the workers.
+class ThreadPool : private Uncopyable {
+public:
+  /// Create a pool with `numThreads` workers, or one per hardware thread if
+  /// `numThreads` is zero.
+  explicit ThreadPool(size_t numThreads=0);
+  ~ThreadPool();
+
+  /// Queue a task and return a future that holds its result.
+  template <typename F>
+  std::future<typename std::result_of<F()>::type> submit(F task) {
+    typedef typename std::result_of<F()>::type R;
+    auto packagedTask = std::make_shared<std::packaged_task<R()>>(task);
+    std::future<R> result = packagedTask->get_future();
+    enqueue([packagedTask]() { (*packagedTask)(); });
+    return result;
+  }
+
+  /// Returns the number of worker threads.
+  size_t getNumThreads() const;
+
+private:
+  std::vector<std::thread> workers;
+  std::queue<std::function<void()>> tasks;
+  std::mutex tasksMutex;
+  std::condition_variable tasksAvailable;
+  bool stopping;
+
+  void enqueue(std::function<void()> task);
+  void work();
+};
+
+}}
+#endif
@@ -21,7 +21,7 @@ namespace {
 // Include stdio.h for printf
 // stdlib.h for malloc/realloc
 // math.h for sqrt
-// MIN preprocessor macro
+// MIN and MAX preprocessor macros
 // This *must* be kept in sync with taco_tensor_t.h
 const string cHeaders =
   "#ifndef TACO_C_HEADERS\n"
@@ -32,9 +32,10 @@ const string cHeaders =
   "#include <math.h>\n"
   "#include <complex.h>\n"
   "#define TACO_MIN(_a,_b) ((_a) < (_b) ? (_a) : (_b))\n"
+  "#define TACO_MAX(_a,_b) ((_a) > (_b) ? (_a) : (_b))\n"
   "#ifndef TACO_TENSOR_T_DEFINED\n"
   "#define TACO_TENSOR_T_DEFINED\n"
-  "typedef enum { taco_mode_dense, taco_mode_sparse } taco_mode_t;\n"
+  "typedef enum { taco_mode_dense, taco_mode_sparse, taco_mode_singleton, taco_mode_hashed, taco_mode_bitmap, taco_mode_fixed, taco_mode_diagonal } taco_mode_t;\n"
   "typedef struct {\n"
   "  int32_t      order;         // tensor order (number of modes)\n"
   "  int32_t*     dimensions;    // tensor dimensions\n"
@@ -100,6 +101,9 @@ protected:
     op->increment.accept(this);
     inVarAssignLHSWithDecl = false;
 
+    for (auto& reduction : op->reductions) {
+      reduction.accept(this);
+    }
     op->contents.accept(this);
   }
 
@@ -177,21 +181,28 @@ string unpackTensorProperty(string varname, const GetProperty* op,
   
   string tp;
   
-  // for a Dense level, nnz is an int
+  // for a Dense or Bitmap level, nnz is an int
   // for a Fixed level, ptr is an int
-  // all others are int*
+  // all others are pointers to the level's array type
   if ((tensor->format.getModeTypes()[op->mode] == ModeType::Dense &&
        op->property == TensorProperty::Dimension) ||
+      (tensor->format.getModeTypes()[op->mode] == ModeType::Bitmap &&
+       op->property == TensorProperty::Dimension) ||
       (tensor->format.getModeTypes()[op->mode] == ModeType::Fixed &&
        op->property == TensorProperty::Dimension)) {
     tp = "int";
     ret << tp << " " << varname << " = *(int*)("
         << tensor->name << "->indices[" << op->mode << "][0]);\n";
+  } else if (op->property == TensorProperty::Dimension) {
+    // other levels do not store their dimension, which the tensor records
+    ret << "int " << varname << " = (int)(" << tensor->name
+        << "->dimensions[" << tensor->name << "->mode_ordering["
+        << op->mode << "]]);\n";
   } else {
-    tp = "int*";
+    tp = toCType(op->type, true);
     auto nm = op->index;
     ret << tp << " restrict " << varname << " = ";
-    ret << "(int*)(" << tensor->name << "->indices[" << op->mode;
+    ret << "(" << tp << ")(" << tensor->name << "->indices[" << op->mode;
     ret << "][" << nm << "]);\n";
   }
   
@@ -215,13 +226,9 @@ string packTensorProperty(string varname, Expr tnsr, TensorProperty property,
   
   string tp;
   
-  // for a Dense level, nnz is an int
-  // for a Fixed level, ptr is an int
+  // dimensions are never written by the kernel
   // all others are int*
-  if ((tensor->format.getModeTypes()[mode] == ModeType::Dense &&
-       property == TensorProperty::Dimension) ||
-      (tensor->format.getModeTypes()[mode] == ModeType::Fixed &&
-       property == TensorProperty::Dimension)) {
+  if (property == TensorProperty::Dimension) {
     return "";
   } else {
     tp = "int*";
@@ -568,6 +575,13 @@ void CodeGen_C::visit(const For* op) {
     case LoopKind::Dynamic:
       doIndent();
       out << getParallelizePragma(op->kind);
+      // Threads add into private copies of the reduced scalars, which OpenMP
+      // adds into the originals when the loop ends
+      for (auto& reduction : op->reductions) {
+        out << " reduction(+:";
+        reduction.accept(this);
+        out << ")";
+      }
       out << "\n";
     default:
       break;
@@ -612,6 +626,22 @@ void CodeGen_C::visit(const Min* op) {
 
 }
 
+void CodeGen_C::visit(const Max* op) {
+  stream << "TACO_MAX(";
+  op->a.accept(this);
+  stream << ",";
+  op->b.accept(this);
+  stream << ")";
+}
+
+void CodeGen_C::visit(const Store* op) {
+  if (op->use_atomics) {
+    doIndent();
+    out << "#pragma omp atomic\n";
+  }
+  IRPrinter::visit(op);
+}
+
 void CodeGen_C::visit(const Allocate* op) {
   string elementType = toCType(op->var.type(), false);
 
@@ -634,6 +664,13 @@ void CodeGen_C::visit(const Allocate* op) {
   stream << ");";
 }
 
+void CodeGen_C::visit(const Free* op) {
+  doIndent();
+  stream << "free(";
+  op->var.accept(this);
+  stream << ");";
+}
+
 void CodeGen_C::visit(const Sqrt* op) {
   taco_tassert(op->type.isFloat() && op->type.getNumBits() == 64) <<
       "Codegen doesn't currently support non-double sqrt";
@@ -641,6 +678,13 @@ void CodeGen_C::visit(const Sqrt* op) {
   op->a.accept(this);
   stream << ")";
 }
+
+void CodeGen_C::visit(const Popcount* op) {
+  stream << "__builtin_popcountll(";
+  parentPrecedence = Precedence::TOP;
+  op->a.accept(this);
+  stream << ")";
+}
   
 void CodeGen_C::generateShim(const Stmt& func, stringstream &ret) {
   const Function *funcPtr = func.as<Function>();
@@ -39,8 +39,12 @@ protected:
   void visit(const While*);
   void visit(const GetProperty*);
   void visit(const Min*);
+  void visit(const Max*);
+  void visit(const Store*);
   void visit(const Allocate*);
+  void visit(const Free*);
   void visit(const Sqrt*);
+  void visit(const Popcount*);
 
   std::map<Expr, std::string, ExprCompare> varMap;
   std::ostream &out;
@@ -0,0 +1,199 @@
+#include "kernel_cache.h"
+
+#include <sstream>
+
+#include "taco/format.h"
+#include "taco/index_notation/index_notation.h"
+#include "taco/index_notation/index_notation_nodes.h"
+#include "taco/index_notation/index_notation_visitor.h"
+#include "taco/index_notation/schedule.h"
+#include "taco/util/collections.h"
+#include "taco/util/strings.h"
+
+using namespace std;
+
+namespace taco {
+namespace ir {
+
+namespace {
+
+/// Prints an assignment with tensors and index variables renamed to the order
+/// in which they are first encountered.
+class KernelKeyPrinter : public IndexNotationVisitor {
+public:
+  KernelKeyPrinter(ostream& os) : os(os) {}
+
+  void print(const TensorVar& tensorVar) {
+    Assignment assignment = tensorVar.getAssignment();
+    taco_iassert(assignment.defined());
+
+    printAccess(assignment.getLhs().getTensorVar(),
+                assignment.getLhs().getIndexVars());
+    if (assignment.getOp().defined()) {
+      printOperator(assignment.getOp());
+    }
+    os << "=";
+    assignment.getRhs().accept(this);
+    os << ";";
+
+    for (auto& tensor : tensors) {
+      const Format& format = tensor.getFormat();
+      os << tensor.getType()
+         << "(" << util::join(format.getModeTypes(), ",")
+         << ";" << util::join(format.getModeOrdering(), ",");
+      for (auto& arrayTypes : format.getLevelArrayTypes()) {
+        os << ";" << util::join(arrayTypes, ",");
+      }
+      for (size_t i = 0; i < format.getOrder(); i++) {
+        if (format.getModeTypes()[i] == ModeType::Fixed ||
+            format.getModeTypes()[i] == ModeType::Diagonal) {
+          os << ";" << format.getFixedSize(i);
+        }
+      }
+      os << ")";
+    }
+
+    const Schedule& schedule = tensorVar.getSchedule();
+    for (auto& split : schedule.getSplits()) {
+      os << "[split i" << getId(split.getVar()) << ",i" << getId(split.getOuter())
+         << ",i" << getId(split.getInner()) << "," << split.getFactor() << "]";
+    }
+    if (schedule.getLoopOrder().size() > 0) {
+      os << "[order";
+      for (auto& var : schedule.getLoopOrder()) {
+        os << ",i" << getId(var);
+      }
+      os << "]";
+    }
+    for (auto& unroll : schedule.getUnrollFactors()) {
+      os << "[unroll i" << getId(unroll.first) << "," << unroll.second << "]";
+    }
+    for (auto& parallel : schedule.getParallelLoops()) {
+      os << "[parallel i" << getId(parallel.first) << "," << parallel.second
+         << "]";
+    }
+  }
+
+private:
+  using IndexNotationVisitor::visit;
+
+  ostream& os;
+  vector<TensorVar> tensors;
+  map<TensorVar,size_t> tensorIds;
+  map<IndexVar,size_t> indexVarIds;
+
+  size_t getId(const TensorVar& tensorVar) {
+    if (!util::contains(tensorIds, tensorVar)) {
+      tensorIds.insert({tensorVar, tensors.size()});
+      tensors.push_back(tensorVar);
+    }
+    return tensorIds.at(tensorVar);
+  }
+
+  size_t getId(const IndexVar& indexVar) {
+    if (!util::contains(indexVarIds, indexVar)) {
+      size_t id = indexVarIds.size();
+      indexVarIds.insert({indexVar, id});
+    }
+    return indexVarIds.at(indexVar);
+  }
+
+  void printAccess(const TensorVar& tensorVar, const vector<IndexVar>& vars) {
+    os << "t" << getId(tensorVar) << "(";
+    for (auto& var : vars) {
+      os << "i" << getId(var) << ",";
+    }
+    os << ")";
+  }
+
+  void printOperator(const IndexExpr& op) {
+    taco_iassert(isa<BinaryExprNode>(op.ptr));
+    os << to<BinaryExprNode>(op.ptr)->getOperatorString();
+  }
+
+  void visit(const AccessNode* op) {
+    printAccess(op->tensorVar, op->indexVars);
+  }
+
+  void visit(const LiteralNode* op) {
+    os << op->getDataType() << ":" << IndexExpr(op);
+  }
+
+  void visit(const NegNode* op) {
+    os << "-(";
+    op->a.accept(this);
+    os << ")";
+  }
+
+  void visit(const SqrtNode* op) {
+    os << "sqrt(";
+    op->a.accept(this);
+    os << ")";
+  }
+
+  void visit(const BinaryExprNode* op) {
+    os << "(";
+    op->a.accept(this);
+    os << op->getOperatorString();
+    op->b.accept(this);
+    os << ")";
+    for (auto& split : op->getOperatorSplits()) {
+      os << "[split i" << getId(split.getOld())
+         << ",i" << getId(split.getLeft())
+         << ",i" << getId(split.getRight()) << "]";
+    }
+  }
+
+  void visit(const ReductionNode* op) {
+    os << "reduce";
+    printOperator(op->op);
+    os << "(i" << getId(op->var) << ",";
+    op->a.accept(this);
+    os << ")";
+  }
+};
+
+}
+
+string getKernelKey(const TensorVar& tensorVar, bool assembleWhileCompute,
+                    size_t allocSize) {
+  stringstream key;
+  KernelKeyPrinter(key).print(tensorVar);
+  key << (assembleWhileCompute ? "|assemble-while-compute" : "")
+      << "|alloc" << allocSize;
+  return key.str();
+}
+
+
+// class KernelCache
+KernelCache& KernelCache::getInstance() {
+  static KernelCache cache;
+  return cache;
+}
+
+bool KernelCache::get(const string& key, Kernel* kernel) const {
+  lock_guard<std::mutex> lock(kernelsMutex);
+  auto it = kernels.find(key);
+  if (it == kernels.end()) {
+    return false;
+  }
+  *kernel = it->second;
+  return true;
+}
+
+Kernel KernelCache::insert(const string& key, const Kernel& kernel) {
+  lock_guard<std::mutex> lock(kernelsMutex);
+  return kernels.insert({key, kernel}).first->second;
+}
+
+void KernelCache::clear() {
+  lock_guard<std::mutex> lock(kernelsMutex);
+  kernels.clear();
+}
+
+size_t KernelCache::size() const {
+  lock_guard<std::mutex> lock(kernelsMutex);
+  return kernels.size();
+}
+
+}}
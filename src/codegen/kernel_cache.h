@@ -0,0 +1,67 @@
+#ifndef TACO_KERNEL_CACHE_H
+#define TACO_KERNEL_CACHE_H
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "taco/ir/ir.h"
+
+namespace taco {
+class TensorVar;
+
+namespace ir {
+class Module;
+
+/// A compiled kernel: the lowered assemble and compute functions and the
+/// module they were compiled into.
+struct Kernel {
+  Stmt assembleFunc;
+  Stmt computeFunc;
+  std::shared_ptr<Module> module;
+};
+
+/// Returns a key that identifies the kernels generated for the assignment
+/// that computes `tensorVar`.  Two tensor variables get the same key iff they
+/// lower to the same code up to tensor and index variable names, so the key
+/// covers the expression structure, literal values, operator splits, and the
+/// data type, shape and format of every tensor in the assignment.
+std::string getKernelKey(const TensorVar& tensorVar, bool assembleWhileCompute,
+                         size_t allocSize);
+
+/// A process-wide cache of compiled kernels, so that tensors computing the
+/// same expression on same-shaped and same-formatted operands share a single
+/// compiled module instead of each invoking the C compiler.  Cached kernels
+/// keep the tensor names of the tensor that first compiled them, so their IR
+/// and source may refer to other names than the tensor that looks them up.
+class KernelCache {
+public:
+  /// Returns the process-wide kernel cache.
+  static KernelCache& getInstance();
+
+  /// Look up the kernel stored under `key`. Returns true and sets `kernel` if
+  /// there is one.
+  bool get(const std::string& key, Kernel* kernel) const;
+
+  /// Store `kernel` under `key`.  If another thread stored a kernel under the
+  /// same key in the meantime the first one is kept and returned.
+  Kernel insert(const std::string& key, const Kernel& kernel);
+
+  /// Remove all cached kernels.  Tensors that already hold a kernel keep it.
+  void clear();
+
+  /// Returns the number of cached kernels.
+  size_t size() const;
+
+private:
+  KernelCache() = default;
+  KernelCache(const KernelCache&) = delete;
+  KernelCache& operator=(const KernelCache&) = delete;
+
+  mutable std::mutex kernelsMutex;
+  std::map<std::string, Kernel> kernels;
+};
+
+}}
+#endif
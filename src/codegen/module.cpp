@@ -1,13 +1,23 @@
 #include <iostream>
 #include <fstream>
+#include <iomanip>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <ctime>
 #include <dlfcn.h>
+#include <dirent.h>
 #include <unistd.h>
+#include <utime.h>
+#include <sys/stat.h>
 
 
 #include "module.h"
 #include "taco/error.h"
 #include "taco/util/strings.h"
 #include "taco/util/env.h"
+#include "taco/util/thread_pool.h"
 
 using namespace std;
 
@@ -29,30 +39,28 @@ void Module::addFunction(Stmt func) {
   funcs.push_back(func);
 }
 
-void Module::compileToSource(string path, string prefix) {
-  if (!moduleFromUserSource) {
-  
-    // create a codegen instance and add all the funcs
-    bool didGenRuntime = false;
-    
-    header.str("");
-    source.str("");
-    header.clear();
-    source.clear();
-    
-    taco_tassert(target.arch == Target::C99) <<
-        "Only C99 codegen supported currently";
-    CodeGen_C codegen(source, CodeGen_C::OutputKind::C99Implementation);
-    CodeGen_C headergen(header, CodeGen_C::OutputKind::C99Header);
-    
-    
-    for (auto func: funcs) {
-      codegen.compile(func, !didGenRuntime);
-      headergen.compile(func, !didGenRuntime);
-      didGenRuntime = true;
-    }
+void Module::generateSource() {
+  // create a codegen instance and add all the funcs
+  bool didGenRuntime = false;
+
+  header.str("");
+  source.str("");
+  header.clear();
+  source.clear();
+
+  taco_tassert(target.arch == Target::C99) <<
+      "Only C99 codegen supported currently";
+  CodeGen_C codegen(source, CodeGen_C::OutputKind::C99Implementation);
+  CodeGen_C headergen(header, CodeGen_C::OutputKind::C99Header);
+
+  for (auto func: funcs) {
+    codegen.compile(func, !didGenRuntime);
+    headergen.compile(func, !didGenRuntime);
+    didGenRuntime = true;
   }
+}
 
+void Module::writeSource(string path, string prefix) {
   ofstream source_file;
   source_file.open(path+prefix+".c");
   source_file << source.str();
@@ -64,56 +72,277 @@ void Module::compileToSource(string path, string prefix) {
   header_file.close();
 }
 
+void Module::compileToSource(string path, string prefix) {
+  if (!moduleFromUserSource) {
+    generateSource();
+  }
+  writeSource(path, prefix);
+}
+
 void Module::compileToStaticLibrary(string path, string prefix) {
   taco_tassert(false) << "Compiling to a static library is not supported";
 }
   
 namespace {
 
-void writeShims(vector<Stmt> funcs, string path, string prefix) {
+string generateShims(const vector<Stmt>& funcs) {
   stringstream shims;
-  
   for (auto func: funcs) {
     CodeGen_C::generateShim(func, shims);
   }
-  
+  return shims.str();
+}
+
+void writeShims(string shims, string path, string prefix) {
   ofstream shims_file;
   shims_file.open(path+prefix+"_shims.c");
   shims_file << "#include \"" << path << prefix << ".h\"\n";
-  shims_file << shims.str();
+  shims_file << shims;
   shims_file.close();
 }
 
+/// Returns the 64-bit FNV-1a hash of str as a hex string.
+string hashString(const string& str) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (unsigned char c : str) {
+    hash ^= c;
+    hash *= 1099511628211ULL;
+  }
+  stringstream ss;
+  ss << hex << setw(16) << setfill('0') << hash;
+  return ss.str();
+}
+
+/// Returns a suffix for temporary files in the cache directory that no other
+/// process, and no other compilation in this process, uses at the same time.
+string uniqueTmpSuffix() {
+  static atomic<unsigned long> counter(0);
+  return "." + to_string(getpid()) + "." + to_string(counter++) + ".tmp";
+}
+
+/// Temporary files older than this many seconds were left behind by processes
+/// that died while compiling, and are evicted from the cache directory.
+const time_t ORPHANED_TMP_AGE = 60 * 60;
+
+/// Returns the maximum size of the cache directory in bytes, which is given in
+/// megabytes by `TACO_CACHE_SIZE` and defaults to 1024.
+size_t getMaxCacheSize() {
+  return util::getSizeFromEnv("TACO_CACHE_SIZE", 1024) << 20;
+}
+
+/// Returns the persistent library cache directory, creating it if necessary,
+/// or an empty string if `TACO_CACHE_DIR` is not set.
+string getCacheDir() {
+  string cachedir = util::getFromEnv("TACO_CACHE_DIR", "");
+  if (cachedir == "") {
+    return cachedir;
+  }
+  if (cachedir.back() != '/') {
+    cachedir += '/';
+  }
+  taco_uassert(mkdir(cachedir.c_str(), 0755) == 0 || errno == EEXIST) <<
+      "Unable to create the taco cache directory " << cachedir <<
+      ". Please set the environment variable TACO_CACHE_DIR to somewhere " <<
+      "writable";
+  return cachedir;
+}
+
+/// Evict the least recently used libraries from the cache directory until it
+/// is no larger than `TACO_CACHE_SIZE` megabytes.  The library named `keep`
+/// is never evicted.  Orphaned temporary files are removed as well.
+void evictCache(string cachedir, string keep) {
+  struct CachedLibrary {
+    string name;
+    time_t mtime;
+    off_t size;
+  };
+
+  size_t maxSize = getMaxCacheSize();
+  time_t now = time(nullptr);
+
+  DIR* dir = opendir(cachedir.c_str());
+  if (dir == nullptr) {
+    return;
+  }
+  map<string,CachedLibrary> libraries;
+  size_t totalSize = 0;
+  while (struct dirent* entry = readdir(dir)) {
+    string filename = entry->d_name;
+    size_t dot = filename.find('.');
+    if (dot == string::npos) {
+      continue;
+    }
+    string name = filename.substr(0, dot);
+    string extension = filename.substr(dot);
+    struct stat st;
+    if (stat((cachedir + filename).c_str(), &st) != 0) {
+      continue;
+    }
+    if (extension.size() > 4 &&
+        extension.compare(extension.size() - 4, 4, ".tmp") == 0) {
+      if (now - st.st_mtime > ORPHANED_TMP_AGE) {
+        remove((cachedir + filename).c_str());
+      }
+      continue;
+    }
+    if (extension != ".so" && extension != ".c") {
+      continue;
+    }
+    CachedLibrary& library = libraries[name];
+    library.name = name;
+    library.size += st.st_size;
+    if (extension == ".so") {
+      library.mtime = st.st_mtime;
+    }
+    totalSize += st.st_size;
+  }
+  closedir(dir);
+
+  vector<CachedLibrary> lru;
+  for (auto& library : libraries) {
+    lru.push_back(library.second);
+  }
+  sort(lru.begin(), lru.end(),
+       [](const CachedLibrary& a, const CachedLibrary& b) {
+         return a.mtime < b.mtime;
+       });
+
+  // Another process may concurrently evict the same library, in which case
+  // the removals below fail harmlessly
+  for (auto& library : lru) {
+    if (totalSize <= maxSize) {
+      break;
+    }
+    if (library.name == keep) {
+      continue;
+    }
+    remove((cachedir + library.name + ".so").c_str());
+    remove((cachedir + library.name + ".c").c_str());
+    totalSize -= library.size;
+  }
+}
+
+/// Returns the worker pool that runs asynchronous compiler invocations.  Its
+/// size is given by `TACO_COMPILE_THREADS`, which is read when the pool is
+/// first used, and defaults to one worker per hardware thread.
+util::ThreadPool& getCompilerPool() {
+  static util::ThreadPool pool(util::getSizeFromEnv("TACO_COMPILE_THREADS", 0));
+  return pool;
+}
+
 } // anonymous namespace
 
 string Module::compile() {
+  return prepareCompile()();
+}
+
+shared_future<void> Module::compileAsync() {
+  function<string()> build = prepareCompile();
+  compilation = getCompilerPool().submit([build]() { build(); }).share();
+  return compilation;
+}
+
+shared_future<void> Module::getCompilation() {
+  if (!compilation.valid()) {
+    promise<void> compiled;
+    compiled.set_value();
+    return compiled.get_future().share();
+  }
+  return compilation;
+}
+
+void Module::wait() {
+  if (compilation.valid()) {
+    compilation.wait();
+  }
+}
+
+function<string()> Module::prepareCompile() {
   string prefix = tmpdir+libname;
   string fullpath = prefix + ".so";
   
   string cc = util::getFromEnv("TACO_CC", "cc");
   string cflags = util::getFromEnv("TACO_CFLAGS",
     "-O3 -ffast-math -std=c99") + " -shared -fPIC";
-  
+
+  if (!moduleFromUserSource) {
+    generateSource();
+  }
+  string shims = generateShims(funcs);
+
+  // name cached libraries by their contents, so that any module that
+  // generates the same code with the same compiler command can reuse them
+  string cachedir = getCacheDir();
+  string cachename;
+  string output = fullpath;
+  if (cachedir != "") {
+    cachename = "taco_" + hashString(source.str() + header.str() + shims +
+                                     cc + " " + cflags);
+    fullpath = cachedir + cachename + ".so";
+    if (load(fullpath)) {
+      utime(fullpath.c_str(), nullptr);
+      return [fullpath]() { return fullpath; };
+    }
+    output = fullpath + uniqueTmpSuffix();
+  }
+
   string cmd = cc + " " + cflags + " " +
     prefix + ".c " +
     prefix + "_shims.c " +
-    "-o " + prefix + ".so";
+    "-o " + output;
 
   // open the output file & write out the source
-  compileToSource(tmpdir, libname);
+  writeSource(tmpdir, libname);
   
   // write out the shims
-  writeShims(funcs, tmpdir, libname);
-  
-  // now compile it
-  int err = system(cmd.data());
-  taco_uassert(err == 0) << "Compilation command failed:\n" << cmd
-    << "\nreturned " << err;
+  writeShims(shims, tmpdir, libname);
+
+  // the rest only touches the file system and this module's library handle,
+  // so it may run on another thread
+  string sourceText = source.str();
+  return [=]() {
+    int err = system(cmd.data());
+    taco_uassert(err == 0) << "Compilation command failed:\n" << cmd
+      << "\nreturned " << err;
 
-  // use dlsym() to open the compiled library
-  lib_handle = dlopen(fullpath.data(), RTLD_NOW | RTLD_LOCAL);
+    // publish the library with an atomic rename, so that concurrent processes
+    // never load a partially written library
+    if (cachedir != "") {
+      taco_uassert(rename(output.c_str(), fullpath.c_str()) == 0) <<
+          "Unable to move " << output << " into the taco cache directory";
 
-  return fullpath;
+      // keep the source next to the library for inspection
+      string sourcepath = cachedir + cachename + ".c";
+      string sourcetmp = sourcepath + uniqueTmpSuffix();
+      ofstream source_file;
+      source_file.open(sourcetmp);
+      source_file << sourceText;
+      source_file.close();
+      rename(sourcetmp.c_str(), sourcepath.c_str());
+
+      evictCache(cachedir, cachename);
+    }
+
+    taco_uassert(load(fullpath)) << "Failed to load " << fullpath << ": "
+                                 << dlerror();
+    return fullpath;
+  };
+}
+
+bool Module::load(string path) {
+  lib_handle = dlopen(path.data(), RTLD_NOW | RTLD_LOCAL);
+  if (lib_handle == nullptr) {
+    return false;
+  }
+
+  // resolve the function pointers up front so calls need not go through dlsym
+  funcPtrs.clear();
+  for (auto& func : funcs) {
+    string name = func.as<Function>()->name;
+    funcPtrs[name] = dlsym(lib_handle, name.data());
+    funcPtrs["_shim_"+name] = dlsym(lib_handle, ("_shim_"+name).data());
+  }
+  return true;
 }
 
 void Module::setSource(string source) {
@@ -126,6 +355,11 @@ string Module::getSource() {
 }
 
 void* Module::getFunc(std::string name) {
+  wait();
+  auto it = funcPtrs.find(name);
+  if (it != funcPtrs.end()) {
+    return it->second;
+  }
   return dlsym(lib_handle, name.data());
 }
 
@@ -3,6 +3,8 @@
 
 #include <map>
 #include <vector>
+#include <functional>
+#include <future>
 #include <string>
 #include <utility>
 
@@ -17,13 +19,37 @@ class Module {
 public:
   /// Create a module for some target
   Module(Target target=getTargetFromEnvironment())
-    : moduleFromUserSource(false), target(target) {
+    : lib_handle(nullptr), moduleFromUserSource(false), target(target) {
     setJITLibname();
     setJITTmpdir();
   }
 
-  /// Compile the source into a library, returning its full path
+  /// Waits for an asynchronous compilation to finish before unloading
+  ~Module() {
+    wait();
+  }
+
+  /// Compile the source into a library, returning its full path.  If the
+  /// `TACO_CACHE_DIR` environment variable is set then libraries are stored in
+  /// that directory, named by a hash of their source and the compiler command,
+  /// and reused by later modules (and processes) that generate the same code.
+  /// The directory is kept below `TACO_CACHE_SIZE` megabytes (default 1024)
+  /// by evicting the least recently used libraries.
   std::string compile();
+
+  /// Compile the source into a library on a worker thread.  Code generation
+  /// happens in the calling thread, while the C compiler runs on a bounded
+  /// pool of workers (`TACO_COMPILE_THREADS`, default one per hardware
+  /// thread) so that independent modules compile in parallel.  Returns a
+  /// future that is ready once the library is loaded.
+  std::shared_future<void> compileAsync();
+
+  /// Returns the future of the module's asynchronous compilation, or a ready
+  /// future if the module was compiled synchronously.
+  std::shared_future<void> getCompilation();
+
+  /// Block until an asynchronous compilation of this module has finished.
+  void wait();
   
   /// Compile the module into a source file located
   /// at the specified location path and prefix.  The generated
@@ -77,6 +103,13 @@ private:
   std::string tmpdir;
   void* lib_handle;
   std::vector<Stmt> funcs;
+
+  /// Function pointers of the module's functions and their shims, resolved
+  /// once when the library is loaded.
+  std::map<std::string, void*> funcPtrs;
+
+  /// The pending or finished asynchronous compilation, if any
+  std::shared_future<void> compilation;
   
   // true iff the module was created from user-provided source
   bool moduleFromUserSource;
@@ -85,6 +118,20 @@ private:
   
   void setJITLibname();
   void setJITTmpdir();
+
+  /// Generate the module source and header from the module functions
+  void generateSource();
+
+  /// Write the module source and header to path/prefix.{c,h}
+  void writeSource(std::string path, std::string prefix);
+
+  /// Generate and write out the module source, or load a cached library, and
+  /// return a function that builds and loads the library.
+  std::function<std::string()> prepareCompile();
+
+  /// Load the library at path and resolve the module's function pointers.
+  /// Returns false if the library could not be loaded.
+  bool load(std::string path);
 };
 
 } // namespace ir
@@ -8,16 +8,35 @@
 
 namespace taco {
 
+/// Singleton levels store one coordinate per parent position, so the parent
+/// must be a level with positions that are not shared by several coordinates.
+/// Diagonal levels store coordinates as offsets from the coordinate of their
+/// parent, which must be the dense first level of a matrix.
+static void checkModeTypes(const std::vector<ModeType>& modeTypes) {
+  for (size_t i = 0; i < modeTypes.size(); i++) {
+    taco_uassert(modeTypes[i] != Singleton ||
+                 (i > 0 && (modeTypes[i-1] == Sparse ||
+                            modeTypes[i-1] == Singleton)))
+        << "Singleton modes must follow a sparse or singleton mode";
+    taco_uassert(modeTypes[i] != Diagonal ||
+                 (i == 1 && modeTypes.size() == 2 && modeTypes[0] == Dense))
+        << "Diagonal modes must be the second mode of a matrix whose first "
+        << "mode is dense";
+  }
+}
+
 // class Format
 Format::Format() {
 }
 
 Format::Format(const ModeType& modeType) {
+  checkModeTypes({modeType});
   this->modeTypes.push_back(modeType);
   this->modeOrdering.push_back(0);
 }
 
 Format::Format(const std::vector<ModeType>& modeTypes) {
+  checkModeTypes(modeTypes);
   this->modeTypes = modeTypes;
   this->modeOrdering.resize(modeTypes.size());
   taco_uassert(modeTypes.size() <= INT_MAX) << "Supports only INT_MAX modes";
@@ -30,6 +49,7 @@ Format::Format(const std::vector<ModeType>& modeTypes,
                const std::vector<size_t>& modeOrdering) {
   taco_uassert(modeTypes.size() == modeOrdering.size()) <<
       "You must either provide a complete mode ordering or none";
+  checkModeTypes(modeTypes);
   this->modeTypes = modeTypes;
   this->modeOrdering = modeOrdering;
 }
@@ -47,6 +67,11 @@ const std::vector<size_t>& Format::getModeOrdering() const {
   return this->modeOrdering;
 }
 
+bool Format::isUnique(size_t level) const {
+  taco_iassert(level < getOrder());
+  return level + 1 == getOrder() || modeTypes[level + 1] != Singleton;
+}
+
 const std::vector<std::vector<DataType>>& Format::getLevelArrayTypes() const {
   return this->levelArrayTypes;
 }
@@ -56,7 +81,8 @@ DataType Format::getCoordinateTypePos(int level) const {
 }
 
 DataType Format::getCoordinateTypeIdx(int level) const {
-  if (modeTypes[level] == Sparse) {
+  if (modeTypes[level] == Sparse || modeTypes[level] == Fixed ||
+      modeTypes[level] == Hashed || modeTypes[level] == Diagonal) {
     return levelArrayTypes[level][1];
   }
   return levelArrayTypes[level][0];
@@ -66,6 +92,16 @@ void Format::setLevelArrayTypes(std::vector<std::vector<DataType>> levelArrayTyp
   this->levelArrayTypes = levelArrayTypes;
 }
 
+size_t Format::getFixedSize(int level) const {
+  taco_iassert((size_t)level < getOrder());
+  return ((size_t)level < fixedSizes.size()) ? fixedSizes[level] : 0;
+}
+
+void Format::setFixedSizes(std::vector<size_t> fixedSizes) {
+  taco_iassert(fixedSizes.size() == getOrder());
+  this->fixedSizes = fixedSizes;
+}
+
 
 bool operator==(const Format& a, const Format& b){
   auto aModeTypes = a.getModeTypes();
@@ -104,6 +140,18 @@ std::ostream& operator<<(std::ostream& os, const ModeType& modeType) {
     case ModeType::Fixed:
       os << "fixed";
       break;
+    case ModeType::Singleton:
+      os << "singleton";
+      break;
+    case ModeType::Hashed:
+      os << "hashed";
+      break;
+    case ModeType::Bitmap:
+      os << "bitmap";
+      break;
+    case ModeType::Diagonal:
+      os << "diagonal";
+      break;
   }
   return os;
 }
@@ -113,6 +161,7 @@ const Format CSR({Dense, Sparse}, {0,1});
 const Format CSC({Dense, Sparse}, {1,0});
 const Format DCSR({Sparse, Sparse}, {0,1});
 const Format DCSC({Sparse, Sparse}, {1,0});
+const Format BCSR({Dense, Sparse, Dense, Dense}, {0,1,2,3});
 
 bool isDense(const Format& format) {
   for (ModeType modeType : format.getModeTypes()) {
@@ -1095,6 +1095,14 @@ void TensorVar::setName(std::string name) {
   content->name = name;
 }
 
+void TensorVar::setFormat(const Format& format) {
+  content->format = format;
+}
+
+void TensorVar::setSchedule(const Schedule& schedule) {
+  content->schedule = schedule;
+}
+
 void TensorVar::setAssignment(Assignment assignment) {
   auto freeVars = assignment.getLhs().getIndexVars();
   auto indexExpr = assignment.getRhs();
@@ -1,8 +1,10 @@
 #include "taco/index_notation/schedule.h"
 
+#include <algorithm>
 #include <map>
 
 #include "taco/index_notation/index_notation.h"
+#include "taco/error.h"
 #include "taco/util/collections.h"
 #include "taco/util/strings.h"
 
@@ -49,9 +51,52 @@ std::ostream& operator<<(std::ostream& os, const OperatorSplit& split) {
 }
 
 
+// class IndexVarSplit
+struct IndexVarSplit::Content {
+  IndexVar var;
+  IndexVar outer;
+  IndexVar inner;
+  size_t factor;
+};
+
+IndexVarSplit::IndexVarSplit(IndexVar var, IndexVar outer, IndexVar inner,
+                             size_t factor) : content(new Content) {
+  content->var = var;
+  content->outer = outer;
+  content->inner = inner;
+  content->factor = factor;
+}
+
+IndexVar IndexVarSplit::getVar() const {
+  return content->var;
+}
+
+IndexVar IndexVarSplit::getOuter() const {
+  return content->outer;
+}
+
+IndexVar IndexVarSplit::getInner() const {
+  return content->inner;
+}
+
+size_t IndexVarSplit::getFactor() const {
+  return content->factor;
+}
+
+std::ostream& operator<<(std::ostream& os, const IndexVarSplit& split) {
+  return os << split.getVar() << " -> (" << split.getOuter() << ", "
+            << split.getInner() << ") by " << split.getFactor();
+}
+
+
 // class Schedule
 struct Schedule::Content {
   map<IndexExpr, vector<OperatorSplit>> operatorSplits;
+  vector<IndexVarSplit> splits;
+  vector<IndexVar> loopOrder;
+  bool autoReorder = false;
+  map<IndexVar,size_t> unrollFactors;
+  map<IndexVar,bool> parallelLoops;
 };
 
 Schedule::Schedule() : content(new Content) {
@@ -80,12 +125,85 @@ void Schedule::clearOperatorSplits() {
   content->operatorSplits.clear();
 }
 
+void Schedule::split(IndexVar var, IndexVar outer, IndexVar inner,
+                     size_t factor) {
+  taco_uassert(factor > 0) << "Loops must be split into blocks of at least " <<
+      "one iteration";
+  for (auto& split : content->splits) {
+    taco_uassert(split.getVar() != var && split.getInner() != var) <<
+        "The loop over " << var << " is already split";
+  }
+  content->splits.push_back(IndexVarSplit(var, outer, inner, factor));
+}
+
+void Schedule::reorder(std::vector<IndexVar> vars) {
+  for (size_t i = 0; i < vars.size(); i++) {
+    taco_uassert(std::count(vars.begin(), vars.end(), vars[i]) == 1) <<
+        "The loop order lists " << vars[i] << " more than once";
+  }
+  content->loopOrder = vars;
+}
+
+void Schedule::autoReorder() {
+  content->autoReorder = true;
+}
+
+void Schedule::unroll(IndexVar var, size_t factor) {
+  taco_uassert(factor > 0) << "Loops must be unrolled at least once";
+  content->unrollFactors[var] = factor;
+}
+
+void Schedule::parallelize(IndexVar var, bool parallel) {
+  content->parallelLoops[var] = parallel;
+}
+
+std::vector<IndexVarSplit> Schedule::getSplits() const {
+  return content->splits;
+}
+
+std::vector<IndexVar> Schedule::getLoopOrder() const {
+  return content->loopOrder;
+}
+
+bool Schedule::getAutoReorder() const {
+  return content->autoReorder;
+}
+
+std::map<IndexVar,size_t> Schedule::getUnrollFactors() const {
+  return content->unrollFactors;
+}
+
+std::map<IndexVar,bool> Schedule::getParallelLoops() const {
+  return content->parallelLoops;
+}
+
 std::ostream& operator<<(std::ostream& os, const Schedule& schedule) {
+  vector<string> directives;
   auto operatorSplits = schedule.getOperatorSplits();
   if (operatorSplits.size() > 0) {
-    os << "Operator Splits:" << endl << util::join(operatorSplits, "\n");
+    directives.push_back("Operator Splits:\n" +
+                         util::join(operatorSplits, "\n"));
+  }
+  auto splits = schedule.getSplits();
+  if (splits.size() > 0) {
+    directives.push_back("Splits:\n" + util::join(splits, "\n"));
+  }
+  auto loopOrder = schedule.getLoopOrder();
+  if (loopOrder.size() > 0) {
+    directives.push_back("Loop Order: " + util::join(loopOrder));
+  }
+  else if (schedule.getAutoReorder()) {
+    directives.push_back("Loop Order: automatic");
+  }
+  for (auto& unroll : schedule.getUnrollFactors()) {
+    directives.push_back("Unroll: " + util::toString(unroll.first) + " by " +
+                         util::toString(unroll.second));
+  }
+  for (auto& parallel : schedule.getParallelLoops()) {
+    directives.push_back((parallel.second ? "Parallel: " : "Serial: ") +
+                         util::toString(parallel.first));
   }
-  return os;
+  return os << util::join(directives, "\n");
 }
 
 }
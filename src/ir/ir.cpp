@@ -232,6 +232,29 @@ Expr BitOr::make(Expr a, Expr b) {
   return bitOr;
 }
 
+Expr Shl::make(Expr a, Expr b) {
+  Shl *shl = new Shl;
+  shl->type = a.type();
+  shl->a = a;
+  shl->b = b;
+  return shl;
+}
+
+Expr Shr::make(Expr a, Expr b) {
+  Shr *shr = new Shr;
+  shr->type = a.type();
+  shr->a = a;
+  shr->b = b;
+  return shr;
+}
+
+Expr Popcount::make(Expr a) {
+  Popcount *popcount = new Popcount;
+  popcount->type = Int();
+  popcount->a = a;
+  return popcount;
+}
+
 // Boolean binary ops
 Expr Eq::make(Expr a, Expr b) {
   Eq *eq = new Eq;
@@ -304,6 +327,17 @@ Expr Cast::make(Expr a, DataType newType) {
   return cast;
 }
 
+Expr Ternary::make(Expr cond, Expr a, Expr b) {
+  taco_iassert(a.type() == b.type()) <<
+      "Both operands of a ternary must have the same type";
+  Ternary *ternary = new Ternary;
+  ternary->type = a.type();
+  ternary->cond = cond;
+  ternary->a = a;
+  ternary->b = b;
+  return ternary;
+}
+
 // Load from an array
 Expr Load::make(Expr arr) {
   return Load::make(arr, Literal::make((long long)0));
@@ -330,18 +364,20 @@ Stmt Block::make(std::vector<Stmt> b) {
 }
 
 // Scope
-Stmt Scope::make(Stmt scopedStmt) {
+Stmt Scope::make(Stmt scopedStmt, bool braced) {
   Scope *scope = new Scope;
   scope->scopedStmt = scopedStmt;
+  scope->braced = braced;
   return scope;
 }
 
 // Store to an array
-Stmt Store::make(Expr arr, Expr loc, Expr data) {
+Stmt Store::make(Expr arr, Expr loc, Expr data, bool use_atomics) {
   Store *store = new Store;
   store->arr = arr;
   store->loc = loc;
   store->data = data;
+  store->use_atomics = use_atomics;
   return store;
 }
 
@@ -398,7 +434,11 @@ Stmt Switch::make(std::vector<std::pair<Expr,Stmt>> cases, Expr controlExpr) {
 
 // For loop
 Stmt For::make(Expr var, Expr start, Expr end, Expr increment, Stmt contents,
-  LoopKind kind, int vec_width) {
+  LoopKind kind, int vec_width,
+  std::vector<Expr> reductions) {
+  taco_iassert(reductions.empty() ||
+               kind == LoopKind::Static || kind == LoopKind::Dynamic) <<
+      "Only parallel loops can have reductions";
   For *loop = new For;
   loop->var = var;
   loop->start = start;
@@ -407,6 +447,7 @@ Stmt For::make(Expr var, Expr start, Expr end, Expr increment, Stmt contents,
   loop->contents = Scope::make(contents);
   loop->kind = kind;
   loop->vec_width = vec_width;
+  loop->reductions = reductions;
   return loop;
 }
 
@@ -457,6 +498,15 @@ Stmt Allocate::make(Expr var, Expr num_elements, bool is_realloc) {
   return alloc;
 }
 
+// Free
+Stmt Free::make(Expr var) {
+  taco_iassert(var.as<Var>() && var.as<Var>()->is_ptr) <<
+      "Can only free memory of a pointer-typed Var";
+  Free* free = new Free;
+  free->var = var;
+  return free;
+}
+
 // Comment
 Stmt Comment::make(std::string text) {
   Comment* comment = new Comment;
@@ -477,6 +527,21 @@ Stmt Print::make(std::string fmt, std::vector<Expr> params) {
   return pr;
 }
   
+/// Returns the element type of an index array of a tensor, as given by the
+/// level array types of its format.
+static DataType getIndexArrayType(Expr tensor, int mode, int index) {
+  const Var* tensorVar = tensor.as<Var>();
+  if (tensorVar == nullptr) {
+    return Int();
+  }
+  const auto& levelArrayTypes = tensorVar->format.getLevelArrayTypes();
+  if ((size_t)mode < levelArrayTypes.size() &&
+      (size_t)index < levelArrayTypes[mode].size()) {
+    return levelArrayTypes[mode][index];
+  }
+  return Int();
+}
+
 Expr GetProperty::make(Expr tensor, TensorProperty property, int mode,
                        int index, std::string name) {
   GetProperty* gp = new GetProperty;
@@ -490,7 +555,7 @@ Expr GetProperty::make(Expr tensor, TensorProperty property, int mode,
   if (property == TensorProperty::Values)
     gp->type = tensor.type();
   else
-    gp->type = Int();
+    gp->type = getIndexArrayType(tensor, mode, index);
   
   return gp;
 }
@@ -564,6 +629,12 @@ template<> void ExprNode<BitAnd>::accept(IRVisitorStrict *v)
     const { v->visit((const BitAnd*)this); }
 template<> void ExprNode<BitOr>::accept(IRVisitorStrict *v)
     const { v->visit((const BitOr*)this); }
+template<> void ExprNode<Shl>::accept(IRVisitorStrict *v)
+    const { v->visit((const Shl*)this); }
+template<> void ExprNode<Shr>::accept(IRVisitorStrict *v)
+    const { v->visit((const Shr*)this); }
+template<> void ExprNode<Popcount>::accept(IRVisitorStrict *v)
+    const { v->visit((const Popcount*)this); }
 template<> void ExprNode<Eq>::accept(IRVisitorStrict *v)
     const { v->visit((const Eq*)this); }
 template<> void ExprNode<Neq>::accept(IRVisitorStrict *v)
@@ -582,6 +653,8 @@ template<> void ExprNode<Or>::accept(IRVisitorStrict *v)
     const { v->visit((const Or*)this); }
 template<> void ExprNode<Cast>::accept(IRVisitorStrict *v)
     const { v->visit((const Cast*)this); }
+template<> void ExprNode<Ternary>::accept(IRVisitorStrict *v)
+    const { v->visit((const Ternary*)this); }
 template<> void StmtNode<IfThenElse>::accept(IRVisitorStrict *v)
     const { v->visit((const IfThenElse*)this); }
 template<> void StmtNode<Case>::accept(IRVisitorStrict *v)
@@ -606,6 +679,8 @@ template<> void StmtNode<VarAssign>::accept(IRVisitorStrict *v)
     const { v->visit((const VarAssign*)this); }
 template<> void StmtNode<Allocate>::accept(IRVisitorStrict *v)
     const { v->visit((const Allocate*)this); }
+template<> void StmtNode<Free>::accept(IRVisitorStrict *v)
+    const { v->visit((const Free*)this); }
 template<> void StmtNode<Comment>::accept(IRVisitorStrict *v)
     const { v->visit((const Comment*)this); }
 template<> void StmtNode<BlankLine>::accept(IRVisitorStrict *v)
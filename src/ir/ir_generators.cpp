@@ -1,13 +1,18 @@
 #include "ir_generators.h"
 
+#include <map>
+
 #include "taco/ir/ir.h"
+#include "taco/ir/ir_visitor.h"
+#include "taco/ir/ir_rewriter.h"
 #include "taco/error.h"
 
 namespace taco {
 namespace ir {
 
-ir::Stmt compoundStore(ir::Expr arr, ir::Expr loc, ir::Expr val) {
-  return Store::make(arr, loc, Add::make(Load::make(arr, loc), val));
+ir::Stmt compoundStore(ir::Expr arr, ir::Expr loc, ir::Expr val,
+                       bool atomic) {
+  return Store::make(arr, loc, Add::make(Load::make(arr, loc), val), atomic);
 }
 
 ir::Stmt compoundAssign(ir::Expr lhs, ir::Expr rhs) {
@@ -23,4 +28,101 @@ Expr conjunction(std::vector<Expr> exprs) {
   return conjunction;
 }
 
+namespace {
+
+struct LoopFinder : public IRVisitor {
+  using IRVisitor::visit;
+  bool found = false;
+
+  void visit(const For*) {
+    found = true;
+  }
+
+  void visit(const While*) {
+    found = true;
+  }
+};
+
+struct IterationCopier : public IRRewriter {
+  using IRRewriter::visit;
+  std::map<Expr,Expr,ExprCompare> substitutions;
+
+  void visit(const Var* op) {
+    expr = (substitutions.count(op) > 0) ? substitutions.at(op) : op;
+  }
+
+  void visit(const VarAssign* op) {
+    Expr rhs = rewrite(op->rhs);
+    if (op->is_decl) {
+      const Var* var = op->lhs.as<Var>();
+      taco_iassert(var != nullptr);
+      substitutions[op->lhs] = Var::make(var->name, var->type, var->is_ptr);
+    }
+    stmt = VarAssign::make(rewrite(op->lhs), rhs, op->is_decl);
+  }
+};
+
+}
+
+bool containsLoop(Stmt stmt) {
+  LoopFinder finder;
+  stmt.accept(&finder);
+  return finder.found;
+}
+
+Stmt unroll(Stmt loop) {
+  const For* forLoop = loop.as<For>();
+  taco_iassert(forLoop != nullptr);
+  const Literal* start = forLoop->start.as<Literal>();
+  const Literal* end = forLoop->end.as<Literal>();
+  const Literal* increment = forLoop->increment.as<Literal>();
+  taco_iassert(start != nullptr && end != nullptr && increment != nullptr &&
+               increment->int_value > 0) << "Only loops with literal bounds " <<
+      "can be unrolled";
+
+  Stmt body = to<Scope>(forLoop->contents)->scopedStmt;
+  std::vector<Stmt> iterations;
+  for (long long i = start->int_value; i < end->int_value;
+       i += increment->int_value) {
+    IterationCopier copier;
+    copier.substitutions[forLoop->var] = Literal::make(i);
+    iterations.push_back(copier.rewrite(body));
+  }
+  return Block::make(iterations);
+}
+
+Stmt unroll(Stmt loop, long long factor) {
+  const For* forLoop = loop.as<For>();
+  taco_iassert(forLoop != nullptr);
+  taco_iassert(isa<Literal>(forLoop->increment) &&
+               to<Literal>(forLoop->increment)->int_value == 1) <<
+      "Only loops with an increment of one can be unrolled by a factor";
+  taco_iassert(factor > 0);
+
+  Stmt body = to<Scope>(forLoop->contents)->scopedStmt;
+  std::vector<Stmt> iterations;
+  for (long long i = 0; i < factor; i++) {
+    IterationCopier copier;
+    if (i > 0) {
+      copier.substitutions[forLoop->var] = Add::make(forLoop->var, i);
+    }
+    iterations.push_back(copier.rewrite(body));
+  }
+
+  // for (j = start; j < start + (end - start) / factor * factor; j += factor)
+  Expr start = forLoop->start;
+  bool startsAtZero = isa<Literal>(start) && to<Literal>(start)->int_value == 0;
+  Expr tripCount = startsAtZero ? forLoop->end : Sub::make(forLoop->end, start);
+  Expr unrolledEnd = Mul::make(Div::make(tripCount, factor), factor);
+  if (!startsAtZero) {
+    unrolledEnd = Add::make(start, unrolledEnd);
+  }
+  Stmt unrolled = For::make(forLoop->var, start, unrolledEnd, factor,
+                            Block::make(iterations), forLoop->kind,
+                            forLoop->vec_width, forLoop->reductions);
+  Stmt remainder = For::make(forLoop->var, unrolledEnd, forLoop->end,
+                             (long long) 1, body);
+  return Block::make({unrolled, remainder});
+}
+
 }}
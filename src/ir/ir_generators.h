@@ -9,8 +9,8 @@ namespace ir {
 class Expr;
 class Stmt;
 
-/// Add `val` to `arr[loc]`
-Stmt compoundStore(Expr arr, Expr loc, Expr val);
+/// Add `val` to `arr[loc]`, as one indivisible update if `atomic` is true
+Stmt compoundStore(Expr arr, Expr loc, Expr val, bool atomic=false);
 
 /// Add `val` to `var`
 Stmt compoundAssign(Expr var, Expr val);
@@ -18,5 +18,18 @@ Stmt compoundAssign(Expr var, Expr val);
 /// Returns a conjunction (and) of `exprs`
 Expr conjunction(std::vector<Expr> exprs);
 
+/// Returns true iff `stmt` contains a for or while loop
+bool containsLoop(Stmt stmt);
+
+/// Returns the body of `loop`, a for loop with literal bounds and increment,
+/// repeated once per iteration with the loop variable replaced by its value.
+/// Variables declared in the body get a fresh variable in every copy.
+Stmt unroll(Stmt loop);
+
+/// Returns `loop`, a for loop with an increment of one, with its body repeated
+/// `factor` times per iteration, followed by a loop over the iterations that
+/// remain. Variables declared in the body get a fresh variable in every copy.
+Stmt unroll(Stmt loop, long long factor);
+
 }}
 #endif
@@ -146,6 +146,21 @@ void IRPrinter::visit(const BitOr* op){
   printBinOp(op->a, op->b, "|", Precedence::BOR);
 }
 
+void IRPrinter::visit(const Shl* op){
+  printBinOp(op->a, op->b, "<<", Precedence::SHIFT);
+}
+
+void IRPrinter::visit(const Shr* op){
+  printBinOp(op->a, op->b, ">>", Precedence::SHIFT);
+}
+
+void IRPrinter::visit(const Popcount* op){
+  stream << "popcount(";
+  parentPrecedence = Precedence::TOP;
+  op->a.accept(this);
+  stream << ")";
+}
+
 void IRPrinter::visit(const Eq* op){
   printBinOp(op->a, op->b, "==", Precedence::EQ);
 }
@@ -184,6 +199,24 @@ void IRPrinter::visit(const Cast* op) {
   op->a.accept(this);
 }
 
+void IRPrinter::visit(const Ternary* op) {
+  bool parenthesize = Precedence::TERNARY > parentPrecedence;
+  if (parenthesize) {
+    stream << "(";
+  }
+  parentPrecedence = Precedence::LOR;
+  op->cond.accept(this);
+  stream << " ? ";
+  parentPrecedence = Precedence::LOR;
+  op->a.accept(this);
+  stream << " : ";
+  parentPrecedence = Precedence::TERNARY;
+  op->b.accept(this);
+  if (parenthesize) {
+    stream << ")";
+  }
+}
+
 void IRPrinter::visit(const IfThenElse* op) {
   taco_iassert(op->cond.defined());
   taco_iassert(op->then.defined());
@@ -357,11 +390,20 @@ void IRPrinter::visit(const Block* op) {
 }
 
 void IRPrinter::visit(const Scope* op) {
+  if (op->braced) {
+    doIndent();
+    stream << "{\n";
+  }
   varNames.scope();
   indent++;
   op->scopedStmt.accept(this);
   indent--;
   varNames.unscope();
+  if (op->braced) {
+    stream << "\n";
+    doIndent();
+    stream << "}";
+  }
 }
 
 void IRPrinter::visit(const Function* op) {
@@ -436,6 +478,12 @@ void IRPrinter::visit(const Allocate* op) {
   stream << "]";
 }
 
+void IRPrinter::visit(const Free* op) {
+  doIndent();
+  stream << "free ";
+  op->var.accept(this);
+}
+
 void IRPrinter::visit(const Comment* op) {
   doIndent();
   stream << commentString(op->text);
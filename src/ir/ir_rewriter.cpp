@@ -128,6 +128,18 @@ void IRRewriter::visit(const BitOr* op) {
   expr = visitBinaryOp(op, this);
 }
 
+void IRRewriter::visit(const Shl* op) {
+  expr = visitBinaryOp(op, this);
+}
+
+void IRRewriter::visit(const Shr* op) {
+  expr = visitBinaryOp(op, this);
+}
+
+void IRRewriter::visit(const Popcount* op) {
+  expr = visitUnaryOp(op, this);
+}
+
 void IRRewriter::visit(const Eq* op) {
   expr = visitBinaryOp(op, this);
 }
@@ -170,6 +182,18 @@ void IRRewriter::visit(const Cast* op) {
   }
 }
 
+void IRRewriter::visit(const Ternary* op) {
+  Expr cond = rewrite(op->cond);
+  Expr a    = rewrite(op->a);
+  Expr b    = rewrite(op->b);
+  if (cond == op->cond && a == op->a && b == op->b) {
+    expr = op;
+  }
+  else {
+    expr = Ternary::make(cond, a, b);
+  }
+}
+
 void IRRewriter::visit(const IfThenElse* op) {
   Expr cond      = rewrite(op->cond);
   Stmt then      = rewrite(op->then);
@@ -241,7 +265,7 @@ void IRRewriter::visit(const Store* op) {
     stmt = op;
   }
   else {
-    stmt = Store::make(arr, loc, data);
+    stmt = Store::make(arr, loc, data, op->use_atomics);
   }
 }
 
@@ -251,13 +275,23 @@ void IRRewriter::visit(const For* op) {
   Expr end       = rewrite(op->end);
   Expr increment = rewrite(op->increment);
   Stmt contents  = rewrite(op->contents);
+  vector<Expr> reductions;
+  bool reductionsSame = true;
+  for (auto& reduction : op->reductions) {
+    Expr reduced = rewrite(reduction);
+    reductions.push_back(reduced);
+    if (reduced != reduction) {
+      reductionsSame = false;
+    }
+  }
   if (var == op->var && start == op->start && end == op->end &&
-      increment == op->increment && contents == op->contents) {
+      increment == op->increment && contents == op->contents &&
+      reductionsSame) {
     stmt = op;
   }
   else {
     stmt = For::make(var, start, end, increment, contents, op->kind,
-                     op->vec_width);
+                     op->vec_width, reductions);
   }
 }
 
@@ -300,7 +334,7 @@ void IRRewriter::visit(const Scope* op) {
     stmt = op;
   }
   else {
-    stmt = Scope::make(scopedStmt);
+    stmt = Scope::make(scopedStmt, op->braced);
   }
 }
 
@@ -353,6 +387,16 @@ void IRRewriter::visit(const Allocate* op) {
   }
 }
 
+void IRRewriter::visit(const Free* op) {
+  Expr var = rewrite(op->var);
+  if (var == op->var) {
+    stmt = op;
+  }
+  else {
+    stmt = Free::make(var);
+  }
+}
+
 void IRRewriter::visit(const Comment* op) {
   stmt = op;
 }
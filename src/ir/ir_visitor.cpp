@@ -74,6 +74,20 @@ void IRVisitor::visit(const BitOr* op){
   op->b.accept(this);
 }
 
+void IRVisitor::visit(const Shl* op){
+  op->a.accept(this);
+  op->b.accept(this);
+}
+
+void IRVisitor::visit(const Shr* op){
+  op->a.accept(this);
+  op->b.accept(this);
+}
+
+void IRVisitor::visit(const Popcount* op){
+  op->a.accept(this);
+}
+
 void IRVisitor::visit(const Eq* op){
   op->a.accept(this);
   op->b.accept(this);
@@ -118,6 +132,12 @@ void IRVisitor::visit(const Cast* op){
   op->a.accept(this);
 }
 
+void IRVisitor::visit(const Ternary* op){
+  op->cond.accept(this);
+  op->a.accept(this);
+  op->b.accept(this);
+}
+
 void IRVisitor::visit(const IfThenElse* op) {
   op->cond.accept(this);
   op->then.accept(this);
@@ -158,6 +178,9 @@ void IRVisitor::visit(const For* op) {
   op->start.accept(this);
   op->end.accept(this);
   op->increment.accept(this);
+  for (auto& reduction : op->reductions) {
+    reduction.accept(this);
+  }
   op->contents.accept(this);
 }
 
@@ -189,6 +212,10 @@ void IRVisitor::visit(const Allocate* op) {
   op->num_elements.accept(this);
 }
 
+void IRVisitor::visit(const Free* op) {
+  op->var.accept(this);
+}
+
 void IRVisitor::visit(const GetProperty* op) {
   op->tensor.accept(this);
 }
@@ -162,6 +162,9 @@ ir::Stmt simplify(const ir::Stmt& stmt) {
       varsToReplace.scope();
       stmt = rewrite(scope->scopedStmt);
       varsToReplace.unscope();
+      if (scope->braced) {
+        stmt = Scope::make(stmt, true);
+      }
     }
 
     void visit(const VarAssign* assign) {
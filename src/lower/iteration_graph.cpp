@@ -2,6 +2,8 @@
 
 #include <set>
 #include <vector>
+#include <limits>
+#include <algorithm>
 #include <queue>
 #include <functional>
 
@@ -49,6 +51,41 @@ struct IterationGraph::Content {
 IterationGraph::IterationGraph() {
 }
 
+/// Returns true iff the paths order some index variable before itself.
+static bool hasCycle(const vector<TensorPath>& paths) {
+  map<IndexVar,set<IndexVar>> successors;
+  for (auto& path : paths) {
+    auto& vars = path.getVariables();
+    for (size_t i = 1; i < vars.size(); i++) {
+      successors[vars[i-1]].insert(vars[i]);
+    }
+  }
+
+  // Depth-first search that finds variables on the current search path
+  map<IndexVar,bool> onPath;
+  function<bool(const IndexVar&)> reachesPath = [&](const IndexVar& var) {
+    if (util::contains(onPath, var)) {
+      return onPath.at(var);
+    }
+    onPath.insert({var, true});
+    for (auto& successor : successors[var]) {
+      if (reachesPath(successor)) {
+        return true;
+      }
+    }
+    onPath.at(var) = false;
+    return false;
+  };
+  for (auto& path : paths) {
+    for (auto& var : path.getVariables()) {
+      if (reachesPath(var)) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
 IterationGraph IterationGraph::make(const TensorVar& tensor) {
   Assignment assignment = tensor.getAssignment();
   IndexExpr expr = assignment.getRhs();
@@ -124,10 +161,39 @@ IterationGraph IterationGraph::make(const TensorVar& tensor) {
     resultVars.push_back(freeVars[idx]);
   }
   TensorPath resultPath = TensorPath(resultVars, Access(tensor, freeVars));
+  vector<TensorPath> paths = util::combine({resultPath}, tensorPaths);
+
+  // Order the loops as the schedule lists them, by adding a path through the
+  // listed index variables. Inner loops of splits iterate over the split
+  // variables, while their outer loops are placed when the graph is lowered.
+  const Schedule& schedule = tensor.getSchedule();
+  map<IndexVar,IndexVar> innerToSplitVar;
+  set<IndexVar> outerVars;
+  for (auto& split : schedule.getSplits()) {
+    innerToSplitVar.insert({split.getInner(), split.getVar()});
+    outerVars.insert(split.getOuter());
+  }
+  vector<IndexVar> loopOrder;
+  for (auto& var : schedule.getLoopOrder()) {
+    if (util::contains(outerVars, var)) {
+      continue;
+    }
+    IndexVar loopVar = util::contains(innerToSplitVar, var)
+                       ? innerToSplitVar.at(var) : var;
+    taco_uassert(util::contains(indexVarDomains, loopVar)) <<
+        "The loop order lists " << var << ", which " << assignment <<
+        " does not use";
+    loopOrder.push_back(loopVar);
+  }
+  if (loopOrder.size() > 1) {
+    paths.push_back(TensorPath(loopOrder, Access()));
+    taco_uassert(!hasCycle(paths)) <<
+        "The loop order (" << util::join(schedule.getLoopOrder()) << ") " <<
+        "conflicts with the order of the modes of " << assignment;
+  }
 
   // Construct a forest decomposition from the tensor path graph
-  IterationForest forest =
-      IterationForest(util::combine({resultPath}, tensorPaths));
+  IterationForest forest = IterationForest(paths);
 
   // Create the iteration graph
   IterationGraph iterationGraph = IterationGraph();
@@ -138,6 +204,174 @@ IterationGraph IterationGraph::make(const TensorVar& tensor) {
   return iterationGraph;
 }
 
+/// The fraction of coordinates assumed to be stored in the fibers of compressed
+/// levels of operands that have not been packed.
+static const double ASSUMED_DENSITY = 0.1;
+
+/// The maximum number of index variables whose loop orders are enumerated.
+static const size_t MAX_REORDERED_VARS = 8;
+
+namespace {
+/// A level of a tensor that a loop iterates over or locates into.
+struct LevelAccess {
+  double fiberSize;
+  bool   dense;
+  bool   result;
+};
+}
+
+/// Estimates the cost of a loop nest as the number of level accesses and merge
+/// steps it performs, given the levels each loop iterates over.
+static double estimateCost(const vector<IndexVar>& order,
+                           const map<IndexVar,vector<LevelAccess>>& levels,
+                           const map<IndexVar,double>& dimensions,
+                           bool conjunctive) {
+  double cost = 0.0;
+  double iterations = 1.0;
+  for (auto& var : order) {
+    double dimension = dimensions.at(var);
+    double tripCount = conjunctive ? dimension : 0.0;
+    double accesses = 0.0;
+    size_t mergedLevels = 0;
+    bool hasDenseOperand = false;
+    for (auto& level : levels.at(var)) {
+      if (level.result) {
+        accesses += 1.0;
+        continue;
+      }
+      // Compressed levels load a position and a coordinate per iteration
+      accesses += level.dense ? 1.0 : 2.0;
+      hasDenseOperand |= level.dense;
+      if (!level.dense) {
+        mergedLevels++;
+      }
+      tripCount = conjunctive ? min(tripCount, level.fiberSize)
+                              : tripCount + level.fiberSize;
+    }
+    if (!conjunctive && (hasDenseOperand || tripCount == 0.0)) {
+      tripCount = dimension;
+    }
+    iterations *= min(tripCount, dimension);
+    cost += iterations * accesses;
+    if (mergedLevels > 1) {
+      cost += iterations * mergedLevels;
+    }
+  }
+  return cost;
+}
+
+vector<IndexVar> IterationGraph::selectLoopOrder(
+    const TensorVar& tensor,
+    const map<TensorVar,vector<size_t>>& levelSizes) {
+  IterationGraph graph = IterationGraph::make(tensor);
+  Assignment assignment = tensor.getAssignment();
+
+  // Only loop nests without branches are reordered, and only while they are
+  // small enough to enumerate their orders
+  if (graph.getRoots().size() != 1 ||
+      tensor.getSchedule().getOperatorSplits().size() > 0) {
+    return {};
+  }
+  vector<IndexVar> defaultOrder = graph.getDescendants(graph.getRoots()[0]);
+  for (auto& var : defaultOrder) {
+    if (graph.getChildren(var).size() > 1) {
+      return {};
+    }
+  }
+  if (defaultOrder.size() > MAX_REORDERED_VARS) {
+    return {};
+  }
+
+  map<IndexVar,double> dimensions;
+  for (auto& domain : assignment.getIndexVarDomains()) {
+    if (!domain.second.isFixed()) {
+      return {};
+    }
+    dimensions.insert({domain.first, (double)domain.second.getSize()});
+  }
+
+  bool conjunctive = true;
+  match(assignment.getRhs(),
+    function<void(const AddNode*)>([&](const AddNode*) {
+      conjunctive = false;
+    }),
+    function<void(const SubNode*)>([&](const SubNode*) {
+      conjunctive = false;
+    })
+  );
+
+  // Gather the levels each loop accesses and the order the paths require
+  map<IndexVar,vector<LevelAccess>> levels;
+  map<IndexVar,set<IndexVar>> predecessors;
+  for (auto& var : defaultOrder) {
+    levels.insert({var, vector<LevelAccess>()});
+    predecessors.insert({var, set<IndexVar>()});
+  }
+  const TensorPath& resultPath = graph.getResultTensorPath();
+  for (auto& path : util::combine({resultPath}, graph.getTensorPaths())) {
+    const TensorVar& tensorVar = path.getAccess().getTensorVar();
+    const Format& format = tensorVar.getFormat();
+    vector<size_t> sizes;
+    if (util::contains(levelSizes, tensorVar)) {
+      sizes = levelSizes.at(tensorVar);
+    }
+    auto& vars = path.getVariables();
+    for (size_t l = 0; l < vars.size(); l++) {
+      if (l > 0) {
+        predecessors.at(vars[l]).insert(vars[l-1]);
+      }
+      LevelAccess level;
+      level.dense = format.getModeTypes()[l] == ModeType::Dense;
+      level.result = (path == resultPath);
+      level.fiberSize = dimensions.at(vars[l]);
+      if (!level.dense) {
+        if (sizes.size() == vars.size()) {
+          size_t parentSize = (l == 0) ? 1 : sizes[l-1];
+          level.fiberSize = (double)sizes[l] / max(parentSize, (size_t)1);
+        }
+        else {
+          level.fiberSize = max(level.fiberSize * ASSUMED_DENSITY, 1.0);
+        }
+      }
+      levels.at(vars[l]).push_back(level);
+    }
+  }
+
+  // Enumerate the orders the paths allow. Free and reduction variables keep
+  // the positions they have in the paths' order, so that the results are
+  // computed and assembled at the same loops.
+  vector<IndexVar> bestOrder = defaultOrder;
+  double bestCost = estimateCost(defaultOrder, levels, dimensions, conjunctive);
+  vector<IndexVar> order;
+  function<void()> enumerate = [&]() {
+    if (order.size() == defaultOrder.size()) {
+      double cost = estimateCost(order, levels, dimensions, conjunctive);
+      if (cost < bestCost) {
+        bestCost = cost;
+        bestOrder = order;
+      }
+      return;
+    }
+    bool free = graph.isFree(defaultOrder[order.size()]);
+    for (auto& var : defaultOrder) {
+      if (util::contains(order, var) || graph.isFree(var) != free) {
+        continue;
+      }
+      bool ready = true;
+      for (auto& predecessor : predecessors.at(var)) {
+        ready &= util::contains(order, predecessor);
+      }
+      if (ready) {
+        order.push_back(var);
+        enumerate();
+        order.pop_back();
+      }
+    }
+  };
+  enumerate();
+  return bestOrder;
+}
+
 const std::vector<IndexVar>& IterationGraph::getRoots() const {
   return content->iterationForest.getRoots();
 }
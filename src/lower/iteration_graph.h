@@ -1,6 +1,7 @@
 #ifndef TACO_ITERATION_GRAPH_H
 #define TACO_ITERATION_GRAPH_H
 
+#include <map>
 #include <memory>
 #include <vector>
 
@@ -31,6 +32,17 @@ public:
   /// Creates an iteration graph for a tensor with a defined expression.
   static IterationGraph make(const TensorVar&);
 
+  /// Returns the loop order, outermost first, with the least estimated cost of
+  /// iterating over the operands of the tensor's expression. The cost counts
+  /// the level accesses and merge steps of each loop, with trip counts taken
+  /// from the average fiber sizes of the operands. `levelSizes` holds the
+  /// number of positions in each level of the operands that have been packed,
+  /// and fibers of other compressed levels are assumed to be sparse. Returns
+  /// an empty order if the expression's loops cannot be reordered.
+  static std::vector<IndexVar>
+  selectLoopOrder(const TensorVar& tensor,
+                  const std::map<TensorVar,std::vector<size_t>>& levelSizes);
+
 
   /// Returns the iteration graph roots; the index variables with no parents.
   const std::vector<IndexVar>& getRoots() const;
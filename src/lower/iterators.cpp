@@ -38,7 +38,8 @@ Iterators::Iterators(const IterationGraph& graph,
       Iterator iterator = Iterator::make(path, name, tensorVarExpr, i,
                                          format.getModeTypes()[i],
                                          format.getModeOrdering()[i], parent,
-                                         tensorVar.getType());
+                                         tensorVar.getType(),
+                                         format.isUnique(i));
       iterators.insert({path.getStep(i), iterator});
       parent = iterator;
     }
@@ -1,5 +1,6 @@
 #include "taco/lower/lower.h"
 
+#include <algorithm>
 #include <vector>
 #include <stack>
 #include <set>
@@ -32,6 +33,31 @@ namespace lower {
 using namespace taco::ir;
 using taco::storage::Iterator;
 
+/// A dense workspace that the sparse last level of the result is scattered
+/// into one segment at a time, before the segment is gathered into the result
+/// in coordinate order. It is allocated once and cleared by every gather.
+struct Workspace {
+  /// The values scattered into the segment, and zero elsewhere
+  Expr values;
+
+  /// Marks the coordinates scattered into the segment (assembly only)
+  Expr occupied;
+
+  /// The coordinates scattered into the segment, in the order they were first
+  /// scattered into (assembly only)
+  Expr coords;
+
+  /// The number of coordinates scattered into the segment (assembly only)
+  Expr numCoords;
+
+  /// The dimension of the level
+  Expr dimension;
+
+  bool defined() const {
+    return values.defined();
+  }
+};
+
 struct Context {
   /// Determines what kind of code to emit (e.g. compute and/or assembly)
   set<Property>        properties;
@@ -42,6 +68,10 @@ struct Context {
   /// The iterators of the tensor tree levels
   Iterators            iterators;
 
+  /// The type of positions into the result, which is wide enough for the
+  /// positions of every level of the result
+  DataType             posType;
+
   /// The size of initial memory allocations
   Expr                 allocSize;
 
@@ -49,13 +79,60 @@ struct Context {
   /// (Not clear if this approach to temporaries is too hacky.)
   map<TensorVar,Expr> temporaries;
 
+  /// Whether every segment of the sparse last level of the result starts at a
+  /// position known before it is filled, so that segments can be filled in
+  /// parallel. Assembly then first counts the coordinates of every segment.
+  bool                 independentSegments;
+
+  /// Whether the emitted loops only count the coordinates of each segment of
+  /// the result into its pos array
+  bool                 countSegments;
+
+  /// The workspace the last level of the result is computed in, if any
+  Workspace            workspace;
+
+  /// The splits of the loops over index variables, and the loop variables of
+  /// their outer loops
+  map<IndexVar,IndexVarSplit> splits;
+  map<IndexVar,Expr>          outerLoopVars;
+
+  /// The split index variables whose outer loops are placed above the loop
+  /// over an index variable, outermost first
+  map<IndexVar,vector<IndexVar>> hoistedSplits;
+
+  /// The unroll factors of the loops over index variables
+  map<IndexVar,size_t> unrollFactors;
+
+  /// The loops over index variables, and outer loops of splits, that the
+  /// schedule runs in parallel (true) or serially (false)
+  map<IndexVar,bool>   parallelLoops;
+
+  /// Whether the outer loop of a split placed above all other loops runs in
+  /// parallel, so that the other loops must not
+  bool                 parallelHoisted;
+
+  /// Whether a parallel loop over a reduction variable encloses the updates of
+  /// the result, so that threads may add into the same result value and must
+  /// do so atomically
+  bool                 atomicResult;
+
   Context(const IterationGraph& iterationGraph,
           const set<Property>& properties,
           const map<TensorVar,Expr>& tensorVars) {
     this->properties = properties;
     this->iterationGraph = iterationGraph;
-    this->allocSize  = Var::make("init_alloc_size", Int());
     this->iterators = Iterators(iterationGraph, tensorVars);
+    this->posType = Int();
+    TensorPath resultPath = iterationGraph.getResultTensorPath();
+    for (size_t i = 0; i < resultPath.getSize(); i++) {
+      this->posType = max_type(this->posType,
+          iterators[resultPath.getStep(i)].getPtrVar().type());
+    }
+    this->allocSize  = Var::make("init_alloc_size", posType);
+    this->independentSegments = false;
+    this->countSegments = false;
+    this->parallelHoisted = false;
+    this->atomicResult = false;
   }
 };
 
@@ -111,6 +188,102 @@ static bool needsMerge(MergeLattice lattice) {
   return false;
 }
 
+/// Returns true iff some operand iterates over `indexVar` with a non-unique
+/// iterator, meaning the same coordinate may be visited more than once.
+static bool hasNonUniqueIterator(const IndexVar& indexVar, const Context& ctx) {
+  for (const auto& tensorPath : ctx.iterationGraph.getTensorPaths()) {
+    if (util::contains(tensorPath.getVariables(), indexVar) &&
+        !ctx.iterators[tensorPath.getStep(indexVar)].isUnique()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/// Returns an expression that is true iff the operands of `indexExpr` may
+/// store a value at the positions located for `indexVar`, or an undefined
+/// expression if they may store a value at every position. Products need all
+/// of their operands to store a value and sums need any of them, while an
+/// operand that `indexVar` does not index may store a value anywhere.
+static Expr storedCondition(const IndexExpr& indexExpr,
+                            const IndexVar& indexVar, const Context& ctx) {
+  struct BuildCondition : public IndexExprVisitorStrict {
+    const IndexVar& indexVar;
+    const Context&  ctx;
+    Expr            condition;
+
+    BuildCondition(const IndexVar& indexVar, const Context& ctx)
+        : indexVar(indexVar), ctx(ctx) {
+    }
+
+    Expr build(const IndexExpr& expr) {
+      condition = Expr();
+      expr.accept(this);
+      return condition;
+    }
+
+    using IndexExprVisitorStrict::visit;
+
+    void visit(const AccessNode* expr) {
+      if (!util::contains(expr->indexVars, indexVar)) {
+        condition = Expr();
+        return;
+      }
+      TensorPath path = ctx.iterationGraph.getTensorPath(expr);
+      size_t i = util::locate(path.getVariables(), indexVar);
+      condition = ctx.iterators[path.getStep(i)].hasCoordinate();
+    }
+
+    void visit(const LiteralNode*) {
+      condition = Expr();
+    }
+
+    void visit(const NegNode* expr) {
+      condition = build(expr->a);
+    }
+
+    void visit(const SqrtNode* expr) {
+      condition = build(expr->a);
+    }
+
+    void visit(const ReductionNode* expr) {
+      condition = build(expr->a);
+    }
+
+    void visit(const AddNode* expr) {
+      condition = disjunction(build(expr->a), build(expr->b));
+    }
+
+    void visit(const SubNode* expr) {
+      condition = disjunction(build(expr->a), build(expr->b));
+    }
+
+    void visit(const MulNode* expr) {
+      condition = conjunction(build(expr->a), build(expr->b));
+    }
+
+    void visit(const DivNode* expr) {
+      condition = conjunction(build(expr->a), build(expr->b));
+    }
+
+    static Expr conjunction(Expr a, Expr b) {
+      if (!a.defined() || !b.defined()) {
+        return a.defined() ? a : b;
+      }
+      return ir::And::make(a, b);
+    }
+
+    static Expr disjunction(Expr a, Expr b) {
+      if (!a.defined() || !b.defined()) {
+        return Expr();
+      }
+      return ir::Or::make(a, b);
+    }
+  };
+
+  return BuildCondition(indexVar, ctx).build(indexExpr);
+}
+
 static bool needsZero(const Context& ctx) {
   const auto& graph = ctx.iterationGraph;
   const auto& resultIdxVars = graph.getResultTensorPath().getVariables();
@@ -121,8 +294,12 @@ static bool needsZero(const Context& ctx) {
 
   for (const auto& idxVar : resultIdxVars) {
     for (const auto& tensorPath : graph.getTensorPaths()) {
-      if (util::contains(tensorPath.getVariables(), idxVar) && 
-          !ctx.iterators[tensorPath.getStep(idxVar)].isDense()) {
+      if (!util::contains(tensorPath.getVariables(), idxVar)) {
+        continue;
+      }
+      // Loops driven by bitmap levels skip their unset positions
+      const Iterator& iterator = ctx.iterators[tensorPath.getStep(idxVar)];
+      if (!iterator.isDense() || iterator.hasCoordinate().defined()) {
         return true;
       }
     }
@@ -156,7 +333,7 @@ static void emitComputeExpr(const Target& target, const IndexVar& indexVar,
   auto& iterationGraph = ctx.iterationGraph;
   if (target.pos.defined()) {
     Stmt store = iterationGraph.hasReductionVariableAncestor(indexVar) || accum
-        ? compoundStore(target.tensor, target.pos, expr)
+        ? compoundStore(target.tensor, target.pos, expr, ctx.atomicResult)
         :   Store::make(target.tensor, target.pos, expr);
     stmts->push_back(store);
   }
@@ -171,13 +348,22 @@ static void emitComputeExpr(const Target& target, const IndexVar& indexVar,
 static LoopKind doParallelize(const IndexVar& indexVar, const Expr& tensor, 
                               const Context& ctx) {
   if (ctx.iterationGraph.getAncestors(indexVar).size() != 1 ||
-      ctx.iterationGraph.isReduction(indexVar)) {
+      hasNonUniqueIterator(indexVar, ctx)) {
     return LoopKind::Serial;
   }
 
+  // Reductions into scalar results are privatized and reductions into dense
+  // results add into the result atomically. Both are only done by kernels that
+  // compute, and sparse results cannot be added into by several threads.
   const TensorPath& resultPath = ctx.iterationGraph.getResultTensorPath();
+  const bool reduction = ctx.iterationGraph.isReduction(indexVar);
+  if (reduction && !util::contains(ctx.properties, Compute)) {
+    return LoopKind::Serial;
+  }
+
   for (size_t i = 0; i < resultPath.getSize(); i++){
-    if (!ctx.iterators[resultPath.getStep(i)].isDense()) {
+    if (!ctx.iterators[resultPath.getStep(i)].isDense() &&
+        (!ctx.independentSegments || reduction)) {
       return LoopKind::Serial;
     }
   }
@@ -206,6 +392,344 @@ static LoopKind doParallelize(const IndexVar& indexVar, const Expr& tensor,
   return LoopKind::Dynamic;
 }
 
+/// Returns true iff the outer loop of the split of `indexVar` is placed above
+/// the loops that enclose the loop over `indexVar`.
+static bool isHoisted(const IndexVar& indexVar, const Context& ctx) {
+  for (auto& hoisted : ctx.hoistedSplits) {
+    if (util::contains(hoisted.second, indexVar)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/// Returns how the loop over `indexVar` and the outer loop of its split run.
+/// Loops run in parallel where it is safe, unless the schedule says otherwise,
+/// and the outer loop of a split is the one that runs in parallel by default.
+static pair<LoopKind,LoopKind> getLoopKinds(const IndexVar& indexVar,
+                                            const Expr& tensor,
+                                            const Context& ctx) {
+  LoopKind kind = ctx.parallelHoisted ? LoopKind::Serial
+                                      : doParallelize(indexVar, tensor, ctx);
+  auto directive = [&](const IndexVar& var) {
+    return util::contains(ctx.parallelLoops, var)
+           ? (ctx.parallelLoops.at(var) ? 1 : 0) : -1;
+  };
+
+  int innerDirective = directive(indexVar);
+  int outerDirective = -1;
+  bool hasOuterLoop = util::contains(ctx.splits, indexVar) &&
+                      !isHoisted(indexVar, ctx);
+  if (hasOuterLoop) {
+    outerDirective = directive(ctx.splits.at(indexVar).getOuter());
+  }
+  taco_uassert((innerDirective != 1 && outerDirective != 1) ||
+               kind != LoopKind::Serial) <<
+      "The loop over " << indexVar << " cannot be run in parallel";
+  taco_uassert(innerDirective != 1 || outerDirective != 1) <<
+      "Only one of the loops of the split of " << indexVar << " can be run " <<
+      "in parallel";
+
+  if (!hasOuterLoop) {
+    return {innerDirective == 0 ? LoopKind::Serial : kind, LoopKind::Serial};
+  }
+  LoopKind outerKind = (outerDirective == 0 || innerDirective == 1)
+                       ? LoopKind::Serial : kind;
+  LoopKind innerKind = (innerDirective == 0 || outerKind != LoopKind::Serial)
+                       ? LoopKind::Serial : kind;
+  return {innerKind, outerKind};
+}
+
+/// Records the split, unroll and parallelize directives of `schedule` in the
+/// context, and checks that the lowering can honor them.
+static void scheduleLoops(const Schedule& schedule, Context* ctx) {
+  const IterationGraph& graph = ctx->iterationGraph;
+  vector<IndexVar> loopVars;
+  for (auto& root : graph.getRoots()) {
+    util::append(loopVars, graph.getDescendants(root));
+  }
+
+  map<IndexVar,IndexVar> innerToSplitVar, outerToSplitVar;
+  for (auto& split : schedule.getSplits()) {
+    taco_uassert(util::contains(loopVars, split.getVar())) <<
+        "The schedule splits " << split.getVar() << ", which the expression " <<
+        "does not iterate over";
+    ctx->splits.insert({split.getVar(), split});
+    ctx->outerLoopVars.insert({split.getVar(),
+                               Var::make(split.getOuter().getName(), Int())});
+    innerToSplitVar.insert({split.getInner(), split.getVar()});
+    outerToSplitVar.insert({split.getOuter(), split.getVar()});
+  }
+  auto getLoopVar = [&](const IndexVar& var) {
+    IndexVar loopVar = util::contains(innerToSplitVar, var)
+                       ? innerToSplitVar.at(var) : var;
+    taco_uassert(util::contains(loopVars, loopVar)) <<
+        "The schedule refers to " << var << ", which the expression does " <<
+        "not iterate over";
+    return loopVar;
+  };
+
+  for (auto& unroll : schedule.getUnrollFactors()) {
+    taco_uassert(!util::contains(outerToSplitVar, unroll.first)) <<
+        "The outer loop " << unroll.first << " of a split cannot be unrolled";
+    ctx->unrollFactors.insert({getLoopVar(unroll.first), unroll.second});
+  }
+
+  for (auto& parallel : schedule.getParallelLoops()) {
+    IndexVar var = util::contains(outerToSplitVar, parallel.first)
+                   ? parallel.first : getLoopVar(parallel.first);
+    ctx->parallelLoops.insert({var, parallel.second});
+  }
+
+  // Outer loops of splits are placed above the next loop in the loop order
+  const TensorPath& resultPath = graph.getResultTensorPath();
+  vector<IndexVar> pendingSplits;
+  for (auto& var : schedule.getLoopOrder()) {
+    if (util::contains(outerToSplitVar, var)) {
+      pendingSplits.push_back(outerToSplitVar.at(var));
+      continue;
+    }
+    IndexVar loopVar = getLoopVar(var);
+    for (auto& splitVar : pendingSplits) {
+      if (splitVar == loopVar) {
+        continue;
+      }
+      vector<IndexVar> ancestors = graph.getAncestors(splitVar);
+      taco_uassert(util::contains(ancestors, loopVar)) <<
+          "The outer loop of the split of " << splitVar << " can only be " <<
+          "ordered above loops that enclose the loop over " << splitVar;
+      taco_uassert(graph.isFree(splitVar)) <<
+          "The outer loop of the split of " << splitVar << " cannot be " <<
+          "ordered above other loops, since " << splitVar << " is summed over";
+      for (size_t i = 0; i < resultPath.getSize(); i++) {
+        taco_uassert(ctx->iterators[resultPath.getStep(i)].isDense()) <<
+            "Outer loops of splits can only be ordered above other loops " <<
+            "when the result is dense";
+      }
+      for (auto& path : graph.getTensorPaths()) {
+        taco_uassert(!util::contains(path.getVariables(), splitVar) ||
+                     ctx->iterators[path.getStep(splitVar)].isDense()) <<
+            "The outer loop of the split of " << splitVar << " cannot be " <<
+            "ordered above other loops, since " << splitVar << " indexes " <<
+            "a sparse level";
+      }
+      for (IndexVar ancestor = graph.getParent(splitVar); ;
+           ancestor = graph.getParent(ancestor)) {
+        taco_uassert(graph.getChildren(ancestor).size() == 1) <<
+            "The outer loop of the split of " << splitVar << " cannot be " <<
+            "ordered above " << ancestor << ", which has other loops nested " <<
+            "in it";
+        if (ancestor == loopVar) {
+          break;
+        }
+      }
+
+      ctx->hoistedSplits[loopVar].push_back(splitVar);
+      IndexVar outer = ctx->splits.at(splitVar).getOuter();
+      if (util::contains(ctx->parallelLoops, outer) &&
+          ctx->parallelLoops.at(outer)) {
+        taco_uassert(ancestors.back() == loopVar &&
+                     ctx->hoistedSplits[loopVar].size() == 1) <<
+            "The outer loop " << outer << " can only be run in parallel if " <<
+            "it is the outermost loop";
+        ctx->parallelHoisted = true;
+        ctx->atomicResult = graph.isReduction(splitVar);
+      }
+    }
+    pendingSplits.clear();
+  }
+  for (auto& parallel : ctx->parallelLoops) {
+    if (!util::contains(outerToSplitVar, parallel.first) &&
+        ctx->parallelHoisted) {
+      taco_uassert(!parallel.second) << "The loop over " << parallel.first <<
+          " cannot run in parallel inside a parallel loop";
+    }
+  }
+}
+
+/// Returns true iff the result can be assembled and computed one segment of
+/// its last level at a time, in any order. This is the case when that level
+/// is sparse, the levels above it are dense, and its segments are produced by
+/// a loop nest whose outermost loop is over the first level, as in
+/// `A(i,j) = B(i,j) + C(i,j)` with CSR matrices.
+static bool hasIndependentSegments(const Context& ctx) {
+  const IterationGraph& graph = ctx.iterationGraph;
+  const TensorPath& resultPath = graph.getResultTensorPath();
+  if (resultPath.getSize() < 2 ||
+      ctx.iterators[resultPath.getLastStep()].isDense() ||
+      !ctx.iterators[resultPath.getLastStep()].isSequentialAccess() ||
+      !ctx.iterators[resultPath.getLastStep()].isUnique()) {
+    return false;
+  }
+  for (size_t i = 0; i + 1 < resultPath.getSize(); i++) {
+    if (!ctx.iterators[resultPath.getStep(i)].isDense()) {
+      return false;
+    }
+  }
+  const auto& resultVars = resultPath.getVariables();
+  return graph.getRoots().size() == 1 &&
+         graph.getRoots()[0] == resultVars[0] &&
+         !graph.hasReductionVariableAncestor(resultVars.back());
+}
+
+/// Returns the pos (index 0) or idx (index 1) array of a sparse level.
+static Expr getSparseArray(const Expr& tensor, int level, int index) {
+  string name = tensor.as<Var>()->name + to_string(level + 1) +
+                (index == 0 ? "_pos" : "_idx");
+  return GetProperty::make(tensor, TensorProperty::Indices, level, index, name);
+}
+
+/// Returns true iff the sparse last level of the result must be computed in a
+/// dense workspace, because the loops between it and the level above it are
+/// reductions that may produce its coordinates in any order and more than once,
+/// as in row-wise sparse matrix multiplication `A(i,j) = B(i,k) * C(k,j)`.
+static bool needsWorkspace(const Context& ctx) {
+  const IterationGraph& graph = ctx.iterationGraph;
+  const TensorPath& resultPath = graph.getResultTensorPath();
+  if (resultPath.getSize() < 2 ||
+      ctx.iterators[resultPath.getLastStep()].isDense() ||
+      !ctx.iterators[resultPath.getLastStep()].isSequentialAccess() ||
+      !ctx.iterators[resultPath.getLastStep()].isUnique()) {
+    return false;
+  }
+  for (size_t i = 0; i + 1 < resultPath.getSize(); i++) {
+    if (!ctx.iterators[resultPath.getStep(i)].isDense()) {
+      return false;
+    }
+  }
+
+  const auto& resultVars = resultPath.getVariables();
+  const IndexVar& segmentVar = resultVars[resultVars.size() - 2];
+  if (graph.getChildren(segmentVar).size() != 1 ||
+      graph.hasReductionVariableAncestor(segmentVar) ||
+      graph.getParent(resultVars.back()) == segmentVar) {
+    return false;
+  }
+  for (IndexVar var = graph.getParent(resultVars.back()); var != segmentVar;
+       var = graph.getParent(var)) {
+    if (!graph.isReduction(var)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/// Returns an expression that is true iff the sequential result level at
+/// position `pos` has filled its idx array and must grow it.
+static Expr isFull(const Expr& pos, const Context& ctx) {
+  return ir::And::make(ir::Eq::make((long long) 0, BitAnd::make(ir::Add::make(pos, (long long) 1), pos)),
+                       ir::Lte::make(ctx.allocSize, ir::Add::make(pos, (long long) 1)));
+}
+
+/// Returns code that gathers the workspace into the current segment of the
+/// last level of the result and clears it. Kernels that assemble gather the
+/// scattered coordinates in sorted order, sorting them by insertion when there
+/// are few of them and by scanning the occupied marks otherwise:
+/// if ((int64_t)w_size * w_size < A2_dimension) {
+///   <insertion sort w_coords[0:w_size]>
+/// } else {
+///   <w_coords = coordinates of the nonzero w_set, in order>
+/// }
+/// for (int32_t pw = 0; pw < w_size; pw++) {
+///   int32_t jw = w_coords[pw];
+///   A2_idx[pA2] = jw; A_vals[pA2] = w[jw]; w[jw] = 0; w_set[jw] = 0; pA2++;
+/// }
+/// A2_pos[pA1 + 1] = pA2;
+/// Kernels that only compute follow the coordinates already assembled.
+static Stmt gatherWorkspace(const Context& ctx, bool emitAssemble,
+                            bool emitCompute) {
+  const Workspace& workspace = ctx.workspace;
+  const TensorPath& resultPath = ctx.iterationGraph.getResultTensorPath();
+  Iterator segment = ctx.iterators[resultPath.getLastStep()];
+  Expr vals = GetProperty::make(segment.getTensor(), TensorProperty::Values);
+
+  if (!emitAssemble) {
+    Expr coord = segment.getIdxVar();
+    Stmt body = Block::make({
+        segment.initDerivedVar(),
+        Store::make(vals, segment.getPtrVar(),
+                    Load::make(workspace.values, coord)),
+        Store::make(workspace.values, coord, 0.0)});
+    return For::make(segment.getIteratorVar(), segment.begin(), segment.end(),
+                     (long long) 1, body);
+  }
+
+  Expr coords = workspace.coords;
+  Expr size = workspace.numCoords;
+
+  // Insertion sort of the scattered coordinates
+  Expr pw = Var::make("pw", Int());
+  Expr qw = Var::make("qw", Int());
+  Expr jw = Var::make("jw", Int());
+  Expr prev = ir::Sub::make(qw, (long long) 1);
+  Stmt shift = While::make(
+      ir::And::make(ir::Gt::make(qw, (long long) 0),
+                    ir::Gt::make(Load::make(coords, prev), jw)),
+      Block::make({Store::make(coords, qw, Load::make(coords, prev)),
+                   VarAssign::make(qw, prev)}));
+  Stmt insertionSort = For::make(pw, (long long) 1, size, (long long) 1,
+      Block::make({VarAssign::make(jw, Load::make(coords, pw), true),
+                   VarAssign::make(qw, pw, true),
+                   shift,
+                   Store::make(coords, qw, jw)}));
+
+  // Scan of the occupied marks
+  Stmt append = Block::make({Store::make(coords, size, jw),
+                             VarAssign::make(size, ir::Add::make(size, (long long) 1))});
+  Stmt scan = Block::make({
+      VarAssign::make(size, (long long) 0),
+      For::make(jw, (long long) 0, workspace.dimension, (long long) 1,
+                IfThenElse::make(ir::Neq::make(Load::make(workspace.occupied, jw),
+                                               (long long) 0), append))});
+
+  Expr size64 = Cast::make(size, Int(64));
+  Stmt sort = IfThenElse::make(ir::Lt::make(ir::Mul::make(size64, size64),
+                                            workspace.dimension),
+                               insertionSort, scan);
+
+  // Gather the sorted coordinates into the result
+  Expr rpos = segment.getPtrVar();
+  vector<Stmt> gather;
+  gather.push_back(VarAssign::make(jw, Load::make(coords, pw), true));
+  gather.push_back(segment.storeIdx(jw));
+  if (emitCompute) {
+    gather.push_back(Store::make(vals, rpos, Load::make(workspace.values, jw)));
+    gather.push_back(Store::make(workspace.values, jw, 0.0));
+  }
+  gather.push_back(Store::make(workspace.occupied, jw, (long long) 0));
+  gather.push_back(VarAssign::make(rpos, ir::Add::make(rpos, (long long) 1)));
+  Expr newSize = ir::Mul::make((long long) 2, ir::Add::make(rpos, (long long) 1));
+  Stmt resize = segment.resizeIdxStorage(newSize);
+  if (emitCompute) {
+    resize = Block::make({resize, Allocate::make(vals, newSize, true)});
+  }
+  gather.push_back(IfThenElse::make(isFull(rpos, ctx), resize));
+
+  return Block::make({
+      sort,
+      For::make(pw, (long long) 0, size, (long long) 1, Block::make(gather)),
+      segment.storePtr(),
+      VarAssign::make(size, (long long) 0)});
+}
+
+/// Returns true iff the loop over `iterator` should be fully unrolled. This is
+/// the case for innermost loops over dense levels whose dimension is a small
+/// compile-time constant, such as the dense blocks of a blocked format.
+static bool isUnrollable(const Iterator& iterator, const vector<Stmt>& body) {
+  const int maxUnrolledIterations = 8;
+  if (!iterator.isDense() || !isa<ir::Literal>(iterator.begin()) ||
+      !isa<ir::Literal>(iterator.end()) ||
+      to<ir::Literal>(iterator.end())->int_value > maxUnrolledIterations) {
+    return false;
+  }
+  for (auto& stmt : body) {
+    if (containsLoop(stmt)) {
+      return false;
+    }
+  }
+  return true;
+}
+
 /// Expression evaluates to true iff none of the iteratators are exhausted
 static Expr noneExhausted(const vector<Iterator>& iterators) {
   vector<Expr> stepIterLqEnd;
@@ -298,7 +822,7 @@ static Stmt createIfStatements(const vector<pair<Expr,Stmt>> &cases,
 /// Lowers an index expression to imperative code according to the loop ordering
 /// described by an iteration graph. This  algorithm was first outlined in paper
 /// "The Tensor Algebra Compiler", but has since been generalized.
-static vector<Stmt> lower(const Target&      target,
+static vector<Stmt> lower(Target             target,
                           const IndexVar&    indexVar,
                           IndexExpr          indexExpr,
                           const set<Access>& exhausted,
@@ -316,11 +840,87 @@ static vector<Stmt> lower(const Target&      target,
                                   ? ctx.iterators[resultStep]
                                   : Iterator();
 
+  // The last level of a result computed in a workspace is scattered into the
+  // workspace, and gathered into the result by the loop over the level above
+  const bool scatter = ctx.workspace.defined() && resultIterator.defined() &&
+                       resultStep == resultPath.getLastStep();
+  const bool gather = ctx.workspace.defined() && resultIterator.defined() &&
+                      resultStep.getStep() + 2 == (int)resultPath.getSize();
+  if (scatter) {
+    resultIterator = Iterator();
+  }
+
   bool accumulate   = util::contains(ctx.properties, Accumulate);
   bool emitCompute  = util::contains(ctx.properties, Compute);
   bool emitAssemble = util::contains(ctx.properties, Assemble);
   bool emitMerge    = needsMerge(lattice);
 
+  // Coordinates that repeat in a non-unique level must be accumulated into the
+  // result, at that level and at every level below it
+  if (hasNonUniqueIterator(indexVar, ctx)) {
+    taco_uassert(!emitMerge) <<
+        "Iteration over " << indexVar << " merges a non-unique level with " <<
+        "other operands, which is not supported";
+    for (size_t i = 0; i < resultPath.getSize(); i++) {
+      taco_uassert(ctx.iterators[resultPath.getStep(i)].isDense()) <<
+          "Iteration over a non-unique level requires a dense result";
+    }
+  }
+  for (auto& ancestor : iterationGraph.getAncestors(indexVar)) {
+    if (hasNonUniqueIterator(ancestor, ctx)) {
+      accumulate = true;
+      break;
+    }
+  }
+
+  // A parallel loop over a reduction variable into a scalar result adds into
+  // thread-private copies of a scalar temporary, which is added to the result
+  // after the loop:
+  // double ta = 0;
+  // #pragma omp parallel for reduction(+:ta)
+  // for (...) { ... ta = ta + ...; }
+  // a_vals[0] = a_vals[0] + ta;
+  // A parallel loop over a reduction variable into a dense result, as in
+  // `y(j) = A(i,j) * x(i)`, adds into the result atomically instead, since
+  // private copies of the result would be as large as the result:
+  // #pragma omp parallel for
+  // for (...) { ...
+  //   #pragma omp atomic
+  //   y_vals[jA] = y_vals[jA] + A_vals[pA2] * x_vals[i]; }
+  LoopKind innerKind = LoopKind::Serial;
+  LoopKind outerKind = LoopKind::Serial;
+  if (!emitMerge && lattice.getSize() > 0) {
+    tie(innerKind, outerKind) =
+        getLoopKinds(indexVar, lattice[0].getRangeIterators()[0].getTensor(),
+                     ctx);
+  }
+  taco_uassert(!emitMerge || (!util::contains(ctx.splits, indexVar) &&
+                              !util::contains(ctx.unrollFactors, indexVar))) <<
+      "The loop over " << indexVar << " merges operands and cannot be split " <<
+      "or unrolled";
+
+  vector<Expr> reductions;
+  Stmt reductionInit, reductionStore;
+  bool atomicResult = false;
+  if (emitCompute && !emitMerge && lattice.getSize() > 0 &&
+      iterationGraph.isReduction(indexVar) &&
+      (innerKind != LoopKind::Serial || outerKind != LoopKind::Serial)) {
+    if (resultPath.getSize() > 0) {
+      atomicResult = true;
+      ctx.atomicResult = true;
+    }
+    else {
+      const Expr& tensor = target.tensor.as<GetProperty>()->tensor;
+      Expr accumulator = Var::make("t" + tensor.as<Var>()->name,
+                                   target.tensor.type());
+      reductionInit = VarAssign::make(accumulator, 0.0, true);
+      reductionStore = compoundStore(target.tensor, target.pos, accumulator);
+      reductions.push_back(accumulator);
+      target.tensor = accumulator;
+      target.pos = Expr();
+    }
+  }
+
   vector<Stmt> code;
 
   // Emit code to initialize pos variables:
@@ -369,15 +969,29 @@ static vector<Stmt> lower(const Target&      target,
             : lp.getMergeIterators()[0].getIdxVar();
     }
 
+    // Emit code to compute into the workspace:
+    // w[j] = w[j] + ...;
+    if (scatter) {
+      target.tensor = ctx.workspace.values;
+      target.pos = idx;
+    }
+
     // Emit code to initialize random access pos variables:
     // D1_pos = (D0_pos * 3) + k;
     auto randomAccessIterators =
         getRandomAccessIterators(util::combine(lpIterators, {resultIterator}));
     for (Iterator& iterator : randomAccessIterators) {
-      Expr val = ir::Add::make(ir::Mul::make(iterator.getParent().getPtrVar(),
-                                             iterator.end()), idx);
-      Stmt initPos = VarAssign::make(iterator.getPtrVar(), val, true);
-      loopBody.push_back(initPos);
+      loopBody.push_back(iterator.locate(idx));
+    }
+
+    // Emit code to start the result segment below the located result position,
+    // which is counted from zero or starts where the pos array says:
+    // int pA2 = A2_pos[pA1];
+    if (ctx.independentSegments && resultIterator.defined() &&
+        resultStep.getStep() + 2 == (int)resultPath.getSize()) {
+      Iterator segment = ctx.iterators[resultPath.getLastStep()];
+      Expr start = ctx.countSegments ? Expr((long long) 0) : segment.begin();
+      loopBody.push_back(VarAssign::make(segment.getPtrVar(), start, true));
     }
 
     // Emit one case per lattice point in the sub-lattice rooted at lp
@@ -478,9 +1092,23 @@ static vector<Stmt> lower(const Target&      target,
         }
       }
 
+      // Emit code to record the coordinates scattered into the workspace:
+      // if (w_set[j] == 0) { w_set[j] = 1; w_coords[w_size] = j; w_size++; }
+      if (emitAssemble && scatter) {
+        const Workspace& workspace = ctx.workspace;
+        Expr size = workspace.numCoords;
+        Stmt record = Block::make({
+            Store::make(workspace.occupied, idx, (long long) 1),
+            Store::make(workspace.coords, size, idx),
+            VarAssign::make(size, ir::Add::make(size, (long long) 1))});
+        caseBody.push_back(IfThenElse::make(
+            ir::Eq::make(Load::make(workspace.occupied, idx), (long long) 0),
+            record));
+      }
+
       // Emit a store of the index variable value to the result idx index array
       // A2_idx_arr[A2_pos] = j;
-      if (emitAssemble && resultIterator.defined()){
+      if (emitAssemble && resultIterator.defined() && !ctx.countSegments){
         Stmt idxStore = resultIterator.storeIdx(idx);
         if (idxStore.defined()) {
           caseBody.push_back(idxStore);
@@ -493,11 +1121,10 @@ static vector<Stmt> lower(const Target&      target,
         Expr rpos = resultIterator.getPtrVar();
         Stmt posInc = VarAssign::make(rpos, ir::Add::make(rpos, (long long) 1));
 
-        // Conditionally resize result `idx` and `pos` arrays
-        if (emitAssemble) {
-          Expr resize =
-              ir::And::make(ir::Eq::make((long long) 0, BitAnd::make(ir::Add::make(rpos, (long long) 1), rpos)),
-                        ir::Lte::make(ctx.allocSize, ir::Add::make(rpos, (long long) 1)));
+        // Conditionally resize result `idx` and `pos` arrays, which are already
+        // large enough if segments were counted
+        if (emitAssemble && !ctx.independentSegments) {
+          Expr resize = isFull(rpos, ctx);
           Expr newSize = ir::Mul::make((long long) 2, ir::Add::make(rpos, (long long) 1));
 
           // Resize result `idx` array
@@ -538,7 +1165,23 @@ static vector<Stmt> lower(const Target&      target,
                   : allEqualTo(caseIterators,idx);
       cases.push_back({cond, Block::make(caseBody)});
     }
-    loopBody.push_back(createIfStatements(cases, lpLattice, ind));
+    Stmt casesStmt = createIfStatements(cases, lpLattice, ind);
+
+    // Skip the positions where no operand stores a value, which random access
+    // levels such as bitmaps can tell without merging:
+    // if (((B2_bitmap[bB2 >> 6] >> (bB2 & 63)) & 1) != 0) { ... }
+    if (!emitMerge) {
+      Expr stored = storedCondition(lp.getExpr(), indexVar, ctx);
+      if (stored.defined()) {
+        casesStmt = IfThenElse::make(stored, casesStmt);
+      }
+    }
+    loopBody.push_back(casesStmt);
+
+    // Emit code to gather the segment computed in the workspace
+    if (gather) {
+      loopBody.push_back(gatherWorkspace(ctx, emitAssemble, emitCompute));
+    }
 
     // Emit code to increment sequential access `pos` variables. Variables that
     // may not be consumed in an iteration (i.e. their iteration space is
@@ -581,9 +1224,40 @@ static vector<Stmt> lower(const Target&      target,
     }
     else {
       Iterator iter = lp.getRangeIterators()[0];
-      loop = For::make(iter.getIteratorVar(), iter.begin(), iter.end(), (long long) 1,
-                       Block::make(loopBody), 
-                       doParallelize(indexVar, iter.getTensor(), ctx));
+      auto noReductions = vector<Expr>();
+
+      // Emit the loop over a block of a split loop:
+      // for (int32_t jB = j0; jB < TACO_MIN(j0 + 16, B2_dimension); jB++)
+      const bool split = util::contains(ctx.splits, indexVar);
+      Expr begin = iter.begin();
+      Expr end = iter.end();
+      Expr blockVar, blockSize;
+      if (split) {
+        blockVar = ctx.outerLoopVars.at(indexVar);
+        blockSize = (long long) ctx.splits.at(indexVar).getFactor();
+        begin = blockVar;
+        end = ir::Min::make(ir::Add::make(blockVar, blockSize), iter.end());
+      }
+      loop = For::make(iter.getIteratorVar(), begin, end, (long long) 1,
+                       Block::make(loopBody), innerKind, 0,
+                       innerKind != LoopKind::Serial ? reductions
+                                                     : noReductions);
+      if (util::contains(ctx.unrollFactors, indexVar)) {
+        loop = unroll(loop, ctx.unrollFactors.at(indexVar));
+      }
+      else if (innerKind == LoopKind::Serial && !split &&
+               isUnrollable(iter, loopBody)) {
+        loop = unroll(loop);
+      }
+      if (split && !isHoisted(indexVar, ctx)) {
+        loop = For::make(blockVar, iter.begin(), iter.end(), blockSize, loop,
+                         outerKind, 0,
+                         outerKind != LoopKind::Serial ? reductions
+                                                       : noReductions);
+      }
+      if (reductionInit.defined()) {
+        loop = Block::make({reductionInit, loop, reductionStore});
+      }
     }
     loops.push_back(loop);
   }
@@ -591,13 +1265,42 @@ static vector<Stmt> lower(const Target&      target,
 
   // Emit a store of the  segment size to the result pos index
   // A2_pos_arr[A1_pos + 1] = A2_pos;
-  if (emitAssemble && resultIterator.defined()) {
+  if (emitAssemble && resultIterator.defined() &&
+      (!ctx.independentSegments || ctx.countSegments)) {
     Stmt posStore = resultIterator.storePtr();
     if (posStore.defined()) {
       util::append(code, {posStore});
     }
   }
 
+  // Emit the outer loops of splits placed above this loop, which tile the
+  // loop nest:
+  // for (int32_t j0 = 0; j0 < C2_dimension; j0 += 16) { <loops over i> }
+  if (util::contains(ctx.hoistedSplits, indexVar)) {
+    auto& splitVars = ctx.hoistedSplits.at(indexVar);
+    for (auto it = splitVars.rbegin(); it != splitVars.rend(); ++it) {
+      Iterator iter;
+      for (auto& path : util::combine({resultPath},
+                                      iterationGraph.getTensorPaths())) {
+        if (util::contains(path.getVariables(), *it)) {
+          iter = ctx.iterators[path.getStep(*it)];
+          break;
+        }
+      }
+      IndexVar outer = ctx.splits.at(*it).getOuter();
+      LoopKind kind = (util::contains(ctx.parallelLoops, outer) &&
+                       ctx.parallelLoops.at(outer)) ? LoopKind::Static
+                                                    : LoopKind::Serial;
+      Stmt loop = For::make(ctx.outerLoopVars.at(*it), iter.begin(), iter.end(),
+                            (long long) ctx.splits.at(*it).getFactor(),
+                            Block::make(code), kind);
+      code = {loop};
+    }
+  }
+
+  if (atomicResult) {
+    ctx.atomicResult = false;
+  }
   return code;
 }
 
@@ -615,6 +1318,42 @@ Stmt lower(TensorVar tensorVar, string functionName, set<Property> properties,
   if (isa<AddNode>(assignment.getOp().ptr)) {
     properties.insert(Accumulate);
   }
+  const vector<ModeType>& modeTypes = tensorVar.getFormat().getModeTypes();
+  for (size_t i = 0; i < modeTypes.size(); i++) {
+    taco_uassert(modeTypes[i] != ModeType::Singleton) <<
+        "Results cannot be stored in singleton modes";
+    taco_uassert(modeTypes[i] != ModeType::Bitmap) <<
+        "Results cannot be stored in bitmap modes";
+    taco_uassert(modeTypes[i] != ModeType::Fixed) <<
+        "Results cannot be stored in fixed modes";
+    taco_uassert(modeTypes[i] != ModeType::Diagonal) <<
+        "Results cannot be stored in diagonal modes";
+    taco_uassert(modeTypes[i] != ModeType::Hashed ||
+                 (i + 1 == modeTypes.size() &&
+                  std::count(modeTypes.begin(), modeTypes.end(),
+                             ModeType::Dense) == (long)i)) <<
+        "A hashed mode must be the last mode of a result whose other modes " <<
+        "are dense";
+  }
+  const bool hashedResult = !modeTypes.empty() &&
+                            modeTypes.back() == ModeType::Hashed;
+  taco_uassert(!hashedResult || !util::contains(properties, Accumulate)) <<
+      "Results with a hashed mode cannot be accumulated into";
+
+  // Bitmap levels only store the children of their set bits, so the levels
+  // below them must be located into without reading their index arrays
+  for (const TensorVar& operand : getOperands(indexExpr)) {
+    const vector<ModeType>& operandModeTypes =
+        operand.getFormat().getModeTypes();
+    auto bitmap = std::find(operandModeTypes.begin(), operandModeTypes.end(),
+                            ModeType::Bitmap);
+    taco_uassert(bitmap == operandModeTypes.end() ||
+                 std::all_of(bitmap + 1, operandModeTypes.end(),
+                             [](ModeType modeType) {
+                               return modeType == ModeType::Dense;
+                             })) <<
+        "Only dense modes can follow the bitmap mode of " << operand.getName();
+  }
 
   Schedule schedule = tensorVar.getSchedule();
 
@@ -623,14 +1362,91 @@ Stmt lower(TensorVar tensorVar, string functionName, set<Property> properties,
   vector<Expr> results;
   map<TensorVar,Expr> tensorVars;
   tie(parameters,results,tensorVars) = getTensorVars(tensorVar);
+  for (auto& operand : tensorVars) {
+    taco_uassert(operand.first == tensorVar ||
+                 !util::contains(operand.first.getFormat().getModeTypes(),
+                                 ModeType::Hashed)) <<
+        "Hashed modes can only be used in results";
+  }
 
   IterationGraph iterationGraph = IterationGraph::make(tensorVar);
   Context ctx(iterationGraph, properties, tensorVars);
+  scheduleLoops(schedule, &ctx);
 
   vector<Stmt> init, body;
 
+  // Kernels that assemble while they compute fill the segments of a sparse
+  // result in order, since they cannot know where a segment starts before the
+  // segments above it are filled
+  ctx.independentSegments = !(emitAssemble && emitCompute) &&
+                            hasIndependentSegments(ctx);
+
   TensorPath resultPath = ctx.iterationGraph.getResultTensorPath();
-  if (emitAssemble) {
+
+  // Results whose last level is computed below a reduction are computed one
+  // segment at a time in a dense workspace, which is allocated and cleared once
+  // and then reused by every segment:
+  // double* w = malloc(sizeof(double) * A2_dimension);
+  // uint8_t* w_set = malloc(sizeof(uint8_t) * A2_dimension);
+  // int32_t* w_coords = malloc(sizeof(int32_t) * A2_dimension);
+  // int32_t w_size = 0;
+  vector<Stmt> allocWorkspace, release;
+  if ((emitAssemble || emitCompute) && needsWorkspace(ctx)) {
+    Workspace& workspace = ctx.workspace;
+    Expr resultTensor = ctx.iterators[resultPath.getLastStep()].getTensor();
+    workspace.dimension = GetProperty::make(resultTensor,
+                                            TensorProperty::Dimension,
+                                            resultPath.getSize() - 1);
+    workspace.values = Var::make("w", tensorVar.getType().getDataType(), true);
+    workspace.occupied = Var::make("w_set", UInt(8), true);
+    workspace.coords = Var::make("w_coords", Int(), true);
+    workspace.numCoords = Var::make("w_size", Int());
+
+    Expr pw = Var::make("pw", Int());
+    vector<Expr> arrays;
+    vector<Stmt> clears;
+    if (emitCompute) {
+      arrays.push_back(workspace.values);
+      clears.push_back(Store::make(workspace.values, pw, 0.0));
+    }
+    if (emitAssemble) {
+      arrays.push_back(workspace.occupied);
+      arrays.push_back(workspace.coords);
+      clears.push_back(Store::make(workspace.occupied, pw, (long long) 0));
+    }
+    for (auto& array : arrays) {
+      allocWorkspace.push_back(Allocate::make(array, workspace.dimension));
+      release.push_back(Free::make(array));
+    }
+    allocWorkspace.push_back(For::make(pw, (long long) 0, workspace.dimension,
+                                       (long long) 1, Block::make(clears)));
+    if (emitAssemble) {
+      allocWorkspace.push_back(VarAssign::make(workspace.numCoords,
+                                               (long long) 0, true));
+    }
+  }
+
+  Expr numSegments, segmentPos;
+  if (ctx.independentSegments) {
+    numSegments = (long long) 1;
+    for (size_t i = 0; i + 1 < resultPath.getSize(); i++) {
+      numSegments = ir::Mul::make(numSegments,
+                                  ctx.iterators[resultPath.getStep(i)].end());
+    }
+    Expr resultTensor = ctx.iterators[resultPath.getLastStep()].getTensor();
+    segmentPos = getSparseArray(resultTensor, resultPath.getSize() - 1, 0);
+  }
+
+  if (emitAssemble && ctx.independentSegments) {
+    // Segments the loop nest does not visit are empty, so every count starts
+    // at zero
+    Expr numPos = ir::Add::make(numSegments, (long long) 1);
+    Expr segment = Var::make("p" + name, ctx.posType);
+    init.push_back(Allocate::make(segmentPos, numPos));
+    init.push_back(For::make(segment, (long long) 0, numPos, (long long) 1,
+                             Store::make(segmentPos, segment, (long long) 0)));
+  }
+  else if (emitAssemble) {
     for (auto& indexVar : resultPath.getVariables()) {
       Iterator iter = ctx.iterators[resultPath.getStep(indexVar)];
       Stmt allocStmts = iter.initStorage(ctx.allocSize);
@@ -649,8 +1465,11 @@ Stmt lower(TensorVar tensorVar, string functionName, set<Property> properties,
     }
   }
 
-  // Initialize the result pos variables
-  if (emitCompute || emitAssemble) {
+  util::append(init, allocWorkspace);
+
+  // Initialize the result pos variables, unless every segment initializes its
+  // own
+  if ((emitCompute || emitAssemble) && !ctx.independentSegments) {
     Stmt prevIteratorInit;
     for (auto& indexVar : resultPath.getVariables()) {
       Iterator iter = ctx.iterators[resultPath.getStep(indexVar)];
@@ -693,7 +1512,8 @@ Stmt lower(TensorVar tensorVar, string functionName, set<Property> properties,
         size = ir::Mul::make(size, iter.end());
       }
 
-      if (emitAssemble) {
+      // The runtime allocates the values of results with a hashed mode
+      if (emitAssemble && !hashedResult) {
         Stmt allocVals = Allocate::make(target.tensor, size);
         init.push_back(allocVals);
       }
@@ -706,7 +1526,7 @@ Stmt lower(TensorVar tensorVar, string functionName, set<Property> properties,
           taco_iassert(to<ir::Literal>(size)->int_value == 1);
           body.push_back(Store::make(target.tensor, (long long) 0, 0.0));
         } else if (needsZero(ctx)) {
-          Expr idxVar = Var::make("p" + name, Int());
+          Expr idxVar = Var::make("p" + name, ctx.posType);
           Stmt zeroStmt = Store::make(target.tensor, idxVar, 0.0);
           body.push_back(For::make(idxVar, (long long) 0, size, (long long) 1, zeroStmt));
         }
@@ -722,20 +1542,60 @@ Stmt lower(TensorVar tensorVar, string functionName, set<Property> properties,
       }
       return false;
     }());
-    if (emitLoops) {
+    if (emitLoops && emitAssemble && ctx.independentSegments) {
+      // Count the coordinates of every segment into the pos array, turn the
+      // counts into segment ends, and fill the segments where they start.
+      // The loop nests are lowered twice, so each is braced to keep the
+      // variables they declare apart:
+      // { for (...) { ...; A2_pos[pA1 + 1] = pA2; } }
+      // for (int32_t pA = 0; pA < A1_dimension; pA++)
+      //   A2_pos[pA + 1] += A2_pos[pA];
+      // allocate A2_idx[A2_pos[A1_dimension]]
+      // { for (...) { int32_t pA2 = A2_pos[pA1]; ...; A2_idx[pA2] = j; } }
+      ctx.countSegments = true;
+      for (auto& root : roots) {
+        body.push_back(Scope::make(Block::make(lower::lower(target, root,
+                                                            indexExpr, {},
+                                                            ctx)), true));
+      }
+      ctx.countSegments = false;
+
+      Expr segment = Var::make("p" + name, ctx.posType);
+      Expr next = ir::Add::make(segment, (long long) 1);
+      Stmt scan = Store::make(segmentPos, next,
+                              ir::Add::make(Load::make(segmentPos, next),
+                                            Load::make(segmentPos, segment)));
+      body.push_back(For::make(segment, (long long) 0, numSegments,
+                               (long long) 1, scan));
+
+      Expr resultTensor = ctx.iterators[resultPath.getLastStep()].getTensor();
+      Expr segmentIdx = getSparseArray(resultTensor, resultPath.getSize() - 1,
+                                       1);
+      body.push_back(Allocate::make(segmentIdx,
+                                    Load::make(segmentPos, numSegments)));
+      for (auto& root : roots) {
+        body.push_back(Scope::make(Block::make(lower::lower(target, root,
+                                                            indexExpr, {},
+                                                            ctx)), true));
+      }
+    }
+    else if (emitLoops) {
       for (auto& root : roots) {
         auto loopNest = lower::lower(target, root, indexExpr, {}, ctx);
         util::append(body, loopNest);
       }
     }
 
-    if (emitAssemble && !emitCompute) {
+    if (emitAssemble && !emitCompute && !hashedResult) {
       Expr size = (long long) 1;
       for (auto& indexVar : resultPath.getVariables()) {
         Iterator iter = ctx.iterators[resultPath.getStep(indexVar)];
         size = iter.isFixedRange() ? ir::Mul::make(size, iter.end()) :
                iter.getPtrVar();
       }
+      if (ctx.independentSegments) {
+        size = Load::make(segmentPos, numSegments);
+      }
       Stmt allocVals = Allocate::make(target.tensor, size);
       
       if (!body.empty()) {
@@ -766,6 +1626,7 @@ Stmt lower(TensorVar tensorVar, string functionName, set<Property> properties,
     init.push_back(BlankLine::make());
   }
   body = util::combine(init, body);
+  util::append(body, release);
 
   return Function::make(functionName, parameters, results, Block::make(body));
 }
@@ -85,6 +85,23 @@ ir::Expr lowerToScalarExpression(const IndexExpr& indexExpr,
       ir::Expr values = GetProperty::make(iterator.getTensor(),
                                           TensorProperty::Values);
       ir::Expr loadValue = Load::make(values, ptr);
+
+      // Levels that may be located at coordinates they do not store, such as
+      // bitmap levels, only store the children of stored coordinates, so the
+      // values elsewhere are zero:
+      // (bB2 stored) ? B_vals[pB2] : 0
+      ir::Expr stored;
+      for (size_t i = 0; i < path.getSize(); i++) {
+        ir::Expr hasCoordinate = iterators[path.getStep(i)].hasCoordinate();
+        if (hasCoordinate.defined()) {
+          stored = stored.defined() ? ir::And::make(stored, hasCoordinate)
+                                    : hasCoordinate;
+        }
+      }
+      if (stored.defined()) {
+        loadValue = Ternary::make(stored, loadValue,
+                                  Cast::make((long long) 0, loadValue.type()));
+      }
       expr = loadValue;
     }
 
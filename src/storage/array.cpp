@@ -18,6 +18,7 @@ struct Array::Content : util::Uncopyable {
   void*  data;
   size_t size;
   Policy policy = Array::UserOwns;
+  std::shared_ptr<void> owner;
 
   ~Content() {
     switch (policy) {
@@ -93,6 +94,11 @@ Array::Array(DataType type, void* data, size_t size, Policy policy) : Array() {
   content->policy = policy;
 }
 
+Array::Array(DataType type, void* data, size_t size, shared_ptr<void> owner)
+    : Array(type, data, size, UserOwns) {
+  content->owner = owner;
+}
+
 const DataType& Array::getType() const {
   return content->type;
 }
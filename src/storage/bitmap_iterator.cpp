@@ -0,0 +1,144 @@
+#include "bitmap_iterator.h"
+
+#include "taco/util/strings.h"
+
+using namespace std;
+using namespace taco::ir;
+
+namespace taco {
+namespace storage {
+
+BitmapIterator::BitmapIterator(std::string name, const Expr& tensor, int level,
+                               size_t dimension, Iterator previous)
+      : IteratorImpl(previous, tensor) {
+  this->tensor = tensor;
+  this->level = level;
+
+  // Positions count the set bits, so they have the type of the rank array,
+  // while bits are numbered like the positions of a dense level
+  DataType ptrType = Int();
+  if (getRankArr().type().getNumBits() > ptrType.getNumBits()) {
+    ptrType = getRankArr().type();
+  }
+
+  std::string indexVarName = name + util::toString(tensor);
+  ptrVar = Var::make("p" + util::toString(tensor) + std::to_string(level + 1),
+                     ptrType);
+  bitVar = Var::make("b" + util::toString(tensor) + std::to_string(level + 1),
+                     Int64);
+  idxVar = Var::make(indexVarName, Int());
+
+  this->dimension = (long long)dimension;
+}
+
+bool BitmapIterator::isDense() const {
+  return true;
+}
+
+bool BitmapIterator::isFixedRange() const {
+  return true;
+}
+
+bool BitmapIterator::isRandomAccess() const {
+  return true;
+}
+
+bool BitmapIterator::isSequentialAccess() const {
+  return false;
+}
+
+bool BitmapIterator::isUnique() const {
+  return true;
+}
+
+Expr BitmapIterator::getPtrVar() const {
+  return ptrVar;
+}
+
+Expr BitmapIterator::getIdxVar() const {
+  return idxVar;
+}
+
+Expr BitmapIterator::getIteratorVar() const {
+  return idxVar;
+}
+
+Expr BitmapIterator::begin() const {
+  return (long long) 0;
+}
+
+Expr BitmapIterator::end() const {
+  if (isa<Literal>(dimension) && to<Literal>(dimension)->int_value <= 16) {
+    return dimension;
+  }
+  return getSizeArr();
+}
+
+Stmt BitmapIterator::initDerivedVars() const {
+  return locate(getIdxVar());
+}
+
+ir::Stmt BitmapIterator::locate(ir::Expr idx) const {
+  // int64_t bB2 = (int64_t)pB1 * 16 + j;
+  // int pB2 = B2_rank[bB2 >> 6] +
+  //           popcount(B2_bitmap[bB2 >> 6] & (((uint64_t)1 << (bB2 & 63)) - 1));
+  Expr parentPtr = Cast::make(getParent().getPtrVar(), Int64);
+  Stmt bitVal = VarAssign::make(bitVar, Add::make(Mul::make(parentPtr, end()),
+                                                  idx), true);
+  Expr below = Sub::make(Shl::make(Cast::make(1ull, UInt64), getBitInWord()),
+                         Cast::make(1ull, UInt64));
+  Expr setBitsBelow = Popcount::make(BitAnd::make(getWord(), below));
+  Expr ptrVal = Add::make(Load::make(getRankArr(), Shr::make(bitVar, 6ll)),
+                          setBitsBelow);
+  return Block::make({bitVal, VarAssign::make(getPtrVar(), ptrVal, true)});
+}
+
+ir::Expr BitmapIterator::hasCoordinate() const {
+  // (B2_bitmap[bB2 >> 6] >> (bB2 & 63)) & 1
+  return Neq::make(BitAnd::make(Shr::make(getWord(), getBitInWord()), 1ull),
+                   0ull);
+}
+
+ir::Stmt BitmapIterator::storePtr() const {
+  return Stmt();
+}
+
+ir::Stmt BitmapIterator::storeIdx(ir::Expr idx) const {
+  return Stmt();
+}
+
+ir::Stmt BitmapIterator::initStorage(ir::Expr size) const {
+  return Stmt();
+}
+
+ir::Stmt BitmapIterator::resizePtrStorage(ir::Expr size) const {
+  return Stmt();
+}
+
+ir::Stmt BitmapIterator::resizeIdxStorage(ir::Expr size) const {
+  return Stmt();
+}
+
+ir::Expr BitmapIterator::getSizeArr() const {
+  return GetProperty::make(tensor, TensorProperty::Dimension, level);
+}
+
+ir::Expr BitmapIterator::getBitmapArr() const {
+  string name = tensor.as<Var>()->name + to_string(level + 1) + "_bitmap";
+  return GetProperty::make(tensor, TensorProperty::Indices, level, 1, name);
+}
+
+ir::Expr BitmapIterator::getRankArr() const {
+  string name = tensor.as<Var>()->name + to_string(level + 1) + "_rank";
+  return GetProperty::make(tensor, TensorProperty::Indices, level, 2, name);
+}
+
+ir::Expr BitmapIterator::getWord() const {
+  return Load::make(getBitmapArr(), Shr::make(bitVar, 6ll));
+}
+
+ir::Expr BitmapIterator::getBitInWord() const {
+  return BitAnd::make(bitVar, 63ll);
+}
+
+}}
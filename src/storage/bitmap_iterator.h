@@ -0,0 +1,68 @@
+#ifndef TACO_STORAGE_BITMAP_H
+#define TACO_STORAGE_BITMAP_H
+
+#include <string>
+
+#include "iterator.h"
+#include "taco/ir/ir.h"
+
+namespace taco {
+namespace storage {
+
+/// Iterates over a bitmap level, which packs one bit per coordinate of every
+/// parent into 64-bit words that are set iff the coordinate is stored, and only
+/// stores the children of set bits. A rank array holds the number of set bits
+/// before every word, so the position of a coordinate is the rank of its word
+/// plus the set bits below it in the word. Bitmap levels can thus be located
+/// into like dense levels, while loops that they drive skip the unset bits.
+class BitmapIterator : public IteratorImpl {
+public:
+  BitmapIterator(std::string name, const ir::Expr& tensor, int level,
+                 size_t dimension, Iterator previous);
+  virtual ~BitmapIterator() {};
+
+  bool isDense() const;
+  bool isFixedRange() const;
+
+  bool isRandomAccess() const;
+  bool isSequentialAccess() const;
+  bool isUnique() const;
+
+  ir::Expr getPtrVar() const;
+  ir::Expr getIdxVar() const;
+
+  ir::Expr getIteratorVar() const;
+  ir::Expr begin() const;
+  ir::Expr end() const;
+
+  ir::Stmt initDerivedVars() const;
+  ir::Stmt locate(ir::Expr idx) const;
+  ir::Expr hasCoordinate() const;
+
+  ir::Stmt storePtr() const;
+  ir::Stmt storeIdx(ir::Expr idx) const;
+
+  ir::Stmt initStorage(ir::Expr size) const;
+  ir::Stmt resizePtrStorage(ir::Expr size) const;
+  ir::Stmt resizeIdxStorage(ir::Expr size) const;
+
+private:
+  ir::Expr tensor;
+  int level;
+
+  ir::Expr ptrVar;
+  ir::Expr bitVar;
+  ir::Expr idxVar;
+
+  ir::Expr dimension;
+
+  ir::Expr getSizeArr() const;
+  ir::Expr getBitmapArr() const;
+  ir::Expr getRankArr() const;
+
+  ir::Expr getWord() const;
+  ir::Expr getBitInWord() const;
+};
+
+}}
+#endif
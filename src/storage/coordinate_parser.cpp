@@ -0,0 +1,282 @@
+#include "coordinate_parser.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+
+#include "taco/error.h"
+#include "taco/util/parallel.h"
+
+using namespace std;
+
+namespace taco {
+namespace storage {
+
+// Most bytes read from the stream at a time, and the smallest piece of a block
+// that is parsed on its own thread
+static const size_t maxBlockSize = 64 << 20;
+static const size_t minChunkSize = 64 << 10;
+
+static inline bool isDigit(char c) {
+  return (unsigned)(c - '0') < 10;
+}
+
+static inline const char* skipSpaces(const char* p, const char* end) {
+  while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) {
+    p++;
+  }
+  return p;
+}
+
+static inline const char* scanInt(const char* p, const char* end, long* value) {
+  p = skipSpaces(p, end);
+  bool negative = (p < end && *p == '-');
+  if (p < end && (*p == '-' || *p == '+')) {
+    p++;
+  }
+  long result = 0;
+  while (p < end && isDigit(*p)) {
+    result = min(result * 10 + (*p - '0'), (long)INT_MAX + 1);
+    p++;
+  }
+  *value = negative ? -result : result;
+  return p;
+}
+
+/// Scan a decimal floating-point number. Numbers with at most 15 significant
+/// digits and a decimal exponent of at most 22 are exactly representable as a
+/// double times or divided by an exact power of ten, so one correctly rounded
+/// operation gives the same result as strtod. Anything else goes to strtod.
+static inline const char* scanDouble(const char* p, const char* end,
+                                     double* value) {
+  static const double powersOf10[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+  };
+
+  p = skipSpaces(p, end);
+  const char* start = p;
+  bool negative = (p < end && *p == '-');
+  if (p < end && (*p == '-' || *p == '+')) {
+    p++;
+  }
+
+  uint64_t mantissa = 0;
+  int numDigits = 0;
+  int exponent = 0;
+  bool exact = true;
+  bool anyDigits = false;
+  for (bool fraction = false; p < end; p++) {
+    if (isDigit(*p)) {
+      anyDigits = true;
+      if (mantissa != 0 || *p != '0') {
+        exact = exact && (numDigits < 15);
+        mantissa = mantissa * 10 + (*p - '0');
+        numDigits++;
+      }
+      exponent -= fraction;
+    }
+    else if (*p == '.' && !fraction) {
+      fraction = true;
+    }
+    else {
+      break;
+    }
+  }
+  if (p < end && (*p == 'e' || *p == 'E')) {
+    p++;
+    bool negativeExponent = (p < end && *p == '-');
+    if (p < end && (*p == '-' || *p == '+')) {
+      p++;
+    }
+    exact = exact && p < end && isDigit(*p);
+    int explicitExponent = 0;
+    while (p < end && isDigit(*p)) {
+      explicitExponent = min(explicitExponent * 10 + (*p - '0'), 1000);
+      p++;
+    }
+    exponent += negativeExponent ? -explicitExponent : explicitExponent;
+  }
+
+  if (!anyDigits || !exact || exponent < -22 || exponent > 22) {
+    char* numberEnd;
+    *value = strtod(start, &numberEnd);
+    return numberEnd;
+  }
+  double result = (double)mantissa;
+  result = (exponent < 0) ? result / powersOf10[-exponent]
+                          : result * powersOf10[exponent];
+  *value = negative ? -result : result;
+  return p;
+}
+
+/// Parse the lines in [begin,end) into `entries`, and return how many entries
+/// were written.
+static size_t parseLines(const char* begin, const char* end, size_t order,
+                         bool symmetric, char* entries, vector<int>& maxima) {
+  const size_t coordinatesSize = order * sizeof(int);
+  const size_t entrySize = coordinatesSize + sizeof(double);
+
+  size_t numEntries = 0;
+  for (const char* line = begin; line < end;) {
+    const char* lineEnd = (const char*)memchr(line, '\n', end - line);
+    if (lineEnd == nullptr) {
+      lineEnd = end;
+    }
+    const char* p = skipSpaces(line, lineEnd);
+    line = lineEnd + 1;
+    if (p == lineEnd || *p == '#' || *p == '%') {
+      continue;
+    }
+
+    char* entry = entries + numEntries * entrySize;
+    int* coordinates = (int*)entry;
+    for (size_t i = 0; i < order; i++) {
+      long index;
+      p = scanInt(p, lineEnd, &index);
+      taco_uassert(index <= INT_MAX) << "Index exceeds INT_MAX";
+      coordinates[i] = (int)index - 1;
+      maxima[i] = max(maxima[i], (int)index);
+    }
+    double value;
+    p = scanDouble(p, lineEnd, &value);
+    memcpy(entry + coordinatesSize, &value, sizeof(double));
+    numEntries++;
+
+    if (symmetric && coordinates[0] != coordinates[order-1]) {
+      char* transposed = entry + entrySize;
+      reverse_copy(coordinates, coordinates + order, (int*)transposed);
+      memcpy(transposed + coordinatesSize, &value, sizeof(double));
+      numEntries++;
+    }
+  }
+  return numEntries;
+}
+
+/// Parse a block of whole lines and append its entries to `buffer`.
+static void parseBlock(const char* begin, const char* end, size_t order,
+                       bool symmetric, vector<char>& buffer,
+                       vector<int>& maxima) {
+  const size_t entrySize = order * sizeof(int) + sizeof(double);
+  const size_t entriesPerLine = symmetric ? 2 : 1;
+
+  // Split the block into chunks that start at the beginning of a line
+  const size_t size = end - begin;
+  const size_t numChunks = util::getNumChunks(size, minChunkSize);
+  vector<const char*> bounds(numChunks + 1, end);
+  bounds[0] = begin;
+  for (size_t chunk = 1; chunk < numChunks; chunk++) {
+    const char* bound = max(begin + size * chunk / numChunks, bounds[chunk-1]);
+    const char* newline = (const char*)memchr(bound, '\n', end - bound);
+    bounds[chunk] = (newline == nullptr) ? end : newline + 1;
+  }
+
+  // Count the lines of each chunk to bound the space its entries need
+  vector<size_t> offsets(numChunks);
+  util::parallelFor(numChunks, [&](size_t, size_t first, size_t last) {
+    for (size_t chunk = first; chunk < last; chunk++) {
+      const char* chunkBegin = bounds[chunk];
+      const char* chunkEnd = bounds[chunk+1];
+      size_t numLines = count(chunkBegin, chunkEnd, '\n');
+      if (chunkBegin < chunkEnd && chunkEnd[-1] != '\n') {
+        numLines++;
+      }
+      offsets[chunk] = numLines * entriesPerLine;
+    }
+  }, 1);
+  const size_t used = buffer.size();
+  buffer.resize(used + util::parallelExclusiveScan(offsets) * entrySize);
+
+  // Parse each chunk into its own part of the buffer
+  vector<size_t> numEntries(numChunks);
+  vector<vector<int>> chunkMaxima(numChunks, vector<int>(order, 0));
+  char* entries = buffer.data() + used;
+  util::parallelFor(numChunks, [&](size_t, size_t first, size_t last) {
+    for (size_t chunk = first; chunk < last; chunk++) {
+      numEntries[chunk] = parseLines(bounds[chunk], bounds[chunk+1], order,
+                                     symmetric,
+                                     entries + offsets[chunk] * entrySize,
+                                     chunkMaxima[chunk]);
+    }
+  }, 1);
+
+  // Close the gaps left by comments, blank lines and diagonal entries
+  size_t numUsed = used;
+  for (size_t chunk = 0; chunk < numChunks; chunk++) {
+    size_t chunkSize = numEntries[chunk] * entrySize;
+    memmove(buffer.data() + numUsed, entries + offsets[chunk] * entrySize,
+            chunkSize);
+    numUsed += chunkSize;
+    for (size_t i = 0; i < order; i++) {
+      maxima[i] = max(maxima[i], chunkMaxima[chunk][i]);
+    }
+  }
+  buffer.resize(numUsed);
+}
+
+/// Read the stream in blocks and call `parse` on the whole lines of each,
+/// carrying the last partial line over to the next block. Blocks start small so
+/// that small files do not pay for a large buffer.
+static void readBlocks(istream& stream, const string& prefix,
+                       const function<void(const char*,const char*)>& parse) {
+  string block = prefix;
+  size_t blockSize = minChunkSize;
+  bool done = false;
+  while (!done) {
+    size_t carried = block.size();
+    block.resize(carried + blockSize);
+    stream.read(&block[carried], blockSize);
+    blockSize = min(2 * blockSize, maxBlockSize);
+    block.resize(carried + stream.gcount());
+    done = !stream;
+
+    size_t parseSize = block.size();
+    if (!done) {
+      size_t lastNewline = block.find_last_of('\n');
+      if (lastNewline == string::npos) {
+        continue;
+      }
+      parseSize = lastNewline + 1;
+    }
+    parse(block.data(), block.data() + parseSize);
+    block.erase(0, parseSize);
+  }
+}
+
+vector<char> parseCoordinates(istream& stream, size_t order, bool symmetric,
+                              vector<int>* dimensions, const string& prefix) {
+  taco_iassert(!symmetric || order > 0);
+  vector<char> buffer;
+  vector<int> maxima(order, 0);
+  readBlocks(stream, prefix, [&](const char* begin, const char* end) {
+    parseBlock(begin, end, order, symmetric, buffer, maxima);
+  });
+
+  if (dimensions != nullptr) {
+    *dimensions = maxima;
+  }
+  return buffer;
+}
+
+void visitCoordinates(istream& stream, size_t order, bool symmetric,
+                      const function<void(const int*,double)>& visit) {
+  taco_iassert(!symmetric || order > 0);
+  const size_t coordinatesSize = order * sizeof(int);
+  const size_t entrySize = coordinatesSize + sizeof(double);
+  vector<char> buffer;
+  vector<int> maxima(order, 0);
+  readBlocks(stream, "", [&](const char* begin, const char* end) {
+    buffer.clear();
+    parseBlock(begin, end, order, symmetric, buffer, maxima);
+    for (size_t i = 0; i < buffer.size(); i += entrySize) {
+      double value;
+      memcpy(&value, &buffer[i + coordinatesSize], sizeof(double));
+      visit((const int*)&buffer[i], value);
+    }
+  });
+}
+
+}}
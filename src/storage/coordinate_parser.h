@@ -0,0 +1,35 @@
+#ifndef TACO_STORAGE_COORDINATE_PARSER_H
+#define TACO_STORAGE_COORDINATE_PARSER_H
+
+#include <functional>
+#include <istream>
+#include <string>
+#include <vector>
+
+namespace taco {
+namespace storage {
+
+/// Parse the lines of a coordinate file, each holding `order` one-based integer
+/// coordinates followed by a floating-point value, e.g. the body of a .tns or
+/// a coordinate .mtx file. Blank lines and lines that start with '#' or '%' are
+/// skipped. `prefix` is parsed before the rest of the stream.
+///
+/// The stream is read in large blocks that are split at line boundaries and
+/// parsed in parallel. The result is a coordinate buffer that can be passed to
+/// `TensorBase::insertCoordinates`: one entry per line with `order` zero-based
+/// int coordinates followed by a double. If `symmetric` is set, each
+/// off-diagonal entry is followed by its transpose. If `dimensions` is not
+/// null it is set to the largest one-based coordinate of each mode.
+std::vector<char> parseCoordinates(std::istream& stream, size_t order,
+                                   bool symmetric,
+                                   std::vector<int>* dimensions=nullptr,
+                                   const std::string& prefix="");
+
+/// Parse the lines of a coordinate file like `parseCoordinates`, but call
+/// `visit(coordinates, value)` for each entry in file order instead of
+/// returning them. Only one block of entries is buffered at a time.
+void visitCoordinates(std::istream& stream, size_t order, bool symmetric,
+                      const std::function<void(const int*,double)>& visit);
+
+}}
+#endif
@@ -13,9 +13,18 @@ DenseIterator::DenseIterator(std::string name, const Expr& tensor, int level,
   this->tensor = tensor;
   this->level = level;
 
+  // Positions in a dense level are computed from the parent position, so they
+  // need to be at least as wide
+  DataType ptrType = Int();
+  Expr parentPtrVar = previous.getPtrVar();
+  if (parentPtrVar.as<Var>() != nullptr &&
+      parentPtrVar.type().getNumBits() > ptrType.getNumBits()) {
+    ptrType = parentPtrVar.type();
+  }
+
   std::string indexVarName = name + util::toString(tensor);
   ptrVar = Var::make("p" + util::toString(tensor) + std::to_string(level + 1),
-                     Int());
+                     ptrType);
   idxVar = Var::make(indexVarName, Int());
 
   this->dimension = (long long)dimension;
@@ -38,6 +47,10 @@ bool DenseIterator::isSequentialAccess() const {
   return false;
 }
 
+bool DenseIterator::isUnique() const {
+  return true;
+}
+
 Expr DenseIterator::getPtrVar() const {
   return ptrVar;
 }
@@ -67,6 +80,15 @@ Stmt DenseIterator::initDerivedVars() const {
   return VarAssign::make(getPtrVar(), ptrVal);
 }
 
+ir::Stmt DenseIterator::locate(ir::Expr idx) const {
+  Expr ptrVal = Add::make(Mul::make(getParent().getPtrVar(), end()), idx);
+  return VarAssign::make(getPtrVar(), ptrVal, true);
+}
+
+ir::Expr DenseIterator::hasCoordinate() const {
+  return Expr();
+}
+
 ir::Stmt DenseIterator::storePtr() const {
   return Stmt();
 }
@@ -20,6 +20,7 @@ public:
 
   bool isRandomAccess() const;
   bool isSequentialAccess() const;
+  bool isUnique() const;
 
   ir::Expr getPtrVar() const;
   ir::Expr getIdxVar() const;
@@ -29,6 +30,8 @@ public:
   ir::Expr end() const;
 
   ir::Stmt initDerivedVars() const;
+  ir::Stmt locate(ir::Expr idx) const;
+  ir::Expr hasCoordinate() const;
 
   ir::Stmt storePtr() const;
   ir::Stmt storeIdx(ir::Expr idx) const;
@@ -0,0 +1,130 @@
+#include "diagonal_iterator.h"
+
+#include "taco/util/strings.h"
+
+using namespace std;
+using namespace taco::ir;
+
+namespace taco {
+namespace storage {
+
+DiagonalIterator::DiagonalIterator(std::string name, const Expr& tensor,
+                                   int level, size_t dimension,
+                                   size_t numDiagonals, Iterator previous)
+    : IteratorImpl(previous, tensor) {
+  this->tensor = tensor;
+  this->level = level;
+
+  // Positions are computed from the parent position, so they need to be at
+  // least as wide
+  DataType ptrType = Int();
+  Expr parentPtrVar = previous.getPtrVar();
+  if (parentPtrVar.as<Var>() != nullptr &&
+      parentPtrVar.type().getNumBits() > ptrType.getNumBits()) {
+    ptrType = parentPtrVar.type();
+  }
+
+  std::string idxVarName = name + util::toString(tensor);
+  ptrVar = Var::make("p" + util::toString(tensor) + std::to_string(level + 1),
+                     ptrType);
+  idxVar = Var::make(idxVarName, Int());
+
+  this->dimension = (long long)dimension;
+
+  // Kernels are specialized to the number of diagonals when it is known, and
+  // read it from the pos array otherwise
+  this->numDiagonals = (numDiagonals > 0)
+                       ? Expr((long long)numDiagonals)
+                       : Load::make(getPtrArr(), (long long)0);
+}
+
+bool DiagonalIterator::isDense() const {
+  return false;
+}
+
+bool DiagonalIterator::isFixedRange() const {
+  return false;
+}
+
+bool DiagonalIterator::isRandomAccess() const {
+  return false;
+}
+
+bool DiagonalIterator::isSequentialAccess() const {
+  return true;
+}
+
+bool DiagonalIterator::isUnique() const {
+  // Entries outside the matrix are clamped onto its first or last column
+  return false;
+}
+
+Expr DiagonalIterator::getPtrVar() const {
+  return ptrVar;
+}
+
+Expr DiagonalIterator::getIdxVar() const {
+  return idxVar;
+}
+
+Expr DiagonalIterator::getIteratorVar() const {
+  return ptrVar;
+}
+
+Expr DiagonalIterator::begin() const {
+  return Mul::make(getParent().getPtrVar(), numDiagonals);
+}
+
+Expr DiagonalIterator::end() const {
+  return Mul::make(Add::make(getParent().getPtrVar(), (long long) 1),
+                   numDiagonals);
+}
+
+Stmt DiagonalIterator::initDerivedVars() const {
+  // The parent is the dense first level, so its positions are its coordinates
+  Expr offset = Load::make(getIdxArr(), Sub::make(getPtrVar(), begin()));
+  Expr idx = Add::make(getParent().getPtrVar(), offset);
+  idx = Min::make(Max::make(idx, (long long) 0),
+                  Sub::make(dimension, (long long) 1));
+  return VarAssign::make(getIdxVar(), idx, true);
+}
+
+ir::Stmt DiagonalIterator::locate(ir::Expr idx) const {
+  return Stmt();
+}
+
+ir::Expr DiagonalIterator::hasCoordinate() const {
+  return Expr();
+}
+
+ir::Stmt DiagonalIterator::storePtr() const {
+  return Stmt();
+}
+
+ir::Stmt DiagonalIterator::storeIdx(ir::Expr idx) const {
+  return Stmt();
+}
+
+ir::Expr DiagonalIterator::getPtrArr() const {
+  string name = tensor.as<Var>()->name + to_string(level + 1) + "_pos";
+  return GetProperty::make(tensor, TensorProperty::Indices, level, 0, name);
+}
+
+ir::Expr DiagonalIterator::getIdxArr() const {
+  string name = tensor.as<Var>()->name + to_string(level + 1) + "_offsets";
+  return GetProperty::make(tensor, TensorProperty::Indices, level, 1, name);
+}
+
+ir::Stmt DiagonalIterator::initStorage(ir::Expr size) const {
+  return Stmt();
+}
+
+ir::Stmt DiagonalIterator::resizePtrStorage(ir::Expr size) const {
+  return Stmt();
+}
+
+ir::Stmt DiagonalIterator::resizeIdxStorage(ir::Expr size) const {
+  return Stmt();
+}
+
+}}
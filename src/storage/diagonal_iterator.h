@@ -0,0 +1,64 @@
+#ifndef TACO_STORAGE_DIAGONAL_H
+#define TACO_STORAGE_DIAGONAL_H
+
+#include <string>
+
+#include "iterator.h"
+#include "taco/ir/ir.h"
+
+namespace taco {
+namespace storage {
+
+/// Iterates over the diagonal level of a DIA matrix, which stores the same
+/// diagonals in every row. The level has a pos array that holds the number of
+/// diagonals and an idx array of their sorted offsets, and the coordinate of
+/// an entry is the coordinate of its row plus the offset of its diagonal.
+/// Entries of a diagonal that lie outside the matrix have zero values and
+/// coordinates clamped to its first or last column.
+class DiagonalIterator : public IteratorImpl {
+public:
+  DiagonalIterator(std::string name, const ir::Expr& tensor, int level,
+                   size_t dimension, size_t numDiagonals, Iterator previous);
+  virtual ~DiagonalIterator() {};
+
+  bool isDense() const;
+  bool isFixedRange() const;
+
+  bool isRandomAccess() const;
+  bool isSequentialAccess() const;
+  bool isUnique() const;
+
+  ir::Expr getPtrVar() const;
+  ir::Expr getIdxVar() const;
+
+  ir::Expr getIteratorVar() const;
+  ir::Expr begin() const;
+  ir::Expr end() const;
+
+  ir::Stmt initDerivedVars() const;
+  ir::Stmt locate(ir::Expr idx) const;
+  ir::Expr hasCoordinate() const;
+
+  ir::Stmt storePtr() const;
+  ir::Stmt storeIdx(ir::Expr idx) const;
+
+  ir::Stmt initStorage(ir::Expr size) const;
+  ir::Stmt resizePtrStorage(ir::Expr size) const;
+  ir::Stmt resizeIdxStorage(ir::Expr size) const;
+
+private:
+  ir::Expr tensor;
+  int level;
+
+  ir::Expr ptrVar;
+  ir::Expr idxVar;
+
+  ir::Expr getPtrArr() const;
+  ir::Expr getIdxArr() const;
+
+  ir::Expr dimension;
+  ir::Expr numDiagonals;
+};
+
+}}
+#endif
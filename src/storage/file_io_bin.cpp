@@ -0,0 +1,316 @@
+#include "taco/storage/file_io_bin.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "taco/tensor.h"
+#include "taco/format.h"
+#include "taco/error.h"
+#include "taco/storage/storage.h"
+#include "taco/storage/index.h"
+#include "taco/storage/array.h"
+#include "taco/util/files.h"
+
+using namespace std;
+using namespace taco::storage;
+
+namespace taco {
+
+// The file starts with a header that describes the format, the dimensions and
+// the location of every index and value array, followed by the arrays
+// themselves. Each array starts at a multiple of `alignment` bytes from the
+// start of the file, and everything is stored in native byte order.
+static const char     magic[8]      = {'T','A','C','O','B','I','N','\0'};
+static const uint32_t version       = 1;
+static const uint32_t byteOrderMark = 0x01020304;
+static const uint64_t alignment     = 64;
+
+namespace {
+struct Section {
+  DataType type;
+  uint64_t size;
+  uint64_t offset;
+};
+
+struct Header {
+  DataType ctype;
+  vector<int> dimensions;
+  vector<ModeType> modeTypes;
+  vector<size_t> modeOrdering;
+  vector<vector<Section>> levels;
+  Section values;
+};
+}
+
+template <typename T>
+static void writeScalar(ostream& stream, T value) {
+  stream.write((const char*)&value, sizeof(T));
+}
+
+template <typename T>
+static T readScalar(istream& stream) {
+  T value;
+  stream.read((char*)&value, sizeof(T));
+  taco_uassert(!stream.fail()) << "Unexpected end of binary tensor header";
+  return value;
+}
+
+static uint64_t alignOffset(uint64_t offset) {
+  return (offset + alignment - 1) / alignment * alignment;
+}
+
+static uint64_t getNumBytes(const Section& section) {
+  return section.size * section.type.getNumBytes();
+}
+
+static size_t getNumIndexArrays(ModeType modeType) {
+  switch (modeType) {
+    case ModeType::Dense:
+    case ModeType::Singleton:
+      return 1;
+    case ModeType::Sparse:
+    case ModeType::Fixed:
+    case ModeType::Diagonal:
+      return 2;
+    case ModeType::Hashed:
+    case ModeType::Bitmap:
+      return 3;
+  }
+  taco_ierror;
+  return 0;
+}
+
+static void writeSection(ostream& stream, const Section& section) {
+  writeScalar<uint32_t>(stream, section.type.getKind());
+  writeScalar<uint64_t>(stream, section.size);
+  writeScalar<uint64_t>(stream, section.offset);
+}
+
+static Section readSection(istream& stream) {
+  Section section;
+  section.type = DataType((DataType::Kind)readScalar<uint32_t>(stream));
+  section.size = readScalar<uint64_t>(stream);
+  section.offset = readScalar<uint64_t>(stream);
+  return section;
+}
+
+static void writeHeader(ostream& stream, const Header& header) {
+  stream.write(magic, sizeof(magic));
+  writeScalar<uint32_t>(stream, version);
+  writeScalar<uint32_t>(stream, byteOrderMark);
+  writeScalar<uint32_t>(stream, header.dimensions.size());
+  writeScalar<uint32_t>(stream, header.ctype.getKind());
+  for (int dimension : header.dimensions) {
+    writeScalar<int32_t>(stream, dimension);
+  }
+  for (size_t i = 0; i < header.levels.size(); i++) {
+    writeScalar<uint32_t>(stream, header.modeTypes[i]);
+    writeScalar<uint32_t>(stream, header.modeOrdering[i]);
+    writeScalar<uint32_t>(stream, header.levels[i].size());
+    for (const Section& section : header.levels[i]) {
+      writeSection(stream, section);
+    }
+  }
+  writeSection(stream, header.values);
+}
+
+static Header readHeader(istream& stream) {
+  char fileMagic[sizeof(magic)];
+  stream.read(fileMagic, sizeof(fileMagic));
+  taco_uassert(stream && memcmp(fileMagic, magic, sizeof(magic)) == 0)
+      << "Not a binary tensor file";
+  taco_uassert(readScalar<uint32_t>(stream) == version)
+      << "Unsupported binary tensor version";
+  taco_uassert(readScalar<uint32_t>(stream) == byteOrderMark)
+      << "Binary tensor file was written with a different byte order";
+
+  Header header;
+  size_t order = readScalar<uint32_t>(stream);
+  header.ctype = DataType((DataType::Kind)readScalar<uint32_t>(stream));
+  for (size_t i = 0; i < order; i++) {
+    header.dimensions.push_back(readScalar<int32_t>(stream));
+  }
+  for (size_t i = 0; i < order; i++) {
+    ModeType modeType = (ModeType)readScalar<uint32_t>(stream);
+    size_t modeOrdering = readScalar<uint32_t>(stream);
+    size_t numArrays = readScalar<uint32_t>(stream);
+    taco_uassert(modeOrdering < order &&
+                 numArrays == getNumIndexArrays(modeType))
+        << "Corrupt binary tensor header";
+    header.modeTypes.push_back(modeType);
+    header.modeOrdering.push_back(modeOrdering);
+    header.levels.push_back({});
+    for (size_t j = 0; j < numArrays; j++) {
+      header.levels[i].push_back(readSection(stream));
+    }
+  }
+  header.values = readSection(stream);
+  taco_uassert(header.values.type == header.ctype)
+      << "Corrupt binary tensor header";
+  return header;
+}
+
+/// Create an empty tensor with the format and dimensions given by the header,
+/// after checking that the stored format is the requested one.
+static TensorBase makeTensor(const Header& header, const Format& format) {
+  taco_uassert(format.getModeTypes() == header.modeTypes &&
+               format.getModeOrdering() == header.modeOrdering)
+      << "Binary tensor is stored as " << Format(header.modeTypes,
+                                                 header.modeOrdering)
+      << " but was read as " << format;
+
+  Format storedFormat(header.modeTypes, header.modeOrdering);
+  vector<vector<DataType>> levelArrayTypes;
+  for (auto& level : header.levels) {
+    vector<DataType> arrayTypes;
+    for (const Section& section : level) {
+      arrayTypes.push_back(section.type);
+    }
+    levelArrayTypes.push_back(arrayTypes);
+  }
+  storedFormat.setLevelArrayTypes(levelArrayTypes);
+  return TensorBase(header.ctype, header.dimensions, storedFormat);
+}
+
+/// Set the storage of the tensor to the arrays returned by `getArray` for each
+/// section of the header.
+template <typename GetArray>
+static void setStorage(TensorBase& tensor, const Header& header,
+                       GetArray getArray) {
+  vector<ModeIndex> modeIndices;
+  for (auto& level : header.levels) {
+    vector<Array> indexArrays;
+    for (const Section& section : level) {
+      indexArrays.push_back(getArray(section));
+    }
+    modeIndices.push_back(ModeIndex(indexArrays));
+  }
+  Storage& storage = tensor.getStorage();
+  storage.setIndex(Index(storage.getFormat(), modeIndices));
+  storage.setValues(getArray(header.values));
+}
+
+TensorBase readBin(std::string filename, const Format& format, bool pack) {
+  std::fstream file;
+  util::openStream(file, filename, fstream::in | fstream::binary);
+  Header header = readHeader(file);
+  file.close();
+  TensorBase tensor = makeTensor(header, format);
+
+  int fd = open(filename.c_str(), O_RDONLY);
+  taco_uassert(fd != -1) << "Error opening file: " << filename;
+  struct stat fileStat;
+  taco_uassert(fstat(fd, &fileStat) == 0) << "Error reading file: " << filename;
+  size_t fileSize = fileStat.st_size;
+
+  // Mapped pages are copy-on-write, so writes to the tensor never reach the file
+  void* data = mmap(nullptr, fileSize, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                    fd, 0);
+  close(fd);
+  taco_uassert(data != MAP_FAILED) << "Error mapping file: " << filename;
+  shared_ptr<void> mapping(data, [fileSize](void* data) {
+    munmap(data, fileSize);
+  });
+
+  setStorage(tensor, header, [&](const Section& section) -> Array {
+    taco_uassert(section.offset % alignment == 0 &&
+                 section.offset + getNumBytes(section) <= fileSize)
+        << "Binary tensor file is truncated: " << filename;
+    return Array(section.type, (char*)data + section.offset, section.size,
+                 mapping);
+  });
+  return tensor;
+}
+
+TensorBase readBin(std::istream& stream, const Format& format, bool pack) {
+  Header header = readHeader(stream);
+  TensorBase tensor = makeTensor(header, format);
+
+  // Sections are stored in increasing order of offset after the header, so
+  // they can be read without seeking
+  ostringstream headerStream;
+  writeHeader(headerStream, header);
+  uint64_t position = headerStream.str().size();
+  setStorage(tensor, header, [&](const Section& section) -> Array {
+    taco_uassert(section.offset >= position) << "Corrupt binary tensor header";
+    stream.ignore(section.offset - position);
+    size_t numBytes = getNumBytes(section);
+    void* data = malloc(numBytes);
+    stream.read((char*)data, numBytes);
+    taco_uassert(!stream.fail()) << "Binary tensor stream is truncated";
+    position = section.offset + numBytes;
+    return Array(section.type, data, section.size, Array::Free);
+  });
+  return tensor;
+}
+
+void writeBin(std::string filename, const TensorBase& tensor) {
+  std::fstream file;
+  util::openStream(file, filename,
+                   fstream::out | fstream::trunc | fstream::binary);
+  writeBin(file, tensor);
+  file.close();
+}
+
+void writeBin(std::ostream& stream, const TensorBase& tensor) {
+  const Storage& storage = tensor.getStorage();
+  const Format& format = storage.getFormat();
+
+  Header header;
+  header.ctype = tensor.getComponentType();
+  header.dimensions = tensor.getDimensions();
+  header.modeTypes = format.getModeTypes();
+  header.modeOrdering = format.getModeOrdering();
+
+  vector<Array> arrays;
+  for (size_t i = 0; i < tensor.getOrder(); i++) {
+    const ModeIndex& modeIndex = storage.getIndex().getModeIndex(i);
+    taco_iassert(modeIndex.numIndexArrays() ==
+                 getNumIndexArrays(format.getModeTypes()[i]));
+    header.levels.push_back({});
+    for (size_t j = 0; j < modeIndex.numIndexArrays(); j++) {
+      const Array& array = modeIndex.getIndexArray(j);
+      header.levels[i].push_back({array.getType(), array.getSize(), 0});
+      arrays.push_back(array);
+    }
+  }
+  const Array& values = storage.getValues();
+  header.values = {values.getType(), values.getSize(), 0};
+  arrays.push_back(values);
+
+  // The header size does not depend on the offsets, so measure it first and
+  // then lay the arrays out after it
+  ostringstream headerStream;
+  writeHeader(headerStream, header);
+  uint64_t offset = headerStream.str().size();
+  for (auto& level : header.levels) {
+    for (Section& section : level) {
+      section.offset = alignOffset(offset);
+      offset = section.offset + getNumBytes(section);
+    }
+  }
+  header.values.offset = alignOffset(offset);
+
+  writeHeader(stream, header);
+  uint64_t position = headerStream.str().size();
+  const vector<char> padding(alignment, 0);
+  for (const Array& array : arrays) {
+    uint64_t aligned = alignOffset(position);
+    stream.write(padding.data(), aligned - position);
+    size_t numBytes = array.getSize() * array.getType().getNumBytes();
+    stream.write((const char*)array.getData(), numBytes);
+    position = aligned + numBytes;
+  }
+  taco_uassert(!stream.fail()) << "Error writing binary tensor";
+}
+
+}
@@ -5,6 +5,9 @@
 #include <sstream>
 #include <cstdlib>
 #include <climits>
+#include <algorithm>
+#include <cstring>
+#include <vector>
 
 #include "taco/tensor.h"
 #include "taco/format.h"
@@ -12,20 +15,28 @@
 #include "taco/util/strings.h"
 #include "taco/util/timers.h"
 #include "taco/util/files.h"
+#include "taco/util/parallel.h"
+#include "taco/storage/storage.h"
+#include "taco/storage/index.h"
+#include "taco/storage/array.h"
+#include "taco/storage/array_util.h"
+#include "coordinate_parser.h"
 
 using namespace std;
 
 namespace taco {
 
-TensorBase readMTX(std::string filename, const Format& format, bool pack) {
+TensorBase readMTX(std::string filename, const Format& format, bool pack,
+                   DuplicatePolicy policy) {
   std::fstream file;
   util::openStream(file, filename, fstream::in);
-  TensorBase tensor = readMTX(file, format, pack);
+  TensorBase tensor = readMTX(file, format, pack, policy);
   file.close();
   return tensor;
 }
 
-TensorBase readMTX(std::istream& stream, const Format& format, bool pack) {
+TensorBase readMTX(std::istream& stream, const Format& format, bool pack,
+                   DuplicatePolicy policy) {
   string line;
   if (!std::getline(stream, line)) {
     return TensorBase();
@@ -49,7 +60,10 @@ TensorBase readMTX(std::istream& stream, const Format& format, bool pack) {
   bool symm = (symmetry=="symmetric");
 
   TensorBase tensor;
-  if (formats=="coordinate")
+  if (formats=="coordinate" && pack && isCompressedMatrix(format) &&
+      stream.tellg() != -1)
+    return readSparseCompressed(stream,format,symm,policy);
+  else if (formats=="coordinate")
     tensor = readSparse(stream,format,symm);
   else if (formats=="array")
     tensor = readDense(stream,format,symm);
@@ -57,13 +71,16 @@ TensorBase readMTX(std::istream& stream, const Format& format, bool pack) {
     taco_uerror << "MatrixMarket format not available";
 
   if (pack) {
+    tensor.setDuplicatePolicy(policy);
     tensor.pack();
   }
 
   return tensor;
 }
 
-TensorBase readSparse(std::istream& stream, const Format& format, bool symm) {
+/// Skip the comments after the banner line and read the size line of a
+/// coordinate file, returning the dimensions.
+static vector<int> readSparseHeader(std::istream& stream, bool symm) {
   string line;
   std::getline(stream,line);
 
@@ -84,48 +101,145 @@ TensorBase readSparse(std::istream& stream, const Format& format, bool symm) {
     taco_uassert(dimension <= INT_MAX) << "Dimension exceeds INT_MAX";
     dimensions.push_back(static_cast<int>(dimension));
   }
-  size_t nnz = dimensions[dimensions.size()-1];
+  // The last number is the number of nonzeros, which the parser does not need
   dimensions.pop_back();
   if (symm)
     taco_uassert(dimensions.size()==2) << "Symmetry only available for matrix";
+  return dimensions;
+}
 
-  vector<int> coordinates;
-  vector<double> values;
-  coordinates.reserve(nnz*dimensions.size());
-  values.reserve(nnz);
+TensorBase readSparse(std::istream& stream, const Format& format, bool symm) {
+  vector<int> dimensions = readSparseHeader(stream, symm);
 
-  while (std::getline(stream, line)) {
-    linePtr = (char*)line.data();
-    for (size_t i=0; i < dimensions.size(); i++) {
-      long index = strtol(linePtr, &linePtr, 10);
-      taco_uassert(index <= INT_MAX) << "Index exceeds INT_MAX";
-      coordinates.push_back(static_cast<int>(index));
-    }
-    double val = strtod(linePtr, &linePtr);
-    values.push_back(val);
+  // Create matrix
+  TensorBase tensor(type<double>(), dimensions, format);
+  tensor.insertCoordinates(storage::parseCoordinates(stream, dimensions.size(),
+                                                     symm));
+  return tensor;
+}
+
+bool isCompressedMatrix(const Format& format) {
+  if (format.getOrder() != 2 ||
+      format.getModeTypes() != vector<ModeType>({Dense, Sparse})) {
+    return false;
   }
+  auto& levelArrayTypes = format.getLevelArrayTypes();
+  return levelArrayTypes.empty() ||
+         (format.getCoordinateTypePos(1) == type<int>() &&
+          format.getCoordinateTypeIdx(1) == type<int>());
+}
 
-  // Create matrix
+TensorBase readSparseCompressed(std::istream& stream, const Format& format,
+                                bool symm, DuplicatePolicy policy) {
+  taco_iassert(isCompressedMatrix(format));
+  vector<int> dimensions = readSparseHeader(stream, symm);
+  taco_uassert(dimensions.size() == 2) << "Expected a matrix";
   TensorBase tensor(type<double>(), dimensions, format);
-  if (symm)
-    tensor.reserve(2*nnz);
-  else
-    tensor.reserve(nnz);
+  tensor.setDuplicatePolicy(policy);
+
+  // Rows are the outer level of the format, i.e. columns for CSC
+  const size_t rowMode = format.getModeOrdering()[0];
+  const size_t colMode = format.getModeOrdering()[1];
+  const int numRows = dimensions[rowMode];
+  auto checkBounds = [&](const int* coord) {
+    taco_uassert(coord[0] >= 0 && coord[0] < dimensions[0] &&
+                 coord[1] >= 0 && coord[1] < dimensions[1])
+        << "Coordinate (" << coord[0]+1 << "," << coord[1]+1 << ") "
+        << "is out of bounds";
+  };
+
+  // First pass: count the entries of each row
+  std::streampos start = stream.tellg();
+  vector<size_t> rowEnds(numRows + 1, 0);
+  storage::visitCoordinates(stream, 2, symm, [&](const int* coord, double) {
+    checkBounds(coord);
+    rowEnds[coord[rowMode] + 1]++;
+  });
+  for (int row = 0; row < numRows; row++) {
+    rowEnds[row + 1] += rowEnds[row];
+  }
+  const size_t nnz = rowEnds[numRows];
+  taco_uassert(nnz <= INT_MAX) << "Number of nonzeros exceeds INT_MAX";
+
+  int* pos = (int*)malloc((numRows + 1) * sizeof(int));
+  int* idx = (int*)malloc(nnz * sizeof(int));
+  double* vals = (double*)malloc(nnz * sizeof(double));
+  for (int row = 0; row <= numRows; row++) {
+    pos[row] = (int)rowEnds[row];
+  }
 
-  // Insert coordinates
-  std::vector<int> coord;
-  for (size_t i = 0; i < nnz; i++) {
-    coord.clear();
-    for (size_t mode = 0; mode < dimensions.size(); mode++) {
-      coord.push_back(coordinates[i*dimensions.size() + mode] -1);
+  // Second pass: scatter each entry to the end of its row. rowEnds is reused
+  // as the next free position of each row.
+  stream.clear();
+  stream.seekg(start);
+  storage::visitCoordinates(stream, 2, symm, [&](const int* coord,
+                                                 double value) {
+    checkBounds(coord);
+    const int row = coord[rowMode];
+    taco_uassert(rowEnds[row] < (size_t)pos[row + 1])
+        << "File changed while it was read";
+    const size_t k = rowEnds[row]++;
+    idx[k] = coord[colMode];
+    vals[k] = value;
+  });
+
+  // Sort each row by column and look for duplicate coordinates
+  vector<char> hasDuplicates(util::getNumChunks(numRows, 1 << 10), false);
+  util::parallelFor(numRows, [&](size_t chunk, size_t begin, size_t end) {
+    vector<pair<int,double>> entries;
+    for (size_t row = begin; row < end; row++) {
+      int* rowIdx = idx + pos[row];
+      int* rowIdxEnd = idx + pos[row + 1];
+      if (!std::is_sorted(rowIdx, rowIdxEnd)) {
+        double* rowVals = vals + pos[row];
+        entries.clear();
+        for (int* col = rowIdx; col < rowIdxEnd; col++) {
+          entries.push_back({*col, rowVals[col - rowIdx]});
+        }
+        std::stable_sort(entries.begin(), entries.end(),
+                         [](const pair<int,double>& a,
+                            const pair<int,double>& b) {
+                           return a.first < b.first;
+                         });
+        for (size_t k = 0; k < entries.size(); k++) {
+          rowIdx[k] = entries[k].first;
+          rowVals[k] = entries[k].second;
+        }
+      }
+      if (std::adjacent_find(rowIdx, rowIdxEnd) != rowIdxEnd) {
+        hasDuplicates[chunk] = true;
+      }
     }
-    tensor.insert(coord, values[i]);
-    if (symm && coord.front() != coord.back()) {
-      std::reverse(coord.begin(), coord.end());
-      tensor.insert(coord, values[i]);
+  }, 1 << 10);
+
+  // Duplicates are rare, so leave merging them to pack, which combines them as
+  // the caller's duplicate policy says
+  if (std::find(hasDuplicates.begin(), hasDuplicates.end(), true) !=
+      hasDuplicates.end()) {
+    const size_t coordinateSize = 2 * sizeof(int) + sizeof(double);
+    vector<char> coordinates(nnz * coordinateSize);
+    for (int row = 0; row < numRows; row++) {
+      for (int k = pos[row]; k < pos[row + 1]; k++) {
+        char* entry = &coordinates[k * coordinateSize];
+        ((int*)entry)[rowMode] = row;
+        ((int*)entry)[colMode] = idx[k];
+        memcpy(entry + 2 * sizeof(int), &vals[k], sizeof(double));
+      }
     }
+    free(pos);
+    free(idx);
+    free(vals);
+    tensor.insertCoordinates(std::move(coordinates));
+    tensor.pack();
+    return tensor;
   }
 
+  storage::Storage& storage = tensor.getStorage();
+  storage.setIndex(storage::Index(storage.getFormat(), {
+      storage::ModeIndex({storage::makeArray({numRows})}),
+      storage::ModeIndex({storage::Array(type<int>(), pos, numRows + 1),
+                          storage::Array(type<int>(), idx, nnz)})}));
+  storage.setValues(storage::Array(type<double>(), vals, nnz));
   return tensor;
 }
 
@@ -13,6 +13,7 @@
 #include "taco/error.h"
 #include "taco/util/strings.h"
 #include "taco/util/files.h"
+#include "coordinate_parser.h"
 
 using namespace std;
 
@@ -27,47 +28,24 @@ TensorBase readTNS(std::string filename, const Format& format, bool pack) {
 }
 
 TensorBase readTNS(std::istream& stream, const Format& format, bool pack) {
-  std::vector<int>    coordinates;
-  std::vector<double> values;
-
-  std::string line;
-  if (!std::getline(stream, line)) {
-    return TensorBase();
-  }
-
   // Infer tensor order from the first coordinate
+  std::string line;
+  do {
+    if (!std::getline(stream, line)) {
+      return TensorBase();
+    }
+  } while (line.empty() || line[0] == '#');
   vector<string> toks = util::split(line, " ");
   size_t order = toks.size()-1;
-  std::vector<int> dimensions(order);
-  std::vector<int> coordinate(order);
 
   // Load data
-  do {
-    char* linePtr = (char*)line.data();
-    for (size_t i = 0; i < order; i++) {
-      long idx = strtol(linePtr, &linePtr, 10);
-      taco_uassert(idx <= INT_MAX)<<"Coordinate in file is larger than INT_MAX";
-      coordinate[i] = (int)idx - 1;
-      dimensions[i] = std::max(dimensions[i], (int)idx);
-    }
-    coordinates.insert(coordinates.end(), coordinate.begin(), coordinate.end());
-    double val = strtod(linePtr, &linePtr);
-    values.push_back(val);
-
-  } while (std::getline(stream, line));
+  std::vector<int> dimensions;
+  std::vector<char> coordinates =
+      storage::parseCoordinates(stream, order, false, &dimensions, line + "\n");
 
   // Create tensor
-  const size_t nnz = values.size();
   TensorBase tensor(type<double>(), dimensions, format);
-  tensor.reserve(nnz);
-
-  // Insert coordinates (TODO add and use bulk insertion)
-  for (size_t i = 0; i < nnz; i++) {
-    for (size_t j = 0; j < order; j++) {
-      coordinate[j] = coordinates[i*order + j];
-    }
-    tensor.insert(coordinate, values[i]);
-  }
+  tensor.insertCoordinates(std::move(coordinates));
 
   if (pack) {
     tensor.pack();
@@ -2,6 +2,7 @@
 
 #include "taco/util/strings.h"
 
+using namespace std;
 using namespace taco::ir;
 
 namespace taco {
@@ -13,12 +14,24 @@ FixedIterator::FixedIterator(std::string name, const Expr& tensor, int level,
   this->tensor = tensor;
   this->level = level;
 
+  // Positions are computed from the parent position, so they need to be at
+  // least as wide
+  DataType ptrType = Int();
+  Expr parentPtrVar = previous.getPtrVar();
+  if (parentPtrVar.as<Var>() != nullptr &&
+      parentPtrVar.type().getNumBits() > ptrType.getNumBits()) {
+    ptrType = parentPtrVar.type();
+  }
+
   std::string idxVarName = name + util::toString(tensor);
-  ptrVar = Var::make(util::toString(tensor) + std::to_string(level) + "_ptr",
-                     Int());
-  idxVar = Var::make(idxVarName,Int());
+  ptrVar = Var::make("p" + util::toString(tensor) + std::to_string(level + 1),
+                     ptrType);
+  idxVar = Var::make(idxVarName, Int());
 
-  this->fixedSize = (long long)fixedSize;
+  // Kernels are specialized to the segment size when it is known, and read it
+  // from the pos array otherwise
+  this->fixedSize = (fixedSize > 0) ? Expr((long long)fixedSize)
+                                    : Load::make(getPtrArr(), (long long)0);
 }
 
 bool FixedIterator::isDense() const {
@@ -37,6 +50,11 @@ bool FixedIterator::isSequentialAccess() const {
   return true;
 }
 
+bool FixedIterator::isUnique() const {
+  // Segments are padded with copies of their last coordinate
+  return false;
+}
+
 Expr FixedIterator::getPtrVar() const {
   return ptrVar;
 }
@@ -50,17 +68,24 @@ Expr FixedIterator::getIteratorVar() const {
 }
 
 Expr FixedIterator::begin() const {
-  return (long long) 0;
+  return Mul::make(getParent().getPtrVar(), fixedSize);
 }
 
 Expr FixedIterator::end() const {
-  return fixedSize;
+  return Mul::make(Add::make(getParent().getPtrVar(), (long long) 1), fixedSize);
 }
 
 Stmt FixedIterator::initDerivedVars() const {
-  Expr ptrVal = Add::make(Mul::make(getParent().getPtrVar(), end()),
-                          getIdxVar());
-  return VarAssign::make(getIdxVar(), ptrVal);
+  return VarAssign::make(getIdxVar(), Load::make(getIdxArr(), getPtrVar()),
+                         true);
+}
+
+ir::Stmt FixedIterator::locate(ir::Expr idx) const {
+  return Stmt();
+}
+
+ir::Expr FixedIterator::hasCoordinate() const {
+  return Expr();
 }
 
 ir::Stmt FixedIterator::storePtr() const {
@@ -68,20 +93,21 @@ ir::Stmt FixedIterator::storePtr() const {
 }
 
 ir::Stmt FixedIterator::storeIdx(ir::Expr idx) const {
-  return Store::make(getIdxArr(), getPtrVar(), idx);
+  return Stmt();
 }
 
 ir::Expr FixedIterator::getPtrArr() const {
-  return GetProperty::make(tensor, TensorProperty::Dimension, level);
+  string name = tensor.as<Var>()->name + to_string(level + 1) + "_pos";
+  return GetProperty::make(tensor, TensorProperty::Indices, level, 0, name);
 }
 
 ir::Expr FixedIterator::getIdxArr() const {
-  return GetProperty::make(tensor, TensorProperty::Dimension, level);
+  string name = tensor.as<Var>()->name + to_string(level + 1) + "_idx";
+  return GetProperty::make(tensor, TensorProperty::Indices, level, 1, name);
 }
 
 ir::Stmt FixedIterator::initStorage(ir::Expr size) const {
-  return Block::make({Allocate::make(getPtrArr(), (long long) 1),
-                      Allocate::make(getIdxArr(), size)});
+  return Stmt();
 }
 
 ir::Stmt FixedIterator::resizePtrStorage(ir::Expr size) const {
@@ -89,7 +115,7 @@ ir::Stmt FixedIterator::resizePtrStorage(ir::Expr size) const {
 }
 
 ir::Stmt FixedIterator::resizeIdxStorage(ir::Expr size) const {
-  return Allocate::make(getIdxArr(), size, true);
+  return Stmt();
 }
 
 }}
@@ -9,6 +9,10 @@
 namespace taco {
 namespace storage {
 
+/// Iterates over a fixed level, whose segments all store the same number of
+/// coordinates. The level has a pos array that holds the segment size and an
+/// idx array of coordinates, where segments with fewer coordinates are padded
+/// with copies of their last coordinate and zero values.
 class FixedIterator : public IteratorImpl {
 public:
   FixedIterator(std::string name, const ir::Expr& tensor, int level,
@@ -20,6 +24,7 @@ public:
 
   bool isRandomAccess() const;
   bool isSequentialAccess() const;
+  bool isUnique() const;
 
   ir::Expr getPtrVar() const;
   ir::Expr getIdxVar() const;
@@ -29,6 +34,8 @@ public:
   ir::Expr end() const;
 
   ir::Stmt initDerivedVars() const;
+  ir::Stmt locate(ir::Expr idx) const;
+  ir::Expr hasCoordinate() const;
 
   ir::Stmt storePtr() const;
   ir::Stmt storeIdx(ir::Expr idx) const;
@@ -0,0 +1,154 @@
+#include "hashed_iterator.h"
+
+#include "taco/util/strings.h"
+
+using namespace std;
+using namespace taco::ir;
+
+namespace taco {
+namespace storage {
+
+HashedIterator::HashedIterator(std::string name, const Expr& tensor, int level,
+                               Iterator previous)
+    : IteratorImpl(previous, tensor) {
+  this->tensor = tensor;
+  this->level = level;
+
+  // Slots are numbered across all segments, so positions need to be at least
+  // as wide as the parent positions
+  DataType ptrType = Int();
+  Expr parentPtrVar = previous.getPtrVar();
+  if (parentPtrVar.as<Var>() != nullptr &&
+      parentPtrVar.type().getNumBits() > ptrType.getNumBits()) {
+    ptrType = parentPtrVar.type();
+  }
+  std::string idxVarName = name + util::toString(tensor);
+  ptrVar = Var::make("p" + util::toString(tensor) + std::to_string(level + 1),
+                     ptrType);
+  idxVar = Var::make(idxVarName, Int());
+}
+
+bool HashedIterator::isDense() const {
+  return false;
+}
+
+bool HashedIterator::isFixedRange() const {
+  return false;
+}
+
+bool HashedIterator::isRandomAccess() const {
+  return true;
+}
+
+bool HashedIterator::isSequentialAccess() const {
+  return false;
+}
+
+bool HashedIterator::isUnique() const {
+  return true;
+}
+
+Expr HashedIterator::getPtrVar() const {
+  return ptrVar;
+}
+
+Expr HashedIterator::getIdxVar() const {
+  return idxVar;
+}
+
+Expr HashedIterator::getIteratorVar() const {
+  return ptrVar;
+}
+
+Expr HashedIterator::begin() const {
+  return Load::make(getPtrArr(), getParent().getPtrVar());
+}
+
+Expr HashedIterator::end() const {
+  return Load::make(getPtrArr(), Add::make(getParent().getPtrVar(),
+                                           (long long) 1));
+}
+
+Stmt HashedIterator::initDerivedVars() const {
+  return VarAssign::make(getIdxVar(), Load::make(getIdxArr(), getPtrVar()),
+                         true);
+}
+
+ir::Stmt HashedIterator::locate(ir::Expr idx) const {
+  // Probe linearly from slot `idx mod capacity` of the parent's segment until
+  // the slot that holds `idx` or the first empty slot. Segments are kept at
+  // most half full, so there always is an empty slot.
+  Expr mask = Sub::make(getCapacity(), (long long) 1);
+  Expr segment = begin();
+  Expr slot = Load::make(getIdxArr(), getPtrVar());
+  Expr probe = And::make(Neq::make(slot, (long long) -1), Neq::make(slot, idx));
+  Expr offset = Sub::make(getPtrVar(), segment);
+  Expr next = Add::make(segment, BitAnd::make(Add::make(offset, (long long) 1),
+                                              mask));
+  return Block::make({
+    VarAssign::make(getPtrVar(), Add::make(segment, BitAnd::make(idx, mask)),
+                    true),
+    While::make(probe, VarAssign::make(getPtrVar(), next))
+  });
+}
+
+ir::Expr HashedIterator::hasCoordinate() const {
+  return Neq::make(Load::make(getIdxArr(), getPtrVar()), (long long) -1);
+}
+
+ir::Stmt HashedIterator::storePtr() const {
+  return Stmt();
+}
+
+ir::Stmt HashedIterator::storeIdx(ir::Expr idx) const {
+  // Claim an empty slot if the segment stays at most half full. Otherwise mark
+  // the segment as overflowed by setting its size to the capacity, so that the
+  // runtime can retry with a larger capacity for this segment.
+  Expr sizeLoc = getParent().getPtrVar();
+  Expr size = Load::make(getSizeArr(), sizeLoc);
+  Expr slot = Load::make(getIdxArr(), getPtrVar());
+  Expr fits = Lte::make(Mul::make((long long) 2, Add::make(size, (long long) 1)),
+                        getCapacity());
+  Stmt insert = Block::make({
+    Store::make(getIdxArr(), getPtrVar(), idx),
+    Store::make(getSizeArr(), sizeLoc, Add::make(size, (long long) 1))
+  });
+  Stmt overflow = Store::make(getSizeArr(), sizeLoc, getCapacity());
+  return IfThenElse::make(Eq::make(slot, (long long) -1),
+                          Block::make({IfThenElse::make(fits, insert,
+                                                        overflow)}));
+}
+
+ir::Expr HashedIterator::getPtrArr() const {
+  string name = tensor.as<Var>()->name + to_string(level + 1) + "_pos";
+  return GetProperty::make(tensor, TensorProperty::Indices, level, 0, name);
+}
+
+ir::Expr HashedIterator::getIdxArr() const {
+  string name = tensor.as<Var>()->name + to_string(level + 1) + "_idx";
+  return GetProperty::make(tensor, TensorProperty::Indices, level, 1, name);
+}
+
+ir::Expr HashedIterator::getSizeArr() const {
+  string name = tensor.as<Var>()->name + to_string(level + 1) + "_size";
+  return GetProperty::make(tensor, TensorProperty::Indices, level, 2, name);
+}
+
+ir::Expr HashedIterator::getCapacity() const {
+  return Sub::make(end(), begin());
+}
+
+ir::Stmt HashedIterator::initStorage(ir::Expr size) const {
+  // Hashed levels are allocated by the runtime, which picks their capacity
+  return Stmt();
+}
+
+ir::Stmt HashedIterator::resizePtrStorage(ir::Expr size) const {
+  return Stmt();
+}
+
+ir::Stmt HashedIterator::resizeIdxStorage(ir::Expr size) const {
+  return Stmt();
+}
+
+}}
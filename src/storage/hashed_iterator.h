@@ -0,0 +1,63 @@
+#ifndef TACO_STORAGE_HASHED_H
+#define TACO_STORAGE_HASHED_H
+
+#include <string>
+
+#include "iterator.h"
+#include "taco/ir/ir.h"
+
+namespace taco {
+namespace storage {
+
+/// Iterates over a hashed level, whose segments are open addressing hash
+/// tables of coordinates that each have their own power of two capacity. The
+/// level has a pos array that holds the first slot of each segment followed by
+/// the number of slots, an idx array of slots that hold either a coordinate or
+/// -1, and a size array with the number of coordinates in each segment.
+/// Coordinates can be located and inserted in any order.
+class HashedIterator : public IteratorImpl {
+public:
+  HashedIterator(std::string name, const ir::Expr& tensor, int level,
+                 Iterator previous);
+  virtual ~HashedIterator() {};
+
+  bool isDense() const;
+  bool isFixedRange() const;
+
+  bool isRandomAccess() const;
+  bool isSequentialAccess() const;
+  bool isUnique() const;
+
+  ir::Expr getPtrVar() const;
+  ir::Expr getIdxVar() const;
+
+  ir::Expr getIteratorVar() const;
+  ir::Expr begin() const;
+  ir::Expr end() const;
+
+  ir::Stmt initDerivedVars() const;
+  ir::Stmt locate(ir::Expr idx) const;
+  ir::Expr hasCoordinate() const;
+
+  ir::Stmt storePtr() const;
+  ir::Stmt storeIdx(ir::Expr idx) const;
+
+  ir::Stmt initStorage(ir::Expr size) const;
+  ir::Stmt resizePtrStorage(ir::Expr size) const;
+  ir::Stmt resizeIdxStorage(ir::Expr size) const;
+
+private:
+  ir::Expr tensor;
+  int level;
+
+  ir::Expr ptrVar;
+  ir::Expr idxVar;
+
+  ir::Expr getPtrArr() const;
+  ir::Expr getIdxArr() const;
+  ir::Expr getSizeArr() const;
+  ir::Expr getCapacity() const;
+};
+
+}}
+#endif
@@ -46,6 +46,12 @@ ModeIndex Index::getModeIndex(size_t mode) {
 }
 
 size_t Index::getSize() const {
+  std::vector<size_t> levelSizes = getLevelSizes();
+  return levelSizes.empty() ? 1 : levelSizes.back();
+}
+
+std::vector<size_t> Index::getLevelSizes() const {
+  std::vector<size_t> levelSizes;
   size_t size = 1;
   for (size_t i = 0; i < getFormat().getOrder(); i++) {
     auto modeType  = getFormat().getModeTypes()[i];
@@ -54,15 +60,26 @@ size_t Index::getSize() const {
       case ModeType::Dense:
         size *= modeIndex.getIndexArray(0).get(0).getAsIndex();
         break;
+      case ModeType::Bitmap: {
+        // The rank array ends with the number of set bits
+        size_t numBits = size * modeIndex.getIndexArray(0).get(0).getAsIndex();
+        size = modeIndex.getIndexArray(2).get((numBits + 63) / 64).getAsIndex();
+        break;
+      }
       case ModeType::Sparse:
+      case ModeType::Hashed:
         size = modeIndex.getIndexArray(0).get(size).getAsIndex();
         break;
       case ModeType::Fixed:
+      case ModeType::Diagonal:
         size *= modeIndex.getIndexArray(0).get(0).getAsIndex();
         break;
+      case ModeType::Singleton:
+        break;
     }
+    levelSizes.push_back(size);
   }
-  return size;
+  return levelSizes;
 }
 
 std::ostream& operator<<(std::ostream& os, const Index& index) {
@@ -4,6 +4,10 @@
 #include "dense_iterator.h"
 #include "sparse_iterator.h"
 #include "fixed_iterator.h"
+#include "singleton_iterator.h"
+#include "hashed_iterator.h"
+#include "bitmap_iterator.h"
+#include "diagonal_iterator.h"
 
 #include "taco/tensor.h"
 #include "taco/index_notation/index_notation.h"
@@ -31,7 +35,7 @@ Iterator Iterator::makeRoot(const ir::Expr& tensor) {
 Iterator Iterator::make(const lower::TensorPath& path,
                         string name, const ir::Expr& tensorVar,
                         size_t mode, ModeType modeType, size_t modeOrdering,
-                        Iterator parent, const Type& type) {
+                        Iterator parent, const Type& type, bool unique) {
   Iterator iterator;
   iterator.path = path;
 
@@ -46,16 +50,42 @@ Iterator Iterator::make(const lower::TensorPath& path,
     }
     case ModeType::Sparse: {
       iterator.iterator =
-          std::make_shared<SparseIterator>(name, tensorVar, mode, parent);
+          std::make_shared<SparseIterator>(name, tensorVar, mode, parent,
+                                           unique);
+      break;
+    }
+    case ModeType::Singleton: {
+      iterator.iterator =
+          std::make_shared<SingletonIterator>(name, tensorVar, mode, parent);
+      break;
+    }
+    case ModeType::Hashed: {
+      iterator.iterator =
+          std::make_shared<HashedIterator>(name, tensorVar, mode, parent);
+      break;
+    }
+    case ModeType::Bitmap: {
+      taco_tassert(type.getShape().getDimension(modeOrdering).isFixed());
+      size_t dimension = type.getShape().getDimension(modeOrdering).getSize();
+      iterator.iterator =
+          std::make_shared<BitmapIterator>(name, tensorVar, mode, dimension,
+                                           parent);
       break;
     }
     case ModeType::Fixed: {
-//      auto modeIndex = tensor.getStorage().getIndex().getModeIndex(mode);
-//      int fixedSize = getValue<int>(modeIndex.getIndexArray(0), 0);
-//      iterator.iterator =
-//          std::make_shared<FixedIterator>(name, tensorVar, mode, fixedSize,
-//                                          parent);
-      taco_not_supported_yet;
+      size_t fixedSize = tensorVar.as<ir::Var>()->format.getFixedSize(mode);
+      iterator.iterator =
+          std::make_shared<FixedIterator>(name, tensorVar, mode, fixedSize,
+                                           parent);
+      break;
+    }
+    case ModeType::Diagonal: {
+      taco_tassert(type.getShape().getDimension(modeOrdering).isFixed());
+      size_t dimension = type.getShape().getDimension(modeOrdering).getSize();
+      size_t numDiagonals = tensorVar.as<ir::Var>()->format.getFixedSize(mode);
+      iterator.iterator =
+          std::make_shared<DiagonalIterator>(name, tensorVar, mode, dimension,
+                                             numDiagonals, parent);
       break;
     }
   }
@@ -103,6 +133,11 @@ bool Iterator::isSequentialAccess() const {
   return iterator->isSequentialAccess();
 }
 
+bool Iterator::isUnique() const {
+  taco_iassert(defined());
+  return iterator->isUnique();
+}
+
 ir::Expr Iterator::getTensor() const {
   taco_iassert(defined());
   return iterator->getTensor();
@@ -138,6 +173,17 @@ ir::Stmt Iterator::initDerivedVar() const {
   return iterator->initDerivedVars();
 }
 
+ir::Stmt Iterator::locate(ir::Expr idx) const {
+  taco_iassert(defined());
+  taco_iassert(isRandomAccess());
+  return iterator->locate(idx);
+}
+
+ir::Expr Iterator::hasCoordinate() const {
+  taco_iassert(defined());
+  return iterator->hasCoordinate();
+}
+
 ir::Stmt Iterator::storePtr() const {
   taco_iassert(defined());
   return iterator->storePtr();
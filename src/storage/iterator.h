@@ -30,7 +30,7 @@ public:
   static Iterator make(const lower::TensorPath& path,
                        std::string name, const ir::Expr& tensorVar,
                        size_t mode, ModeType modeType, size_t modeOrdering,
-                       Iterator parent, const Type& type);
+                       Iterator parent, const Type& type, bool unique=true);
 
   /// Get the parent of this iterator in its iterator list.
   const Iterator& getParent() const;
@@ -55,6 +55,10 @@ public:
   /// Returns true if the iterator supports sequential access
   bool isSequentialAccess() const;
 
+  /// Returns true if the iterator visits each coordinate at most once per
+  /// segment. Sparse levels followed by singleton levels may repeat them.
+  bool isUnique() const;
+
   /// Returns the tensor this iterator is iterating over.
   ir::Expr getTensor() const;
 
@@ -84,6 +88,15 @@ public:
   /// the iterator variable.
   ir::Stmt initDerivedVar() const;
 
+  /// Returns a statement that declares the ptr variable and sets it to the
+  /// position of coordinate `idx`. Only random access iterators can do this.
+  ir::Stmt locate(ir::Expr idx) const;
+
+  /// Returns an expression that is true iff the ptr variable's position holds
+  /// a stored coordinate, or an undefined expression if every position in the
+  /// iterator's range does.
+  ir::Expr hasCoordinate() const;
+
   /// Returns a statement that stores the ptr variable to the ptr index array.
   ir::Stmt storePtr() const;
 
@@ -125,6 +138,7 @@ public:
 
   virtual bool isRandomAccess() const                    = 0;
   virtual bool isSequentialAccess() const                = 0;
+  virtual bool isUnique() const                          = 0;
 
   virtual ir::Expr getPtrVar() const                     = 0;
   virtual ir::Expr getIdxVar() const                     = 0;
@@ -134,6 +148,8 @@ public:
   virtual ir::Expr end() const                           = 0;
 
   virtual ir::Stmt initDerivedVars() const               = 0;
+  virtual ir::Stmt locate(ir::Expr idx) const            = 0;
+  virtual ir::Expr hasCoordinate() const                 = 0;
 
   virtual ir::Stmt storeIdx(ir::Expr idx) const          = 0;
   virtual ir::Stmt storePtr() const                      = 0;
@@ -1,6 +1,10 @@
 #include "taco/storage/pack.h"
 
+#include <algorithm>
+#include <atomic>
+#include <bitset>
 #include <climits>
+#include <cstring>
 
 #include "taco/format.h"
 #include "taco/error.h"
@@ -10,6 +14,8 @@
 #include "taco/storage/array.h"
 #include "taco/storage/array_util.h"
 #include "taco/util/collections.h"
+#include "taco/util/parallel.h"
+#include "taco/storage/index_dispatch.h"
 
 using namespace std;
 
@@ -31,190 +37,521 @@ namespace storage {
   }                                                                      \
 }
 
+namespace {
+/// The runs of equal coordinates in a sorted range of one level's coordinates.
+struct Segments {
+  std::vector<size_t> coords;
+  std::vector<size_t> ends;
+};
+}
 
-/// Count unique entries (assumes the values are sorted)
-TypedIndexVector getUniqueEntries(TypedIndexVector v, int startIndex, int endIndex) {
-  TypedIndexVector uniqueEntries(v.getType());
-  TypedIndexVal prev;
-  TypedIndexVal curr;
-  if (endIndex - startIndex > 0){
-    prev = v[startIndex];
-    uniqueEntries.push_back(prev);
-    for (int j = startIndex + 1; j < endIndex; j++) {
-      curr = v[j];
-      taco_iassert(curr >= prev);
-      if (curr > prev) {
-        prev = curr;
-        uniqueEntries.push_back(curr);
-      }
+/// Find the runs of equal coordinates in crd[begin,end) (assumes the
+/// coordinates are sorted)
+template <typename C>
+static Segments getSegments(const char* data, size_t begin, size_t end) {
+  const C* crd = (const C*)data;
+  Segments segments;
+  for (size_t p = begin; p < end; p++) {
+    taco_iassert(p == begin || crd[p] >= crd[p-1]);
+    if (p + 1 == end || crd[p+1] != crd[p]) {
+      segments.coords.push_back((size_t)crd[p]);
+      segments.ends.push_back(p + 1);
     }
   }
-  return uniqueEntries;
+  return segments;
 }
 
-
-size_t findMaxFixedValue(const vector<int>& dimensions,
-                              const vector<TypedIndexVector>& coords,
-                              size_t order,
-                              const size_t fixedLevel,
-                              const size_t i, const size_t numCoords) {
-  if (i == order) {
-    return numCoords;
-  }
-  if (i == fixedLevel) {
-    auto indexValues = getUniqueEntries(coords[i], 0, coords[i].size());
-    return indexValues.size();
-  }
-  else {
-    // Find max occurrences for level i
-    size_t maxSize=0;
-    DataType coordType = coords[0].getType();
-    TypedIndexVector maxCoords(coordType);
-    TypedIndexVal coordCur;
-    coordCur = coords[i][0];
-    size_t sizeCur=1;
-    for (size_t j=1; j<numCoords; j++) {
-      if (coords[i][j] == coordCur) {
-        sizeCur++;
-      }
-      else {
-        if (sizeCur > maxSize) {
-          maxSize = sizeCur;
-          maxCoords.clear();
-          maxCoords.push_back(coordCur);
-        }
-        else if (sizeCur == maxSize) {
-          maxCoords.push_back(coordCur);
-        }
-        sizeCur=1;
-        coordCur = coords[i][j];
-      }
-    }
-    if (sizeCur > maxSize) {
-      maxSize = sizeCur;
-      maxCoords.clear();
-      maxCoords.push_back(coordCur);
-    }
-    else if (sizeCur == maxSize) {
-      maxCoords.push_back(coordCur);
-    }
-
-    size_t maxFixedValue=0;
-    size_t maxSegment;
-    vector<TypedIndexVector> newCoords(order);
-    for (size_t i = 0; i < order; i++) {
-      newCoords[i] = TypedIndexVector(coordType);
-    }
-    for (size_t l=0; l<maxCoords.size(); l++) {
-      // clean coords for next level
-      for (size_t k=0; k<order;k++) {
-        newCoords[k].clear();
-      }
-      for (size_t j=0; j<numCoords; j++) {
-        if (coords[i][j] == maxCoords[l]) {
-          for (size_t k=0; k<order;k++) {
-            newCoords[k].push_back(coords[k][j]);
-          }
-        }
-      }
-      maxSegment = findMaxFixedValue(dimensions, newCoords, order, fixedLevel,
-                                     i+1, maxSize);
-      maxFixedValue = std::max(maxFixedValue,maxSegment);
-    }
-    return maxFixedValue;
-  }
+static Segments getSegments(const TypedIndexVector& crd, size_t begin,
+                            size_t end) {
+  DISPATCH_INDEX_TYPE(crd.getType(), C,
+                      return getSegments<C>(crd.data(), begin, end));
+  return Segments();
 }
 
 /// Pack tensor coordinates into an index structure and value array.  The
 /// indices consist of one index per tensor mode, and each index contains
 /// [0,2] index arrays.
-int packTensor(const vector<int>& dimensions,
-                const vector<TypedIndexVector>& coords,
-                char* vals,
-                size_t begin, size_t end,
-                const vector<ModeType>& modeTypes, size_t i,
-                std::vector<std::vector<TypedIndexVector>>* indices,
-                char* values, DataType dataType, int valuesIndex) {
-  auto& modeType    = modeTypes[i];
-  auto& levelCoords = coords[i];
-  auto& index       = (*indices)[i];
+static int packTensor(const vector<int>& dimensions,
+                      const vector<TypedIndexVector>& coords,
+                      char* vals,
+                      size_t begin, size_t end,
+                      const vector<ModeType>& modeTypes, size_t i,
+                      std::vector<std::vector<std::vector<size_t>>>* indices,
+                      char* values, DataType dataType, int valuesIndex) {
+  auto& modeType = modeTypes[i];
+  auto& index    = (*indices)[i];
+  const Segments segments = getSegments(coords[i], begin, end);
+  const size_t numSegments = segments.coords.size();
   switch (modeType) {
     case Dense: {
       // Iterate over each index value and recursively pack it's segment
       size_t cbegin = begin;
+      size_t segment = 0;
       for (int j=0; j < (int)dimensions[i]; ++j) {
-        // Scan to find segment range of children
         size_t cend = cbegin;
-        while (cend < end && levelCoords[cend] == j) {
-          cend++;
+        if (segment < numSegments && segments.coords[segment] == (size_t)j) {
+          cend = segments.ends[segment];
+          segment++;
         }
         PACK_NEXT_LEVEL(cend);
         cbegin = cend;
       }
       break;
     }
+    case Bitmap: {
+      // Flag every index value like a dense level, but only recursively pack
+      // the index values that have a segment
+      size_t cbegin = begin;
+      size_t segment = 0;
+      for (int j=0; j < (int)dimensions[i]; ++j) {
+        size_t cend = cbegin;
+        if (segment < numSegments && segments.coords[segment] == (size_t)j) {
+          cend = segments.ends[segment];
+          segment++;
+        }
+        index[0].push_back(cend > cbegin);
+        if (cend > cbegin) {
+          PACK_NEXT_LEVEL(cend);
+        }
+        cbegin = cend;
+      }
+      break;
+    }
     case Sparse: {
-      auto indexValues = getUniqueEntries(levelCoords, begin, end);
-
       // Store segment end: the size of the stored segment is the number of
       // unique values in the coordinate list
-      index[0].push_back(index[1].size() + indexValues.size());
+      index[0].push_back(index[1].size() + numSegments);
 
       // Store unique index values for this segment
-      index[1].push_back_vector(indexValues);
+      index[1].insert(index[1].end(), segments.coords.begin(),
+                      segments.coords.end());
 
       // Iterate over each index value and recursively pack it's segment
       size_t cbegin = begin;
-      for (int j = 0; j < (int) indexValues.size(); j++) {
-        // Scan to find segment range of children
-        size_t cend = cbegin;
-        while (cend < end && levelCoords[cend] == indexValues[j]) {
-          cend++;
-        }
+      for (size_t segment = 0; segment < numSegments; segment++) {
+        size_t cend = segments.ends[segment];
         PACK_NEXT_LEVEL(cend);
         cbegin = cend;
       }
       break;
     }
     case Fixed: {
-      TypedIndexVal fixedValue = index[0][0];
-      auto indexValues = getUniqueEntries(levelCoords, begin, end);
+      const size_t fixedValue = index[0][0];
 
-      // Store segment end: the size of the stored segment is the number of
-      // unique values in the coordinate list
-      size_t segmentSize = indexValues.size();
       // Store unique index values for this segment
+      index[1].insert(index[1].end(), segments.coords.begin(),
+                      segments.coords.end());
       size_t cbegin = begin;
-      if (segmentSize > 0) {
-        index[1].push_back_vector(indexValues);
-        for (int j = 0; j < (int) indexValues.size(); j++) {
-          // Scan to find segment range of children
-          size_t cend = cbegin;
-          while (cend < end && levelCoords[cend] == indexValues[j]) {
-            cend++;
-          }
-          PACK_NEXT_LEVEL(cend);
-          cbegin = cend;
-        }
+      for (size_t segment = 0; segment < numSegments; segment++) {
+        size_t cend = segments.ends[segment];
+        PACK_NEXT_LEVEL(cend);
+        cbegin = cend;
       }
+
       // Complete index if necessary with the last index value
-      int curSize=segmentSize;
-      while (fixedValue > curSize) {
-        if (segmentSize > 0) {
-          index[1].push_back(indexValues[segmentSize - 1]);
-        }
-        else {
-          index[1].push_back(0);
-        }
+      for (size_t curSize = numSegments; curSize < fixedValue; curSize++) {
+        index[1].push_back(numSegments > 0 ? segments.coords.back() : 0);
         PACK_NEXT_LEVEL(cbegin);
-        curSize++;
       }
       break;
     }
+    case Singleton:
+    case Diagonal:
+      taco_ierror << modeType << " levels are packed by packLevels";
+      break;
+    case Hashed:
+      taco_ierror;
+      break;
   }
   return valuesIndex;
 }
-  
+
+/// Copies index values into an array of type T.
+template <typename T, typename V>
+static void copyIndexValues(const vector<V>& from, char* data) {
+  T* to = (T*)data;
+  util::parallelFor(from.size(), [&](size_t, size_t begin, size_t end) {
+    for (size_t k = begin; k < end; k++) {
+      to[k] = (T)from[k];
+    }
+  });
+}
+
+/// Returns an array of the given integer type holding the index values.
+template <typename V>
+static Array makeIndexArray(DataType type, const vector<V>& values) {
+  Array array = makeArray(type, values.size());
+  DISPATCH_INDEX_TYPE(type, T,
+                      copyIndexValues<T,V>(values, (char*)array.getData()));
+  return array;
+}
+
+/// Returns the index of a bitmap level with `numBits` bits, of which the bits
+/// in the sorted `setBits` are set. The bits are packed into uint64 words, and
+/// the rank array holds the number of set bits before every word followed by
+/// the number of set bits in all words.
+static ModeIndex makeBitmapIndex(int dimension, const vector<size_t>& setBits,
+                                 size_t numBits,
+                                 const vector<DataType>& arrayTypes) {
+  taco_uassert(arrayTypes[1] == UInt64) <<
+      "Bitmap levels pack their bits into uint64 words";
+
+  // The first set bit of every word sets all the bits of the word, so that
+  // every word is written by one thread
+  const size_t numWords = (numBits + 63) / 64;
+  vector<uint64_t> words(numWords, 0);
+  util::parallelFor(setBits.size(), [&](size_t, size_t begin, size_t end) {
+    for (size_t k = begin; k < end; k++) {
+      const size_t word = setBits[k] / 64;
+      if (k > 0 && setBits[k-1] / 64 == word) {
+        continue;
+      }
+      for (size_t l = k; l < setBits.size() && setBits[l] / 64 == word; l++) {
+        words[word] |= (uint64_t)1 << (setBits[l] % 64);
+      }
+    }
+  });
+
+  vector<size_t> rank(numWords + 1, 0);
+  util::parallelFor(numWords, [&](size_t, size_t begin, size_t end) {
+    for (size_t w = begin; w < end; w++) {
+      rank[w] = bitset<64>(words[w]).count();
+    }
+  });
+  util::parallelExclusiveScan(rank);
+
+  return ModeIndex({makeArray({dimension}),
+                    makeIndexArray(arrayTypes[1], words),
+                    makeIndexArray(arrayTypes[2], rank)});
+}
+
+/// Sets isNew[p] if coordinate p differs from coordinate p-1.
+template <typename C>
+static void markNewCoords(const char* data, vector<char>& isNew) {
+  const C* crd = (const C*)data;
+  util::parallelFor(isNew.size(), [&](size_t, size_t begin, size_t end) {
+    for (size_t p = max(begin, (size_t)1); p < end; p++) {
+      isNew[p] = isNew[p] || crd[p] != crd[p-1];
+    }
+  });
+}
+
+/// Find the size of a fixed level: the most unique coordinates of the level
+/// below any node of the previous levels. The coordinates are sorted, so the
+/// nodes and their coordinates are the runs found in one pass over them.
+static size_t findMaxFixedValue(const vector<TypedIndexVector>& coords,
+                                size_t fixedLevel, size_t numCoordinates) {
+  vector<char> isNewNode(numCoordinates, 0);
+  if (numCoordinates > 0) {
+    isNewNode[0] = 1;
+  }
+  for (size_t i = 0; i < fixedLevel; i++) {
+    DISPATCH_INDEX_TYPE(coords[i].getType(), C,
+                        markNewCoords<C>(coords[i].data(), isNewNode));
+  }
+  vector<char> isNewCoord = isNewNode;
+  DISPATCH_INDEX_TYPE(coords[fixedLevel].getType(), C,
+                      markNewCoords<C>(coords[fixedLevel].data(), isNewCoord));
+
+  size_t maxFixedValue = 0;
+  size_t size = 0;
+  for (size_t p = 0; p < numCoordinates; p++) {
+    size = isNewNode[p] ? 1 : size + isNewCoord[p];
+    maxFixedValue = max(maxFixedValue, size);
+  }
+  return maxFixedValue;
+}
+
+/// Computes the position of each coordinate's node in a dense level.
+template <typename C>
+static void getDenseNodes(const char* data, size_t dimension,
+                          const vector<size_t>& parents,
+                          vector<size_t>& nodes) {
+  const C* crd = (const C*)data;
+  util::parallelFor(nodes.size(), [&](size_t, size_t begin, size_t end) {
+    for (size_t p = begin; p < end; p++) {
+      nodes[p] = parents[p] * dimension + (size_t)crd[p];
+    }
+  });
+}
+
+/// Returns the sorted offsets of the diagonals that hold coordinates, given
+/// the coordinates of the dense level above, which are also its nodes.
+template <typename C>
+static vector<long long> getDiagonalOffsets(const char* data,
+                                            const vector<size_t>& parents) {
+  const C* crd = (const C*)data;
+  vector<long long> offsets(parents.size());
+  util::parallelFor(parents.size(), [&](size_t, size_t begin, size_t end) {
+    for (size_t p = begin; p < end; p++) {
+      offsets[p] = (long long)crd[p] - (long long)parents[p];
+    }
+  });
+  sort(offsets.begin(), offsets.end());
+  offsets.erase(unique(offsets.begin(), offsets.end()), offsets.end());
+  return offsets;
+}
+
+/// Computes the position of each coordinate's node in a diagonal level, where
+/// every parent has one node per diagonal.
+template <typename C>
+static void getDiagonalNodes(const char* data, const vector<long long>& offsets,
+                             const vector<size_t>& parents,
+                             vector<size_t>& nodes) {
+  const C* crd = (const C*)data;
+  util::parallelFor(nodes.size(), [&](size_t, size_t begin, size_t end) {
+    for (size_t p = begin; p < end; p++) {
+      long long offset = (long long)crd[p] - (long long)parents[p];
+      size_t diagonal = lower_bound(offsets.begin(), offsets.end(), offset) -
+                        offsets.begin();
+      nodes[p] = parents[p] * offsets.size() + diagonal;
+    }
+  });
+}
+
+/// Stores the coordinate of every new node of a sparse level in its idx array.
+template <typename I, typename C>
+static void scatterTypedIdx(char* idxData, const char* crdData,
+                            const vector<char>& isNew,
+                            const vector<size_t>& nodes) {
+  I* idx = (I*)idxData;
+  const C* crd = (const C*)crdData;
+  util::parallelFor(nodes.size(), [&](size_t, size_t begin, size_t end) {
+    for (size_t p = begin; p < end; p++) {
+      if (isNew[p]) {
+        idx[nodes[p]] = (I)crd[p];
+      }
+    }
+  });
+}
+
+template <typename C>
+static void scatterIdx(Array& idx, const char* crdData,
+                       const vector<char>& isNew, const vector<size_t>& nodes) {
+  DISPATCH_INDEX_TYPE(idx.getType(), I,
+                      scatterTypedIdx<I,C>((char*)idx.getData(), crdData,
+                                           isNew, nodes));
+}
+
+/// Pack sorted coordinates one level at a time instead of one segment at a
+/// time. Every level is built with data-parallel passes over the coordinates,
+/// which track the position of each coordinate's node in the level built so
+/// far. Supports all levels but fixed and hashed levels.
+static Storage packLevels(const std::vector<int>&              dimensions,
+                          const Format&                        format,
+                          const std::vector<TypedIndexVector>& coordinates,
+                          const void*                          values,
+                          const size_t                         numCoordinates,
+                          DataType                             datatype) {
+  const size_t order = dimensions.size();
+  const size_t n = numCoordinates;
+
+  // nodes[p] is the position of coordinate p's node in the current level, and
+  // isNew[p] is whether p's coordinates differ from those of p-1 in some level
+  vector<size_t> parents(n, 0);
+  vector<size_t> nodes(n, 0);
+  vector<char> isNew(n, 0);
+  if (n > 0) {
+    isNew[0] = 1;
+  }
+
+  size_t numNodes = 1;
+  vector<ModeIndex> modeIndices;
+  for (size_t i = 0; i < order; i++) {
+    const char* crd = coordinates[i].data();
+    const DataType crdType = coordinates[i].getType();
+    parents.swap(nodes);
+
+    DISPATCH_INDEX_TYPE(crdType, C, markNewCoords<C>(crd, isNew));
+
+    switch (format.getModeTypes()[i]) {
+      case Dense: {
+        const size_t dimension = dimensions[i];
+        DISPATCH_INDEX_TYPE(crdType, C,
+                            getDenseNodes<C>(crd, dimension, parents, nodes));
+        numNodes *= dimension;
+        modeIndices.push_back(ModeIndex({makeArray({dimensions[i]})}));
+        break;
+      }
+      case Bitmap: {
+        // Bits are numbered like the nodes of a dense level, while only the
+        // nodes of set bits are stored, numbered in coordinate order like in a
+        // sparse level
+        const size_t dimension = dimensions[i];
+        vector<size_t> bits(n);
+        DISPATCH_INDEX_TYPE(crdType, C,
+                            getDenseNodes<C>(crd, dimension, parents, bits));
+        const size_t numBits = numNodes * dimension;
+        util::parallelFor(n, [&](size_t, size_t begin, size_t end) {
+          for (size_t p = begin; p < end; p++) {
+            nodes[p] = isNew[p];
+          }
+        });
+        numNodes = util::parallelExclusiveScan(nodes);
+        vector<size_t> setBits(numNodes);
+        util::parallelFor(n, [&](size_t, size_t begin, size_t end) {
+          for (size_t p = begin; p < end; p++) {
+            nodes[p] = nodes[p] + isNew[p] - 1;
+            if (isNew[p]) {
+              setBits[nodes[p]] = bits[p];
+            }
+          }
+        });
+        modeIndices.push_back(makeBitmapIndex(dimensions[i], setBits, numBits,
+                                              format.getLevelArrayTypes()[i]));
+        break;
+      }
+      case Sparse: {
+        // The nodes of a level followed by singleton levels are told apart by
+        // the coordinates of the singleton levels too, so that a coordinate
+        // can repeat within a segment
+        for (size_t j = i + 1; j < order && !format.isUnique(j - 1); j++) {
+          DISPATCH_INDEX_TYPE(coordinates[j].getType(), C,
+                              markNewCoords<C>(coordinates[j].data(), isNew));
+        }
+
+        // Number the nodes of the level in coordinate order. Each coordinate
+        // belongs to the last new node at or before it.
+        util::parallelFor(n, [&](size_t, size_t begin, size_t end) {
+          for (size_t p = begin; p < end; p++) {
+            nodes[p] = isNew[p];
+          }
+        });
+        size_t numParents = numNodes;
+        numNodes = util::parallelExclusiveScan(nodes);
+        util::parallelFor(n, [&](size_t, size_t begin, size_t end) {
+          for (size_t p = begin; p < end; p++) {
+            nodes[p] = nodes[p] + isNew[p] - 1;
+          }
+        });
+
+        // Every new node records its idx, and the last coordinate of each
+        // parent records where its segment ends in the pos array.  Parents
+        // without children are filled in below.
+        Array idx = makeArray(format.getCoordinateTypeIdx(i), numNodes);
+        DISPATCH_INDEX_TYPE(crdType, C, scatterIdx<C>(idx, crd, isNew, nodes));
+        vector<size_t> segmentEnds(numParents + 1, 0);
+        util::parallelFor(n, [&](size_t, size_t begin, size_t end) {
+          for (size_t p = begin; p < end; p++) {
+            if (p + 1 == n || parents[p+1] != parents[p]) {
+              segmentEnds[parents[p] + 1] = nodes[p] + 1;
+            }
+          }
+        });
+
+        // Empty segments end where the previous segment ends
+        size_t numChunks = util::getNumChunks(numParents + 1);
+        vector<size_t> chunkEnds(numChunks, 0);
+        util::parallelFor(numParents + 1,
+                          [&](size_t chunk, size_t begin, size_t end) {
+          size_t segmentEnd = 0;
+          for (size_t k = begin; k < end; k++) {
+            segmentEnd = max(segmentEnd, segmentEnds[k]);
+          }
+          chunkEnds[chunk] = segmentEnd;
+        });
+        for (size_t chunk = 1; chunk < numChunks; chunk++) {
+          chunkEnds[chunk] = max(chunkEnds[chunk], chunkEnds[chunk-1]);
+        }
+        util::parallelFor(numParents + 1,
+                          [&](size_t chunk, size_t begin, size_t end) {
+          size_t segmentEnd = (chunk > 0) ? chunkEnds[chunk-1] : 0;
+          for (size_t k = begin; k < end; k++) {
+            segmentEnd = max(segmentEnd, segmentEnds[k]);
+            segmentEnds[k] = segmentEnd;
+          }
+        });
+        Array pos = makeIndexArray(format.getCoordinateTypePos(i), segmentEnds);
+
+        modeIndices.push_back(ModeIndex({pos, idx}));
+        break;
+      }
+      case Singleton: {
+        // Every node of the level above has exactly one child
+        nodes = parents;
+        Array idx = makeArray(format.getCoordinateTypeIdx(i), numNodes);
+        DISPATCH_INDEX_TYPE(crdType, C, scatterIdx<C>(idx, crd, isNew, nodes));
+        modeIndices.push_back(ModeIndex({idx}));
+        break;
+      }
+      case Diagonal: {
+        // Every row stores every diagonal, with zeros where the diagonal has
+        // no coordinate in the row
+        vector<long long> offsets;
+        DISPATCH_INDEX_TYPE(crdType, C,
+                            offsets = getDiagonalOffsets<C>(crd, parents));
+        DISPATCH_INDEX_TYPE(crdType, C,
+                            getDiagonalNodes<C>(crd, offsets, parents, nodes));
+        numNodes *= offsets.size();
+        Array pos = makeIndexArray(format.getCoordinateTypePos(i),
+                                   vector<size_t>({offsets.size()}));
+        Array idx = makeIndexArray(format.getCoordinateTypeIdx(i), offsets);
+        modeIndices.push_back(ModeIndex({pos, idx}));
+        break;
+      }
+      case Hashed:
+        taco_ierror;
+        break;
+      case Fixed:
+        taco_ierror << "Fixed levels are packed by packTensor";
+        break;
+    }
+  }
+
+  // Copy the values of the first of any duplicate coordinates to their nodes
+  const size_t valueSize = datatype.getNumBytes();
+  Array vals = makeArray(datatype, numNodes);
+  char* valsData = (char*)vals.getData();
+  memset(valsData, 0, numNodes * valueSize);
+  util::parallelFor(n, [&](size_t, size_t begin, size_t end) {
+    for (size_t p = begin; p < end; p++) {
+      if (isNew[p]) {
+        memcpy(&valsData[nodes[p] * valueSize],
+               &((const char*)values)[p * valueSize], valueSize);
+      }
+    }
+  });
+
+  Storage storage(format);
+  storage.setIndex(Index(format, modeIndices));
+  storage.setValues(vals);
+  return storage;
+}
+
+/// Returns true iff every coordinate lies below the dimension.
+template <typename C>
+static bool coordinatesInBounds(const char* data, size_t numCoordinates,
+                                size_t dimension) {
+  const C* crd = (const C*)data;
+  atomic<bool> inBounds(true);
+  util::parallelFor(numCoordinates, [&](size_t, size_t begin, size_t end) {
+    for (size_t p = begin; p < end; p++) {
+      if ((size_t)crd[p] >= dimension) {
+        inBounds = false;
+        return;
+      }
+    }
+  });
+  return inBounds;
+}
+
+/// Returns true iff every coordinate lies within the tensor dimensions.
+static bool coordinatesInBounds(const std::vector<int>& dimensions,
+                                const std::vector<TypedIndexVector>& coords,
+                                size_t numCoordinates) {
+  for (size_t i = 0; i < dimensions.size(); i++) {
+    bool inBounds = false;
+    DISPATCH_INDEX_TYPE(coords[i].getType(), C,
+                        inBounds = coordinatesInBounds<C>(coords[i].data(),
+                                                          numCoordinates,
+                                                          dimensions[i]));
+    if (!inBounds) {
+      return false;
+    }
+  }
+  return true;
+}
+
 /// Pack tensor coordinates into a format. The coordinates must be stored as a
 /// structure of arrays, that is one vector per axis coordinate and one vector
 /// for the values. The coordinates must be sorted lexicographically.
@@ -225,13 +562,27 @@ Storage pack(const std::vector<int>&              dimensions,
              const size_t numCoordinates,
              DataType datatype) {
   taco_iassert(dimensions.size() == format.getOrder());
+  taco_uassert(!util::contains(format.getModeTypes(), Hashed))
+      << "Hashed levels are built by kernels and cannot be packed";
+
+  if (!util::contains(format.getModeTypes(), Fixed) &&
+      coordinatesInBounds(dimensions, coordinates, numCoordinates)) {
+    return packLevels(dimensions, format, coordinates, values, numCoordinates,
+                      datatype);
+  }
+  taco_uassert(!util::contains(format.getModeTypes(), Singleton))
+      << "Singleton levels cannot be combined with fixed levels or packed "
+      << "from coordinates that are out of bounds";
+  taco_uassert(!util::contains(format.getModeTypes(), Diagonal))
+      << "Diagonal levels cannot be packed from coordinates that are out of "
+      << "bounds";
 
   Storage storage(format);
 
   size_t order = dimensions.size();
 
-  // Create vectors to store pointers to indices/index sizes
-  vector<vector<TypedIndexVector>> indices;
+  // Create vectors to store the index values of each level
+  vector<vector<vector<size_t>>> indices;
   indices.reserve(order);
 
   for (size_t i=0; i < order; ++i) {
@@ -240,26 +591,31 @@ Storage pack(const std::vector<int>&              dimensions,
         indices.push_back({});
         break;
       }
+      case Bitmap: {
+        // Bitmap indices have one array that flags every index value, which
+        // is packed into words below
+        indices.push_back({{}});
+        break;
+      }
       case Sparse: {
-        // Sparse indices have two arrays: a segment array and an index array
-        indices.push_back({TypedIndexVector(format.getCoordinateTypePos(i)), TypedIndexVector(format.getCoordinateTypeIdx(i))});
-
-        // Add start of first segment
-        indices[i][0].push_back(0);
+        // Sparse indices have two arrays: a segment array and an index array,
+        // which starts with the start of the first segment
+        indices.push_back({{0}, {}});
         break;
       }
       case Fixed: {
-        // Fixed indices have two arrays: a segment array and an index array
-        indices.push_back({TypedIndexVector(format.getCoordinateTypePos(i)), TypedIndexVector(format.getCoordinateTypeIdx(i))});
-
-        // Add maximum size to segment array
-        int maxSize = (int) findMaxFixedValue(dimensions, coordinates,
-                                           format.getOrder(), i, 0,
-                                           numCoordinates);
+        // Fixed indices have two arrays: a segment array and an index array,
+        // and the segment array holds the maximum size of the segments
+        size_t maxSize = findMaxFixedValue(coordinates, i, numCoordinates);
         taco_iassert(maxSize <= INT_MAX);
-        indices[i][0].push_back(maxSize);
+        indices.push_back({{maxSize}, {}});
         break;
       }
+      case Singleton:
+      case Hashed:
+      case Diagonal:
+        taco_ierror;
+        break;
     }
   }
 
@@ -283,16 +639,32 @@ Storage pack(const std::vector<int>&              dimensions,
         modeIndices.push_back(ModeIndex({size}));
         break;
       }
+      case ModeType::Bitmap: {
+        vector<size_t> setBits;
+        for (size_t k = 0; k < indices[i][0].size(); k++) {
+          if (indices[i][0][k]) {
+            setBits.push_back(k);
+          }
+        }
+        modeIndices.push_back(makeBitmapIndex(dimensions[i], setBits,
+                                              indices[i][0].size(),
+                                              format.getLevelArrayTypes()[i]));
+        break;
+      }
       case ModeType::Sparse:
       case ModeType::Fixed: {
-        Array pos = makeArray(format.getCoordinateTypePos(i), indices[i][0].size());
-        memcpy(pos.getData(), indices[i][0].data(), indices[i][0].size() * format.getCoordinateTypePos(i).getNumBytes());
-
-        Array idx = makeArray(format.getCoordinateTypeIdx(i), indices[i][1].size());
-        memcpy(idx.getData(), indices[i][1].data(), indices[i][1].size() * format.getCoordinateTypeIdx(i).getNumBytes());
+        Array pos = makeIndexArray(format.getCoordinateTypePos(i),
+                                   indices[i][0]);
+        Array idx = makeIndexArray(format.getCoordinateTypeIdx(i),
+                                   indices[i][1]);
         modeIndices.push_back(ModeIndex({pos, idx}));
         break;
       }
+      case ModeType::Singleton:
+      case ModeType::Hashed:
+      case ModeType::Diagonal:
+        taco_ierror;
+        break;
     }
   }
   storage.setIndex(Index(format, modeIndices));
@@ -334,7 +706,11 @@ ir::Stmt packCode(const Format& format) {
       case Sparse: {
         break;
       }
-      case Fixed: {
+      case Fixed:
+      case Singleton:
+      case Hashed:
+      case Bitmap:
+      case Diagonal: {
         taco_not_supported_yet;
         break;
       }
@@ -25,6 +25,10 @@ bool RootIterator::isSequentialAccess() const {
   return true;
 }
 
+bool RootIterator::isUnique() const {
+  return true;
+}
+
 Expr RootIterator::getPtrVar() const {
   return (long long) 0;
 }
@@ -53,6 +57,14 @@ ir::Stmt RootIterator::initDerivedVars() const {
   return Stmt();
 }
 
+ir::Stmt RootIterator::locate(ir::Expr idx) const {
+  return Stmt();
+}
+
+ir::Expr RootIterator::hasCoordinate() const {
+  return Expr();
+}
+
 ir::Stmt RootIterator::storePtr() const {
   return Stmt();
 }
@@ -0,0 +1,56 @@
+#ifndef TACO_STORAGE_SINGLETON_H
+#define TACO_STORAGE_SINGLETON_H
+
+#include <string>
+
+#include "iterator.h"
+#include "taco/ir/ir.h"
+
+namespace taco {
+namespace storage {
+
+/// Iterates over a singleton level, which stores exactly one coordinate per
+/// parent position in an idx array and no pos array.
+class SingletonIterator : public IteratorImpl {
+public:
+  SingletonIterator(std::string name, const ir::Expr& tensor, int level,
+                    Iterator previous);
+  virtual ~SingletonIterator() {};
+
+  bool isDense() const;
+  bool isFixedRange() const;
+
+  bool isRandomAccess() const;
+  bool isSequentialAccess() const;
+  bool isUnique() const;
+
+  ir::Expr getPtrVar() const;
+  ir::Expr getIdxVar() const;
+
+  ir::Expr getIteratorVar() const;
+  ir::Expr begin() const;
+  ir::Expr end() const;
+
+  ir::Stmt initDerivedVars() const;
+  ir::Stmt locate(ir::Expr idx) const;
+  ir::Expr hasCoordinate() const;
+
+  ir::Stmt storePtr() const;
+  ir::Stmt storeIdx(ir::Expr idx) const;
+
+  ir::Stmt initStorage(ir::Expr size) const;
+  ir::Stmt resizePtrStorage(ir::Expr size) const;
+  ir::Stmt resizeIdxStorage(ir::Expr size) const;
+
+private:
+  ir::Expr tensor;
+  int level;
+
+  ir::Expr ptrVar;
+  ir::Expr idxVar;
+
+  ir::Expr getIdxArr() const;
+};
+
+}}
+#endif
@@ -9,14 +9,21 @@ namespace taco {
 namespace storage {
 
 SparseIterator::SparseIterator(std::string name, const Expr& tensor, int level,
-                               Iterator previous)
+                               Iterator previous, bool unique)
     : IteratorImpl(previous, tensor) {
   this->tensor = tensor;
   this->level = level;
-
+  this->unique = unique;
+
+  // Positions have the type of the level's pos array, which may be wider than
+  // int for levels with more than 2^31 entries, but are never narrower than int
+  DataType ptrType = getPtrArr().type();
+  if (ptrType.getNumBits() < Int().getNumBits()) {
+    ptrType = Int();
+  }
   std::string idxVarName = name + util::toString(tensor);
   ptrVar = Var::make("p" + util::toString(tensor) + std::to_string(level + 1),
-                     Int());
+                     ptrType);
   idxVar = Var::make(idxVarName, Int());
 }
 
@@ -36,6 +43,10 @@ bool SparseIterator::isSequentialAccess() const {
   return true;
 }
 
+bool SparseIterator::isUnique() const {
+  return unique;
+}
+
 Expr SparseIterator::getPtrVar() const {
   return ptrVar;
 }
@@ -61,6 +72,14 @@ Stmt SparseIterator::initDerivedVars() const {
                          true);
 }
 
+ir::Stmt SparseIterator::locate(ir::Expr idx) const {
+  return Stmt();
+}
+
+ir::Expr SparseIterator::hasCoordinate() const {
+  return Expr();
+}
+
 ir::Stmt SparseIterator::storePtr() const {
   return Store::make(getPtrArr(),
                      Add::make(getParent().getPtrVar(), (long long) 1), getPtrVar());
@@ -12,7 +12,7 @@ namespace storage {
 class SparseIterator : public IteratorImpl {
 public:
   SparseIterator(std::string name, const ir::Expr& tensor, int level,
-                 Iterator previous);
+                 Iterator previous, bool unique=true);
   virtual ~SparseIterator() {};
 
   bool isDense() const;
@@ -20,6 +20,7 @@ public:
 
   bool isRandomAccess() const;
   bool isSequentialAccess() const;
+  bool isUnique() const;
 
   ir::Expr getPtrVar() const;
   ir::Expr getIdxVar() const;
@@ -29,6 +30,8 @@ public:
   ir::Expr end() const;
 
   ir::Stmt initDerivedVars() const;
+  ir::Stmt locate(ir::Expr idx) const;
+  ir::Expr hasCoordinate() const;
 
   ir::Stmt storePtr() const;
   ir::Stmt storeIdx(ir::Expr idx) const;
@@ -40,6 +43,7 @@ public:
 private:
   ir::Expr tensor;
   int level;
+  bool unique;
 
   ir::Expr ptrVar;
   ir::Expr idxVar;
@@ -1,6 +1,8 @@
 #include "taco/tensor.h"
 
 #include <set>
+#include <atomic>
+#include <algorithm>
 #include <cstring>
 #include <fstream>
 #include <sstream>
@@ -20,15 +22,19 @@
 #include "taco/lower/lower.h"
 #include "lower/iteration_graph.h"
 #include "codegen/module.h"
+#include "codegen/kernel_cache.h"
 #include "taco/taco_tensor_t.h"
 #include "taco/storage/file_io_tns.h"
 #include "taco/storage/file_io_mtx.h"
 #include "taco/storage/file_io_rb.h"
+#include "taco/storage/file_io_bin.h"
 #include "taco/util/strings.h"
+#include "taco/util/parallel.h"
 #include "taco/util/timers.h"
 #include "taco/util/name_generator.h"
 #include "taco/error/error_messages.h"
 #include "error/error_checks.h"
+#include "taco/storage/index_dispatch.h"
 #include "taco/storage/typed_vector.h"
 
 using namespace std;
@@ -55,6 +61,20 @@ struct TensorBase::Content {
   Stmt                  computeFunc;
   bool                  assembleWhileCompute;
   shared_ptr<Module>    module;
+
+  DuplicatePolicy       duplicatePolicy;
+  bool                  narrowIndexTypes;
+
+  /// Whether kernels were compiled against the index array types of the
+  /// tensor, which `pack` then keeps as long as the entries fit them.
+  bool                  indexTypesCompiled;
+
+  /// The kernel arguments, packed on the first assemble or compute call and
+  /// refreshed in place on later calls.
+  vector<TensorBase>    operands;
+  vector<void*>         arguments;
+
+  ~Content();
 };
 
 TensorBase::TensorBase() : TensorBase(Float()) {
@@ -72,6 +92,122 @@ TensorBase::TensorBase(DataType ctype, vector<int> dimensions, Format format)
     : TensorBase(util::uniqueName('A'), ctype, dimensions, format) {
 }
 
+/// Returns the default index array types of a format: int for every array.
+static vector<vector<DataType>> getDefaultIndexTypes(const Format& format) {
+  std::vector<std::vector<DataType>> levelArrayTypes;
+  for (size_t i = 0; i < format.getOrder(); ++i) {
+    std::vector<DataType> arrayTypes;
+    switch (format.getModeTypes()[i]) {
+      case ModeType::Dense:
+        arrayTypes.push_back(Int32);
+        break;
+      case ModeType::Sparse:
+        arrayTypes.push_back(Int32);
+        arrayTypes.push_back(Int32);
+        break;
+      case ModeType::Fixed:
+        arrayTypes.push_back(Int32);
+        arrayTypes.push_back(Int32);
+        break;
+      case ModeType::Singleton:
+        arrayTypes.push_back(Int32);
+        break;
+      case ModeType::Hashed:
+        arrayTypes.push_back(Int32);
+        arrayTypes.push_back(Int32);
+        arrayTypes.push_back(Int32);
+        break;
+      case ModeType::Bitmap:
+        arrayTypes.push_back(Int32);
+        arrayTypes.push_back(UInt64);
+        arrayTypes.push_back(Int32);
+        break;
+      case ModeType::Diagonal:
+        arrayTypes.push_back(Int32);
+        arrayTypes.push_back(Int32);
+        break;
+    }
+    levelArrayTypes.push_back(arrayTypes);
+  }
+  return levelArrayTypes;
+}
+
+/// Returns the narrowest signed integer type that holds values up to maxValue.
+static DataType getNarrowestIndexType(size_t maxValue) {
+  for (DataType type : {Int8, Int16, Int32}) {
+    if (maxValue < ((size_t)1 << (type.getNumBits() - 1))) {
+      return type;
+    }
+  }
+  return Int64;
+}
+
+/// Returns the narrowest index array types that fit any tensor with the given
+/// format and dimensions. Idx arrays hold coordinates of their mode and pos
+/// arrays hold up to the product of the dimensions of the levels so far.
+static vector<vector<DataType>> getBoundedIndexTypes(const Format& format,
+                                                     const vector<int>& dims) {
+  vector<vector<DataType>> levelArrayTypes;
+  size_t maxEntries = 1;
+  for (size_t i = 0; i < format.getOrder(); i++) {
+    size_t dimension = dims[format.getModeOrdering()[i]];
+    maxEntries = (dimension != 0 && maxEntries > SIZE_MAX / dimension)
+                 ? SIZE_MAX : maxEntries * dimension;
+    DataType idxType = getNarrowestIndexType(dimension > 0 ? dimension - 1 : 0);
+    switch (format.getModeTypes()[i]) {
+      case ModeType::Dense:
+        levelArrayTypes.push_back({Int32});
+        break;
+      case ModeType::Sparse:
+        levelArrayTypes.push_back({getNarrowestIndexType(maxEntries), idxType});
+        break;
+      case ModeType::Fixed:
+        levelArrayTypes.push_back({Int32, Int32});
+        break;
+      case ModeType::Singleton:
+        levelArrayTypes.push_back({idxType});
+        break;
+      case ModeType::Hashed:
+        // Empty slots hold -1 and the runtime sizes the segments, so hashed
+        // levels keep int arrays
+        levelArrayTypes.push_back({Int32, Int32, Int32});
+        break;
+      case ModeType::Bitmap:
+        // Bits are packed into uint64 words and ranks count stored entries
+        levelArrayTypes.push_back({Int32, UInt64,
+                                   getNarrowestIndexType(maxEntries)});
+        break;
+      case ModeType::Diagonal:
+        // Offsets are signed and range over twice the dimension
+        levelArrayTypes.push_back({Int32, Int32});
+        break;
+    }
+  }
+  return levelArrayTypes;
+}
+
+/// Copies an index array into a new array of the given integer type.
+template <typename T>
+static Array convertIndexArray(const Array& array) {
+  T* data = (T*)malloc(array.getSize() * sizeof(T));
+  for (size_t i = 0; i < array.getSize(); i++) {
+    data[i] = (T)array.get(i).getAsIndex();
+  }
+  return Array(type<T>(), data, array.getSize(), Array::Free);
+}
+
+static Array convertIndexArray(const Array& array, DataType type) {
+  switch (type.getKind()) {
+    case DataType::Int8:  return convertIndexArray<int8_t>(array);
+    case DataType::Int16: return convertIndexArray<int16_t>(array);
+    case DataType::Int32: return convertIndexArray<int32_t>(array);
+    case DataType::Int64: return convertIndexArray<int64_t>(array);
+    default:
+      taco_ierror << "Unexpected index type " << type;
+      return Array();
+  }
+}
+
 TensorBase::TensorBase(string name, DataType ctype, vector<int> dimensions,
                        Format format) : content(new Content) {
   taco_uassert(format.getOrder() == dimensions.size() ||
@@ -94,25 +230,7 @@ TensorBase::TensorBase(string name, DataType ctype, vector<int> dimensions,
 
   // Initialize coordinate types for Format if not already set
   if (format.getLevelArrayTypes().size() < format.getOrder()) {
-    std::vector<std::vector<DataType>> levelArrayTypes;
-    for (size_t i = 0; i < format.getOrder(); ++i) {
-      std::vector<DataType> arrayTypes;
-      switch (format.getModeTypes()[i]) {
-        case ModeType::Dense:
-          arrayTypes.push_back(Int32);
-          break;
-        case ModeType::Sparse:
-          arrayTypes.push_back(Int32);
-          arrayTypes.push_back(Int32);
-          break;
-        case ModeType::Fixed:
-          arrayTypes.push_back(Int32);
-          arrayTypes.push_back(Int32);
-          break;
-      }
-      levelArrayTypes.push_back(arrayTypes);
-    }
-    format.setLevelArrayTypes(levelArrayTypes);
+    format.setLevelArrayTypes(getDefaultIndexTypes(format));
   }
 
   content->name = name;
@@ -133,13 +251,14 @@ TensorBase::TensorBase(string name, DataType ctype, vector<int> dimensions,
   content->storage.setIndex(Index(format, modeIndices));
 
   content->assembleWhileCompute = false;
+  content->duplicatePolicy = DuplicatePolicy::First;
+  content->narrowIndexTypes = false;
+  content->indexTypesCompiled = false;
   content->module = make_shared<Module>();
 
   std::vector<Dimension> dims;
-  long long maxArraySize = 1;
   for (auto& dim : getDimensions()) {
     dims.push_back(dim);
-    maxArraySize *= dim;
   }
   
   content->tensorVar = TensorVar(getName(),
@@ -148,12 +267,6 @@ TensorBase::TensorBase(string name, DataType ctype, vector<int> dimensions,
 
   this->coordinateBuffer = shared_ptr<vector<char>>(new vector<char>);
   this->coordinateBufferUsed = 0;
-  /*
-  for (size_t i = Int8.getNumBits(); i <= Int128.getNumBits(); i *= 2) {
-    if (maxArraySize <= exp2(i-1) - 1) {
-      content->coordinateType = Int(i);
-    }
-  }*/
 
   this->coordinateSize = getOrder()*sizeof(int) + ctype.getNumBytes();
 }
@@ -190,6 +303,23 @@ void TensorBase::reserve(size_t numCoordinates) {
   this->coordinateBuffer->resize(newSize);
 }
 
+void TensorBase::insertCoordinates(vector<char>&& coordinates) {
+  taco_uassert(coordinates.size() % this->coordinateSize == 0)
+      << "Coordinate buffer size is not a multiple of the coordinate size";
+  if (this->coordinateBufferUsed == 0) {
+    this->coordinateBuffer->swap(coordinates);
+    this->coordinateBufferUsed = this->coordinateBuffer->size();
+    return;
+  }
+  size_t used = this->coordinateBufferUsed;
+  if (this->coordinateBuffer->size() < used + coordinates.size()) {
+    this->coordinateBuffer->resize(used + coordinates.size());
+  }
+  memcpy(this->coordinateBuffer->data() + used, coordinates.data(),
+         coordinates.size());
+  this->coordinateBufferUsed += coordinates.size();
+}
+
 const DataType& TensorBase::getComponentType() const {
   return content->ctype;
 }
@@ -206,6 +336,186 @@ storage::Storage& TensorBase::getStorage() {
   return content->storage;
 }
 
+size_t TensorBase::getNumStoredValues() const {
+  if (getStorage().getValues().getData() == nullptr) {
+    return 0;
+  }
+  return getStorage().getIndex().getSize();
+}
+
+/// Replace the nodes of a sparse level by their parents in the level above and
+/// record their coordinates. The nodes must be sorted.
+template <typename P, typename I>
+static void ascendSparse(const Array& posArray, const Array& idxArray,
+                         vector<size_t>& nodes, int* coordinates,
+                         size_t stride) {
+  if (nodes.empty()) {
+    return;
+  }
+  const P* pos = (const P*)posArray.getData();
+  const I* idx = (const I*)idxArray.getData();
+  const size_t numParents = posArray.getSize() - 1;
+  size_t parent = upper_bound(pos, pos + numParents + 1, nodes[0],
+                              [](size_t node, P end) {
+                                return node < (size_t)end;
+                              }) - pos - 1;
+  for (size_t k = 0; k < nodes.size(); k++) {
+    while ((size_t)pos[parent + 1] <= nodes[k]) {
+      parent++;
+    }
+    coordinates[k * stride] = (int)idx[nodes[k]];
+    nodes[k] = parent;
+  }
+}
+
+template <typename P>
+static void ascendSparse(const Array& pos, const Array& idx,
+                         vector<size_t>& nodes, int* coordinates,
+                         size_t stride) {
+  DISPATCH_INDEX_TYPE(idx.getType(), I,
+                      ascendSparse<P,I>(pos, idx, nodes, coordinates, stride));
+}
+
+/// Record the coordinates of the nodes of a singleton level, which are their
+/// own parents in the level above.
+template <typename I>
+static void ascendSingleton(const Array& idxArray, const vector<size_t>& nodes,
+                            int* coordinates, size_t stride) {
+  const I* idx = (const I*)idxArray.getData();
+  for (size_t k = 0; k < nodes.size(); k++) {
+    coordinates[k * stride] = (int)idx[nodes[k]];
+  }
+}
+
+/// Replace the nodes of a fixed level by their parents in the level above and
+/// record their coordinates.
+template <typename I>
+static void ascendFixed(size_t size, const Array& idxArray,
+                        vector<size_t>& nodes, int* coordinates,
+                        size_t stride) {
+  const I* idx = (const I*)idxArray.getData();
+  for (size_t k = 0; k < nodes.size(); k++) {
+    coordinates[k * stride] = (int)idx[nodes[k]];
+    nodes[k] /= size;
+  }
+}
+
+/// Replace the nodes of a diagonal level by their parents in the dense level
+/// above, which are also the coordinates of the parents, and record their
+/// coordinates clamped to the dimension.
+template <typename I>
+static void ascendDiagonal(size_t numDiagonals, const Array& offsetArray,
+                           int dimension, vector<size_t>& nodes,
+                           int* coordinates, size_t stride) {
+  const I* offsets = (const I*)offsetArray.getData();
+  for (size_t k = 0; k < nodes.size(); k++) {
+    const size_t parent = nodes[k] / numDiagonals;
+    long long coordinate = (long long)parent + offsets[nodes[k] % numDiagonals];
+    coordinates[k * stride] =
+        (int)max(0LL, min(coordinate, (long long)dimension - 1));
+    nodes[k] = parent;
+  }
+}
+
+/// Replace the nodes of a bitmap level by their parents in the level above and
+/// record their coordinates. Node k is the k-th set bit, which lies in the last
+/// word whose rank is at most k.
+template <typename R>
+static void ascendBitmap(size_t dimension, const Array& bitmapArray,
+                         const Array& rankArray, vector<size_t>& nodes,
+                         int* coordinates, size_t stride) {
+  const uint64_t* words = (const uint64_t*)bitmapArray.getData();
+  const R* rank = (const R*)rankArray.getData();
+  const R* rankEnd = rank + rankArray.getSize();
+  for (size_t k = 0; k < nodes.size(); k++) {
+    const size_t word = upper_bound(rank, rankEnd, (R)nodes[k]) - rank - 1;
+    uint64_t bits = words[word];
+    for (size_t skip = nodes[k] - rank[word]; skip > 0; skip--) {
+      bits &= bits - 1;
+    }
+    size_t bit = word * 64;
+    while (!(bits & 1)) {
+      bits >>= 1;
+      bit++;
+    }
+    coordinates[k * stride] = (int)(bit % dimension);
+    nodes[k] = bit / dimension;
+  }
+}
+
+void TensorBase::getCoordinates(size_t begin, size_t end,
+                                int* const* coordinates, size_t stride) const {
+  taco_iassert(begin <= end && end <= getNumStoredValues());
+  const Format& format = getFormat();
+  const Index& index = getStorage().getIndex();
+
+  // nodes[k] is the node of value begin+k in the level being walked, starting
+  // with the values themselves below the last level
+  vector<size_t> nodes(end - begin);
+  for (size_t k = 0; k < nodes.size(); k++) {
+    nodes[k] = begin + k;
+  }
+  for (size_t level = getOrder(); level-- > 0;) {
+    const ModeIndex& modeIndex = index.getModeIndex(level);
+    int* levelCoordinates = coordinates[format.getModeOrdering()[level]];
+    switch (format.getModeTypes()[level]) {
+      case ModeType::Dense: {
+        const size_t size = modeIndex.getIndexArray(0).get(0).getAsIndex();
+        for (size_t k = 0; k < nodes.size(); k++) {
+          levelCoordinates[k * stride] = (int)(nodes[k] % size);
+          nodes[k] /= size;
+        }
+        break;
+      }
+      case ModeType::Bitmap: {
+        const size_t size = modeIndex.getIndexArray(0).get(0).getAsIndex();
+        const Array& bitmap = modeIndex.getIndexArray(1);
+        const Array& rank = modeIndex.getIndexArray(2);
+        DISPATCH_INDEX_TYPE(rank.getType(), R,
+                            ascendBitmap<R>(size, bitmap, rank, nodes,
+                                            levelCoordinates, stride));
+        break;
+      }
+      case ModeType::Sparse: {
+        const Array& pos = modeIndex.getIndexArray(0);
+        const Array& idx = modeIndex.getIndexArray(1);
+        DISPATCH_INDEX_TYPE(pos.getType(), P,
+                            ascendSparse<P>(pos, idx, nodes, levelCoordinates,
+                                            stride));
+        break;
+      }
+      case ModeType::Fixed: {
+        const size_t size = modeIndex.getIndexArray(0).get(0).getAsIndex();
+        const Array& idx = modeIndex.getIndexArray(1);
+        DISPATCH_INDEX_TYPE(idx.getType(), I,
+                            ascendFixed<I>(size, idx, nodes, levelCoordinates,
+                                           stride));
+        break;
+      }
+      case ModeType::Singleton: {
+        const Array& idx = modeIndex.getIndexArray(0);
+        DISPATCH_INDEX_TYPE(idx.getType(), I,
+                            ascendSingleton<I>(idx, nodes, levelCoordinates,
+                                               stride));
+        break;
+      }
+      case ModeType::Diagonal: {
+        const size_t size = modeIndex.getIndexArray(0).get(0).getAsIndex();
+        const Array& offsets = modeIndex.getIndexArray(1);
+        const int dimension = getDimension(format.getModeOrdering()[level]);
+        DISPATCH_INDEX_TYPE(offsets.getType(), I,
+                            ascendDiagonal<I>(size, offsets, dimension, nodes,
+                                              levelCoordinates, stride));
+        break;
+      }
+      case ModeType::Hashed:
+        taco_uerror << "Tensors with a hashed mode must be computed before "
+                    << "their values can be read";
+        break;
+    }
+  }
+}
+
 void TensorBase::setAllocSize(size_t allocSize) {
   taco_uassert(allocSize >= 2 && (allocSize & (allocSize - 1)) == 0) <<
       "The index allocation size must be a power of two and at least two";
@@ -216,15 +526,262 @@ size_t TensorBase::getAllocSize() const {
   return content->allocSize;
 }
 
-static size_t numIntegersToCompare = 0;
-static int lexicographicalCmp(const void* a, const void* b) {
-  for (size_t i = 0; i < numIntegersToCompare; i++) {
-    int diff = ((int*)a)[i] - ((int*)b)[i];
-    if (diff != 0) {
-      return diff;
+void TensorBase::setDuplicatePolicy(DuplicatePolicy policy) {
+  content->duplicatePolicy = policy;
+}
+
+DuplicatePolicy TensorBase::getDuplicatePolicy() const {
+  return content->duplicatePolicy;
+}
+
+void TensorBase::setNarrowIndexTypes(bool narrow) {
+  content->narrowIndexTypes = narrow;
+  setLevelArrayTypes(narrow ? getBoundedIndexTypes(getFormat(), getDimensions())
+                            : getDefaultIndexTypes(getFormat()));
+}
+
+bool TensorBase::getNarrowIndexTypes() const {
+  return content->narrowIndexTypes;
+}
+
+/// Returns storage with the index and values of `storage` and a format that
+/// only differs from its format in the information about the index arrays.
+static Storage withFormat(const Storage& storage, const Format& format) {
+  const Index& index = storage.getIndex();
+  vector<ModeIndex> modeIndices;
+  for (size_t i = 0; i < index.numModeIndices(); i++) {
+    modeIndices.push_back(index.getModeIndex(i));
+  }
+  Storage result(format);
+  result.setIndex(Index(format, modeIndices));
+  result.setValues(storage.getValues());
+  return result;
+}
+
+void TensorBase::setLevelArrayTypes(const vector<vector<DataType>>& types) {
+  Format format = getFormat();
+  format.setLevelArrayTypes(types);
+
+  // Convert the index arrays that have already been packed to the new types
+  const Index& index = getStorage().getIndex();
+  vector<ModeIndex> modeIndices;
+  for (size_t i = 0; i < index.numModeIndices(); i++) {
+    ModeIndex modeIndex = index.getModeIndex(i);
+    vector<Array> arrays;
+    bool converted = false;
+    for (size_t j = 0; j < modeIndex.numIndexArrays(); j++) {
+      Array array = modeIndex.getIndexArray(j);
+      if (j < types[i].size() && array.getType() != types[i][j]) {
+        array = convertIndexArray(array, types[i][j]);
+        converted = true;
+      }
+      arrays.push_back(array);
     }
+    modeIndices.push_back(converted ? ModeIndex(arrays) : modeIndex);
   }
-  return 0;
+  Storage storage(format);
+  storage.setIndex(Index(format, modeIndices));
+  storage.setValues(getStorage().getValues());
+  content->storage = storage;
+  content->tensorVar.setFormat(format);
+}
+
+void TensorBase::setSchedule(const Schedule& schedule) {
+  content->tensorVar.setSchedule(schedule);
+}
+
+void TensorBase::setFixedSizes(const vector<size_t>& fixedSizes) {
+  Format format = getFormat();
+  format.setFixedSizes(fixedSizes);
+  content->storage = withFormat(content->storage, format);
+  content->tensorVar.setFormat(format);
+}
+
+/// Check that the pos and idx arrays of a sparse level describe numParents
+/// segments of increasing coordinates below dimension. Coordinates must be
+/// strictly increasing if the level is unique.
+template <typename P, typename I>
+static void validateSparseLevel(const P* pos, const I* idx,
+                                size_t numParents, long long dimension,
+                                bool unique, const string& name, size_t level) {
+  taco_uassert(pos[0] == 0) << "The pos array of level " << level
+      << " of tensor " << name << " does not start at zero";
+
+  atomic<bool> posSorted(true);
+  util::parallelFor(numParents, [&](size_t, size_t begin, size_t end) {
+    for (size_t k = begin; k < end; k++) {
+      if (pos[k] > pos[k+1]) {
+        posSorted = false;
+        return;
+      }
+    }
+  });
+  taco_uassert(posSorted) << "The pos array of level " << level
+      << " of tensor " << name << " is not sorted";
+
+  atomic<bool> idxSorted(true);
+  atomic<bool> idxInBounds(true);
+  util::parallelFor(numParents, [&](size_t, size_t begin, size_t end) {
+    for (size_t k = begin; k < end; k++) {
+      for (size_t p = pos[k]; p < (size_t)pos[k+1]; p++) {
+        long long coordinate = (long long)idx[p];
+        if (coordinate < 0 || coordinate >= dimension) {
+          idxInBounds = false;
+          return;
+        }
+        if (p > (size_t)pos[k] && (idx[p-1] > idx[p] ||
+                                   (unique && idx[p-1] == idx[p]))) {
+          idxSorted = false;
+          return;
+        }
+      }
+    }
+  }, (1<<10));
+  taco_uassert(idxInBounds) << "The idx array of level " << level
+      << " of tensor " << name << " has coordinates out of bounds";
+  taco_uassert(idxSorted) << "The idx array of level " << level
+      << " of tensor " << name << " is not sorted within each segment";
+}
+
+/// Check that the idx array of a singleton level holds size coordinates below
+/// dimension.
+template <typename I>
+static void validateSingletonLevel(const I* idx, size_t size,
+                                   long long dimension, const string& name,
+                                   size_t level) {
+  atomic<bool> idxInBounds(true);
+  util::parallelFor(size, [&](size_t, size_t begin, size_t end) {
+    for (size_t p = begin; p < end; p++) {
+      long long coordinate = (long long)idx[p];
+      if (coordinate < 0 || coordinate >= dimension) {
+        idxInBounds = false;
+        return;
+      }
+    }
+  });
+  taco_uassert(idxInBounds) << "The idx array of level " << level
+      << " of tensor " << name << " has coordinates out of bounds";
+}
+
+void TensorBase::adoptArrays(const vector<vector<Array>>& indices,
+                             void* values, bool validate) {
+  const Format& format = getFormat();
+  taco_uassert(indices.size() == getOrder()) << "Expected index arrays for "
+      << getOrder() << " levels but got " << indices.size();
+  auto checkArray = [&](const Array& array, size_t level, size_t i,
+                        size_t minSize) {
+    DataType type = format.getLevelArrayTypes()[level][i];
+    taco_uassert(array.getType() == type) << error::type_mismatch << ": "
+        << "index array " << i << " of level " << level << " of tensor "
+        << getName() << " has type " << array.getType() << " but the format "
+        << "expects " << type;
+    taco_uassert(array.getSize() >= minSize) << "Index array " << i
+        << " of level " << level << " of tensor " << getName() << " holds "
+        << array.getSize() << " entries but needs " << minSize;
+  };
+
+  vector<ModeIndex> modeIndices;
+  size_t numNodes = 1;
+  for (size_t i = 0; i < getOrder(); i++) {
+    int dimension = getDimension(format.getModeOrdering()[i]);
+    switch (format.getModeTypes()[i]) {
+      case ModeType::Dense: {
+        taco_uassert(indices[i].empty()) << "Dense level " << i
+            << " of tensor " << getName() << " takes no index arrays";
+        modeIndices.push_back(ModeIndex({makeArray({dimension})}));
+        numNodes *= dimension;
+        break;
+      }
+      case ModeType::Sparse: {
+        taco_uassert(indices[i].size() == 2) << "Sparse level " << i
+            << " of tensor " << getName() << " takes a pos and an idx array";
+        const Array& pos = indices[i][0];
+        const Array& idx = indices[i][1];
+        checkArray(pos, i, 0, numNodes + 1);
+        size_t size = pos.get(numNodes).getAsIndex();
+        checkArray(idx, i, 1, size);
+        if (validate) {
+          DISPATCH_INDEX_TYPE(pos.getType(), P,
+            DISPATCH_INDEX_TYPE(idx.getType(), I,
+              validateSparseLevel((const P*)pos.getData(),
+                                  (const I*)idx.getData(), numNodes,
+                                  dimension, format.isUnique(i), getName(),
+                                  i)));
+        }
+        modeIndices.push_back(ModeIndex({pos, idx}));
+        numNodes = size;
+        break;
+      }
+      case ModeType::Singleton: {
+        taco_uassert(indices[i].size() == 1) << "Singleton level " << i
+            << " of tensor " << getName() << " takes an idx array";
+        const Array& idx = indices[i][0];
+        checkArray(idx, i, 0, numNodes);
+        if (validate) {
+          DISPATCH_INDEX_TYPE(idx.getType(), I,
+            validateSingletonLevel((const I*)idx.getData(), numNodes,
+                                   dimension, getName(), i));
+        }
+        modeIndices.push_back(ModeIndex({idx}));
+        break;
+      }
+      case ModeType::Hashed:
+        taco_uerror << "Hashed levels are built by kernels and cannot be "
+                    << "adopted";
+        break;
+      case ModeType::Bitmap:
+        taco_uerror << "Bitmap levels cannot be adopted";
+        break;
+      case ModeType::Fixed:
+      case ModeType::Diagonal:
+        taco_not_supported_yet;
+        break;
+    }
+  }
+
+  // Adopted storage replaces any coordinates inserted but not yet packed
+  this->coordinateBuffer->clear();
+  this->coordinateBufferUsed = 0;
+
+  content->storage.setIndex(Index(format, modeIndices));
+  content->storage.setValues(Array(getComponentType(), values, numNodes,
+                                   Array::UserOwns));
+  content->valuesSize = numNodes;
+}
+
+void TensorBase::adopt(const vector<vector<int*>>& indices, void* values,
+                       bool validate) {
+  taco_uassert(indices.size() == getOrder()) << "Expected index arrays for "
+      << getOrder() << " levels but got " << indices.size();
+
+  // Wrap the arrays, whose sizes follow from the dimensions and pos arrays
+  const Format& format = getFormat();
+  vector<vector<Array>> arrays(getOrder());
+  size_t numNodes = 1;
+  for (size_t i = 0; i < getOrder(); i++) {
+    vector<size_t> sizes(indices[i].size(), 0);
+    switch (format.getModeTypes()[i]) {
+      case ModeType::Dense:
+        numNodes *= getDimension(format.getModeOrdering()[i]);
+        break;
+      case ModeType::Sparse:
+        if (indices[i].size() == 2) {
+          sizes = {numNodes + 1, (size_t)indices[i][0][numNodes]};
+          numNodes = sizes[1];
+        }
+        break;
+      case ModeType::Singleton:
+        std::fill(sizes.begin(), sizes.end(), numNodes);
+        break;
+      default:
+        break;
+    }
+    for (size_t j = 0; j < indices[i].size(); j++) {
+      arrays[i].push_back(Array(type<int>(), indices[i][j], sizes[j],
+                                Array::UserOwns));
+    }
+  }
+  adoptArrays(arrays, values, validate);
 }
 
 /// Pack coordinates into a data structure given by the tensor format.
@@ -258,85 +815,230 @@ void TensorBase::pack() {
   taco_iassert((this->coordinateBufferUsed % this->coordinateSize) == 0);
   size_t numCoordinates = this->coordinateBufferUsed / this->coordinateSize;
   const size_t coordSize = this->coordinateSize;
-  char* coordinatesPtr = coordinateBuffer->data();
-  vector<int> permuteBuffer(order);
-  for (size_t i=0; i < numCoordinates; ++i) {
-    int* coordinate = (int*)coordinatesPtr;
-    for (size_t j = 0; j < order; j++) {
-      permuteBuffer[j] = coordinate[permutation[j]];
+  const char* coordinatesPtr = coordinateBuffer->data();
+  auto getCoordinate = [&](size_t i) {
+    return (const int*)&coordinatesPtr[i * coordSize];
+  };
+
+  // The pack code expects the coordinates to be sorted. Radix sort them by
+  // their linearized position in the permuted tensor, unless it does not fit
+  // in 64 bits or some coordinate is out of bounds, in which case we fall back
+  // to a comparison sort.
+  vector<size_t> sorted(numCoordinates);
+  util::parallelFor(numCoordinates, [&](size_t, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      sorted[i] = i;
     }
-    for (size_t j = 0; j < order; j++) {
-      coordinate[j] = permuteBuffer[j];
+  });
+
+  bool linearizable = true;
+  vector<uint64_t> strides(order);
+  uint64_t size = 1;
+  for (int i = (int)order - 1; i >= 0; --i) {
+    strides[i] = size;
+    uint64_t dimension = max(permutedDimensions[i], 1);
+    if (size > UINT64_MAX / dimension) {
+      linearizable = false;
+      break;
     }
-    coordinatesPtr += this->coordinateSize;
+    size *= dimension;
   }
-  coordinatesPtr = coordinateBuffer->data();  
-  
-  // The pack code expects the coordinates to be sorted
-  numIntegersToCompare = order;
-  qsort(coordinatesPtr, numCoordinates, coordSize, lexicographicalCmp);
-  
+  if (linearizable) {
+    int numKeyBits = 0;
+    while (numKeyBits < 64 && ((size - 1) >> numKeyBits) != 0) {
+      numKeyBits++;
+    }
 
-  // Move coords into separate arrays and remove duplicates
-  std::vector<TypedIndexVector> coordinates(order);
-  for (size_t i=0; i < order; ++i) {
-    coordinates[i] = TypedIndexVector(getFormat().getCoordinateTypeIdx(i), numCoordinates);
-  }
-  char* values = (char*) malloc(numCoordinates * getComponentType().getNumBytes());
-  // Copy first coordinate-value pair
-  int* lastCoord = (int*)malloc(order * sizeof(int));
-  int j = 1;
-  if (numCoordinates >= 1) {
-    int* coordComponent = (int*)coordinatesPtr;
-    for (size_t d=0; d < order; ++d) {
-      coordinates[d].set(0, *coordComponent);
-      lastCoord[d] = *coordComponent;
-      coordComponent++;
+    vector<uint64_t> keys(numCoordinates);
+    atomic<bool> inBounds(true);
+    util::parallelFor(numCoordinates, [&](size_t, size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++) {
+        const int* coordinate = getCoordinate(i);
+        uint64_t key = 0;
+        for (size_t j = 0; j < order; j++) {
+          int c = coordinate[permutation[j]];
+          if (c < 0 || c >= permutedDimensions[j]) {
+            inBounds = false;
+          }
+          key += (uint64_t)c * strides[j];
+        }
+        keys[i] = key;
+      }
+    });
+    linearizable = inBounds;
+    if (linearizable) {
+      util::parallelRadixSort(keys, sorted, numKeyBits);
     }
-    memcpy(values, coordComponent, getComponentType().getNumBytes());
   }
-  else {
-    j = 0;
-  }
-  // Copy remaining coordinate-value pairs, removing duplicates
-  int* coord = (int*)malloc(order * sizeof(int));
-  void *value = malloc(getComponentType().getNumBytes());
-  for (size_t i=1; i < numCoordinates; ++i) {
-    int* coordLoc = (int*)&coordinatesPtr[i*coordSize];
-    for (size_t d=0; d < order; ++d) {
-      coord[d] = *coordLoc;
-      coordLoc++;
-    }
-    memcpy(value, coordLoc, getComponentType().getNumBytes());
-    if (coord != lastCoord) {
-      for (size_t d = 0; d < order; d++) {
-        coordinates[d].set(j, coord[d]);
+  if (!linearizable) {
+    stable_sort(sorted.begin(), sorted.end(), [&](size_t a, size_t b) {
+      const int* coordA = getCoordinate(a);
+      const int* coordB = getCoordinate(b);
+      for (size_t j = 0; j < order; j++) {
+        if (coordA[permutation[j]] != coordB[permutation[j]]) {
+          return coordA[permutation[j]] < coordB[permutation[j]];
+        }
       }
-      memcpy(&values[j * getComponentType().getNumBytes()], value, getComponentType().getNumBytes());
-      j++;
+      return false;
+    });
+  }
+
+  // Move coords into separate arrays and merge duplicates, which the stable
+  // sort leaves next to each other in insertion order
+  auto isDuplicate = [&](size_t i) {
+    return i > 0 && memcmp(getCoordinate(sorted[i]), getCoordinate(sorted[i-1]),
+                           order * sizeof(int)) == 0;
+  };
+  vector<size_t> positions(numCoordinates);
+  util::parallelFor(numCoordinates, [&](size_t, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      positions[i] = isDuplicate(i) ? 0 : 1;
     }
-    else {
-      taco_uwarning << "Duplicate coordinate ignored when inserting into tensor";
+  });
+  size_t numUnique = util::parallelExclusiveScan(positions);
+
+  const DuplicatePolicy policy = getDuplicatePolicy();
+  const DataType ctype = getComponentType();
+  if (numUnique < numCoordinates) {
+    switch (policy) {
+      case DuplicatePolicy::First:
+        taco_uwarning << "Duplicate coordinate ignored when inserting into "
+                      << "tensor";
+        break;
+      case DuplicatePolicy::Error: {
+        size_t i = 1;
+        while (!isDuplicate(i)) {
+          i++;
+        }
+        const int* coordinate = getCoordinate(sorted[i]);
+        taco_uerror << "Duplicate coordinate ("
+                    << util::join(vector<int>(coordinate, coordinate + order))
+                    << ") inserted into tensor " << getName();
+        break;
+      }
+      case DuplicatePolicy::Max:
+      case DuplicatePolicy::Min:
+        taco_uassert(!ctype.isComplex()) <<
+            "Complex duplicates cannot be combined by their maximum or minimum";
+        break;
+      case DuplicatePolicy::Last:
+      case DuplicatePolicy::Sum:
+        break;
     }
   }
-  free(value);
-  free(coord);
-  free(lastCoord);
-  if (numCoordinates > 0) {
-    for (size_t i=0; i < order; ++i) {
-      coordinates[i].resize(j);
-    }
-    values = (char *) realloc(values, (j) * getComponentType().getNumBytes());
+
+  std::vector<TypedIndexVector> coordinates(order);
+  for (size_t i=0; i < order; ++i) {
+    coordinates[i] = TypedIndexVector(getFormat().getCoordinateTypeIdx(i),
+                                      numUnique);
   }
+  const size_t valueSize = ctype.getNumBytes();
+  char* values = (char*) malloc(numUnique * valueSize);
+  util::parallelFor(numCoordinates, [&](size_t, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      if (isDuplicate(i)) {
+        continue;
+      }
+      size_t j = positions[i];
+      const int* coordinate = getCoordinate(sorted[i]);
+      for (size_t d = 0; d < order; d++) {
+        coordinates[d].set(j, coordinate[permutation[d]]);
+      }
+
+      // The first entry of a run of duplicates combines the whole run
+      char* value = &values[j * valueSize];
+      memcpy(value, &coordinate[order], valueSize);
+      for (size_t k = i + 1; k < numCoordinates && isDuplicate(k); k++) {
+        const int* duplicate = getCoordinate(sorted[k]);
+        TypedComponentVal a(ctype, value);
+        TypedComponentVal b(ctype, &duplicate[order]);
+        TypedComponentPtr result(ctype, value);
+        switch (policy) {
+          case DuplicatePolicy::First:
+          case DuplicatePolicy::Error:
+            break;
+          case DuplicatePolicy::Last:
+            *result = b;
+            break;
+          case DuplicatePolicy::Sum:
+            *result = a + b;
+            break;
+          case DuplicatePolicy::Max:
+            if (b > a) {
+              *result = b;
+            }
+            break;
+          case DuplicatePolicy::Min:
+            if (b < a) {
+              *result = b;
+            }
+            break;
+        }
+      }
+    }
+  });
   taco_iassert(coordinates.size() > 0);
   this->coordinateBuffer->clear();
   this->coordinateBufferUsed = 0;
 
-  // Pack indices and values
-  content->storage = storage::pack(permutedDimensions, getFormat(),
-                                   coordinates, (void *) values, j, getComponentType());
+  // Pack indices and values. Tensors with narrow index types are packed with
+  // types that fit any number of entries, and narrowed below.
+  Format packFormat = getFormat();
+  if (content->narrowIndexTypes) {
+    packFormat.setLevelArrayTypes(getBoundedIndexTypes(getFormat(),
+                                                       getDimensions()));
+  }
+  vector<vector<DataType>> compiledTypes = getFormat().getLevelArrayTypes();
+  content->storage = storage::pack(permutedDimensions, packFormat,
+                                   coordinates, (void *) values, numUnique,
+                                   getComponentType());
 
   free(values);
+
+  // Kernels that read the tensor are specialized to the sizes of the segments
+  // of its fixed and diagonal levels
+  if (util::contains(getFormat().getModeTypes(), ModeType::Fixed) ||
+      util::contains(getFormat().getModeTypes(), ModeType::Diagonal)) {
+    vector<size_t> fixedSizes(order, 0);
+    for (size_t i = 0; i < order; i++) {
+      if (getFormat().getModeTypes()[i] == ModeType::Fixed ||
+          getFormat().getModeTypes()[i] == ModeType::Diagonal) {
+        const ModeIndex& modeIndex = getStorage().getIndex().getModeIndex(i);
+        fixedSizes[i] = modeIndex.getIndexArray(0).get(0).getAsIndex();
+      }
+    }
+    setFixedSizes(fixedSizes);
+  }
+
+  // Narrow the pos and rank arrays to the number of entries they index. Once
+  // kernels have been compiled against the tensor, keep the types they were
+  // compiled for unless the entries no longer fit them, in which case the
+  // kernels must be recompiled.
+  if (content->narrowIndexTypes) {
+    vector<vector<DataType>> types = packFormat.getLevelArrayTypes();
+    for (size_t i = 0; i < order; i++) {
+      size_t j;
+      switch (getFormat().getModeTypes()[i]) {
+        case ModeType::Sparse:
+          j = 0;
+          break;
+        case ModeType::Bitmap:
+          j = 2;
+          break;
+        default:
+          continue;
+      }
+      Array pos = getStorage().getIndex().getModeIndex(i).getIndexArray(j);
+      size_t numEntries = pos.get(pos.getSize() - 1).getAsIndex();
+      DataType posType = getNarrowestIndexType(numEntries);
+      if (content->indexTypesCompiled &&
+          posType.getNumBits() <= compiledTypes[i][j].getNumBits()) {
+        posType = compiledTypes[i][j];
+      }
+      types[i][j] = posType;
+    }
+    setLevelArrayTypes(types);
+  }
 }
 
 void TensorBase::zero() {
@@ -368,7 +1070,60 @@ Access TensorBase::operator()(const std::vector<IndexVar>& indices) {
   return Access(new AccessTensorNode(*this, indices));
 }
 
+static inline vector<TensorBase> getTensors(const IndexExpr& expr) {
+  struct GetOperands : public IndexNotationVisitor {
+    using IndexNotationVisitor::visit;
+    set<TensorBase> inserted;
+    vector<TensorBase> operands;
+    void visit(const AccessNode* node) {
+      taco_iassert(isa<AccessTensorNode>(node)) << "Unknown subexpression";
+      TensorBase tensor = to<AccessTensorNode>(node)->tensor;
+      if (!util::contains(inserted, tensor)) {
+        inserted.insert(tensor);
+        operands.push_back(tensor);
+      }
+    }
+  };
+  GetOperands getOperands;
+  expr.accept(&getOperands);
+  return getOperands.operands;
+}
+
+/// Returns a copy of `schedule` that orders the loops as `loopOrder`.
+static Schedule withLoopOrder(const Schedule& schedule,
+                              const vector<IndexVar>& loopOrder) {
+  Schedule ordered;
+  for (auto& split : schedule.getSplits()) {
+    ordered.split(split.getVar(), split.getOuter(), split.getInner(),
+                  split.getFactor());
+  }
+  ordered.reorder(loopOrder);
+  for (auto& unroll : schedule.getUnrollFactors()) {
+    ordered.unroll(unroll.first, unroll.second);
+  }
+  for (auto& parallel : schedule.getParallelLoops()) {
+    ordered.parallelize(parallel.first, parallel.second);
+  }
+  return ordered;
+}
+
+void TensorBase::markIndexTypesCompiled() {
+  content->indexTypesCompiled = true;
+  for (auto& operand : getTensors(getTensorVar().getAssignment().getRhs())) {
+    operand.content->indexTypesCompiled = true;
+  }
+}
+
 void TensorBase::compile(bool assembleWhileCompute) {
+  compile(assembleWhileCompute, false);
+}
+
+shared_future<void> TensorBase::compileAsync(bool assembleWhileCompute) {
+  return compile(assembleWhileCompute, true);
+}
+
+shared_future<void> TensorBase::compile(bool assembleWhileCompute,
+                                        bool async) {
   TensorVar tensorVar = getTensorVar();
 
   taco_uassert(tensorVar.getAssignment().defined())
@@ -382,21 +1137,133 @@ void TensorBase::compile(bool assembleWhileCompute) {
   }
 
   content->assembleWhileCompute = assembleWhileCompute;
-  content->assembleFunc = lower::lower(tensorVar, "assemble",
+  unbindArguments();
+
+  // Let the cost model order the loops, using the level sizes of the operands
+  // that have been packed. The chosen order is only used for this compilation,
+  // since the schedule may be shared with other tensors.
+  Schedule schedule = tensorVar.getSchedule();
+  if (schedule.getAutoReorder() && schedule.getLoopOrder().empty()) {
+    map<TensorVar,vector<size_t>> levelSizes;
+    for (auto& operand : getTensors(tensorVar.getAssignment().getRhs())) {
+      const Index& index = operand.getStorage().getIndex();
+      bool packed = true;
+      for (size_t i = 0; i < index.numModeIndices(); i++) {
+        packed &= index.getModeIndex(i).numIndexArrays() > 0;
+      }
+      if (packed) {
+        levelSizes.insert({operand.getTensorVar(), index.getLevelSizes()});
+      }
+    }
+    vector<IndexVar> loopOrder =
+        lower::IterationGraph::selectLoopOrder(tensorVar, levelSizes);
+    if (loopOrder.size() > 0) {
+      tensorVar.setSchedule(withLoopOrder(schedule, loopOrder));
+    }
+  }
+
+  // Reuse the kernels of a previously compiled identical expression
+  KernelCache& kernelCache = KernelCache::getInstance();
+  string key = getKernelKey(tensorVar, assembleWhileCompute, getAllocSize());
+  Kernel kernel;
+  if (!kernelCache.get(key, &kernel)) {
+    kernel.assembleFunc = lower::lower(tensorVar, "assemble",
                                        assembleProperties, getAllocSize());
-  content->computeFunc  = lower::lower(tensorVar, "compute",
+    kernel.computeFunc  = lower::lower(tensorVar, "compute",
                                        computeProperties, getAllocSize());
-  content->module->addFunction(content->assembleFunc);
-  content->module->addFunction(content->computeFunc);
-  content->module->compile();
+    kernel.module = make_shared<Module>();
+    kernel.module->addFunction(kernel.assembleFunc);
+    kernel.module->addFunction(kernel.computeFunc);
+    if (async) {
+      kernel.module->compileAsync();
+    }
+    else {
+      kernel.module->compile();
+    }
+    kernel = kernelCache.insert(key, kernel);
+  }
+  content->assembleFunc = kernel.assembleFunc;
+  content->computeFunc  = kernel.computeFunc;
+  content->module       = kernel.module;
+  tensorVar.setSchedule(schedule);
+  markIndexTypesCompiled();
+  return content->module->getCompilation();
+}
+
+void compile(vector<TensorBase> tensors, bool assembleWhileCompute) {
+  vector<shared_future<void>> compilations;
+  for (auto& tensor : tensors) {
+    compilations.push_back(tensor.compileAsync(assembleWhileCompute));
+  }
+  for (auto& compilation : compilations) {
+    compilation.wait();
+  }
+}
+
+/// Point a packed tensor's index arrays and values at the tensor's current
+/// storage.
+static void updateTensorData(taco_tensor_t* tensorData,
+                             const TensorBase& tensor) {
+  Storage storage = tensor.getStorage();
+  Format format = storage.getFormat();
+
+  auto index = storage.getIndex();
+  for (size_t i = 0; i < tensor.getOrder(); i++) {
+    auto modeIndex = index.getModeIndex(i);
+    switch (format.getModeTypes()[i]) {
+      case ModeType::Dense: {
+        const Array& size = modeIndex.getIndexArray(0);
+        tensorData->indices[i][0] = (uint8_t*)size.getData();
+        break;
+      }
+      case ModeType::Hashed: {
+        // The runtime allocates the hashed level before running kernels
+        for (size_t j = 0; j < 3; j++) {
+          tensorData->indices[i][j] = (modeIndex.numIndexArrays() == 0)
+              ? nullptr : (uint8_t*)modeIndex.getIndexArray(j).getData();
+        }
+        break;
+      }
+      case ModeType::Sparse:
+      case ModeType::Fixed:
+      case ModeType::Diagonal: {
+        // When packing results for assemblies they won't have sparse indices
+        if (modeIndex.numIndexArrays() == 0) {
+          tensorData->indices[i][0] = nullptr;
+          tensorData->indices[i][1] = nullptr;
+          continue;
+        }
+
+        const Array& pos = modeIndex.getIndexArray(0);
+        const Array& idx = modeIndex.getIndexArray(1);
+        tensorData->indices[i][0] = (uint8_t*)pos.getData();
+        tensorData->indices[i][1] = (uint8_t*)idx.getData();
+      }
+        break;
+      case ModeType::Singleton: {
+        const Array& idx = modeIndex.getIndexArray(0);
+        tensorData->indices[i][0] = (uint8_t*)idx.getData();
+        break;
+      }
+      case ModeType::Bitmap: {
+        const Array& size = modeIndex.getIndexArray(0);
+        const Array& bitmap = modeIndex.getIndexArray(1);
+        const Array& rank = modeIndex.getIndexArray(2);
+        tensorData->indices[i][0] = (uint8_t*)size.getData();
+        tensorData->indices[i][1] = (uint8_t*)bitmap.getData();
+        tensorData->indices[i][2] = (uint8_t*)rank.getData();
+        break;
+      }
+    }
+  }
+  tensorData->vals = (uint8_t*)storage.getValues().getData();
 }
 
 /// Pack the tensor's indices and values into a taco_tensor_t object.
 static taco_tensor_t* packTensorData(const TensorBase& tensor) {
   taco_tensor_t* tensorData = (taco_tensor_t*)malloc(sizeof(taco_tensor_t));
   size_t order = tensor.getOrder();
-  Storage storage = tensor.getStorage();
-  Format format = storage.getFormat();
+  Format format = tensor.getFormat();
 
   taco_iassert(order <= INT_MAX);
   tensorData->order         = static_cast<int>(order);
@@ -405,10 +1272,8 @@ static taco_tensor_t* packTensorData(const TensorBase& tensor) {
   tensorData->mode_types    = (taco_mode_t*)malloc(order * sizeof(taco_mode_t));
   tensorData->indices       = (uint8_t***)malloc(order * sizeof(uint8_t***));
 
-  auto index = storage.getIndex();
   for (size_t i = 0; i < tensor.getOrder(); i++) {
     auto modeType  = format.getModeTypes()[i];
-    auto modeIndex = index.getModeIndex(i);
 
     tensorData->dimensions[i] = tensor.getDimension(i);
 
@@ -417,38 +1282,40 @@ static taco_tensor_t* packTensorData(const TensorBase& tensor) {
     tensorData->mode_ordering[i] = static_cast<int>(m);
 
     switch (modeType) {
-      case ModeType::Dense: {
+      case ModeType::Dense:
         tensorData->mode_types[i] = taco_mode_dense;
         tensorData->indices[i]    = (uint8_t**)malloc(1 * sizeof(uint8_t**));
-
-        const Array& size = modeIndex.getIndexArray(0);
-        tensorData->indices[i][0] = (uint8_t*)size.getData();
         break;
-      }
-      case ModeType::Sparse: {
-        tensorData->mode_types[i]  = taco_mode_sparse;
+      case ModeType::Sparse:
+        tensorData->mode_types[i] = taco_mode_sparse;
         tensorData->indices[i]    = (uint8_t**)malloc(2 * sizeof(uint8_t**));
-
-        // When packing results for assemblies they won't have sparse indices
-        if (modeIndex.numIndexArrays() == 0) {
-          continue;
-        }
-
-        const Array& pos = modeIndex.getIndexArray(0);
-        const Array& idx = modeIndex.getIndexArray(1);
-        tensorData->indices[i][0] = (uint8_t*)pos.getData();
-        tensorData->indices[i][1] = (uint8_t*)idx.getData();
-      }
+        break;
+      case ModeType::Singleton:
+        tensorData->mode_types[i] = taco_mode_singleton;
+        tensorData->indices[i]    = (uint8_t**)malloc(1 * sizeof(uint8_t**));
+        break;
+      case ModeType::Hashed:
+        tensorData->mode_types[i] = taco_mode_hashed;
+        tensorData->indices[i]    = (uint8_t**)malloc(3 * sizeof(uint8_t**));
+        break;
+      case ModeType::Bitmap:
+        tensorData->mode_types[i] = taco_mode_bitmap;
+        tensorData->indices[i]    = (uint8_t**)malloc(3 * sizeof(uint8_t**));
         break;
       case ModeType::Fixed:
-        taco_not_supported_yet;
+        tensorData->mode_types[i] = taco_mode_fixed;
+        tensorData->indices[i]    = (uint8_t**)malloc(2 * sizeof(uint8_t**));
+        break;
+      case ModeType::Diagonal:
+        tensorData->mode_types[i] = taco_mode_diagonal;
+        tensorData->indices[i]    = (uint8_t**)malloc(2 * sizeof(uint8_t**));
         break;
     }
   }
 
   taco_iassert(tensor.getComponentType().getNumBits() <= INT_MAX);
   tensorData->csize = static_cast<int>(tensor.getComponentType().getNumBits());
-  tensorData->vals  = (uint8_t*)storage.getValues().getData();
+  updateTensorData(tensorData, tensor);
 
   return tensorData;
 }
@@ -465,6 +1332,12 @@ static void freeTensorData(taco_tensor_t* tensorData) {
   free(tensorData);
 }
 
+TensorBase::Content::~Content() {
+  for (auto& argument : arguments) {
+    freeTensorData((taco_tensor_t*)argument);
+  }
+}
+
 taco_tensor_t* TensorBase::getTacoTensorT() {
   return packTensorData(*this);
 }
@@ -486,15 +1359,32 @@ static size_t unpackTensorData(const taco_tensor_t& tensorData,
         break;
       }
       case ModeType::Sparse: {
-        auto size = ((int*)tensorData.indices[i][0])[numVals];
-        Array pos = Array(type<int>(), tensorData.indices[i][0], numVals+1);
-        Array idx = Array(type<int>(), tensorData.indices[i][1], size);
+        Array pos = Array(format.getCoordinateTypePos(i),
+                          tensorData.indices[i][0], numVals+1);
+        size_t size = pos.get(numVals).getAsIndex();
+        Array idx = Array(format.getCoordinateTypeIdx(i),
+                          tensorData.indices[i][1], size);
         modeIndices.push_back(ModeIndex({pos, idx}));
         numVals = size;
         break;
       }
+      case ModeType::Singleton: {
+        Array idx = Array(format.getCoordinateTypeIdx(i),
+                          tensorData.indices[i][0], numVals);
+        modeIndices.push_back(ModeIndex({idx}));
+        break;
+      }
+      case ModeType::Hashed:
+        taco_ierror << "Hashed levels are allocated by the runtime";
+        break;
+      case ModeType::Bitmap:
+        taco_ierror << "Results cannot be stored in bitmap modes";
+        break;
       case ModeType::Fixed:
-        taco_not_supported_yet;
+        taco_ierror << "Results cannot be stored in fixed modes";
+        break;
+      case ModeType::Diagonal:
+        taco_ierror << "Results cannot be stored in diagonal modes";
         break;
     }
   }
@@ -503,67 +1393,270 @@ static size_t unpackTensorData(const taco_tensor_t& tensorData,
   return numVals;
 }
 
-static inline vector<TensorBase> getTensors(const IndexExpr& expr) {
-  struct GetOperands : public IndexNotationVisitor {
-    using IndexNotationVisitor::visit;
-    set<TensorBase> inserted;
-    vector<TensorBase> operands;
-    void visit(const AccessNode* node) {
-      taco_iassert(isa<AccessTensorNode>(node)) << "Unknown subexpression";
-      TensorBase tensor = to<AccessTensorNode>(node)->tensor;
-      if (!util::contains(inserted, tensor)) {
-        inserted.insert(tensor);
-        operands.push_back(tensor);
+/// Kernels are specialized to the index array types of their operands and to
+/// the segment sizes of their fixed and diagonal levels, so operands that were
+/// since packed with other types or segment sizes require the kernels to be
+/// recompiled.
+static void checkOperandFormats(const Stmt& func,
+                                const vector<TensorBase>& operands) {
+  for (auto& input : func.as<Function>()->inputs) {
+    const Var* tensorVar = input.as<Var>();
+    for (auto& operand : operands) {
+      if (operand.getName() != tensorVar->name) {
+        continue;
+      }
+      const Format& format = operand.getFormat();
+      taco_uassert(tensorVar->format.getLevelArrayTypes() ==
+                   format.getLevelArrayTypes())
+          << "The index arrays of tensor " << operand.getName() << " were "
+          << "packed with different types after the expression was compiled, "
+          << "so it must be recompiled";
+      for (size_t i = 0; i < format.getOrder(); i++) {
+        taco_uassert((format.getModeTypes()[i] != ModeType::Fixed &&
+                      format.getModeTypes()[i] != ModeType::Diagonal) ||
+                     tensorVar->format.getFixedSize(i) == 0 ||
+                     tensorVar->format.getFixedSize(i) ==
+                         format.getFixedSize(i))
+            << "The " << format.getModeTypes()[i] << " level " << i
+            << " of tensor " << operand.getName() << " was packed with a different segment size after the "
+            << "expression was compiled, so it must be recompiled";
       }
     }
-  };
-  GetOperands getOperands;
-  expr.accept(&getOperands);
-  return getOperands.operands;
+  }
 }
 
-static inline
-vector<void*> packArguments(const TensorBase& tensor) {
-  vector<void*> arguments;
+vector<void*>& TensorBase::bindArguments() {
+  if (content->arguments.empty()) {
+    // Pack the result tensor
+    content->arguments.push_back(packTensorData(*this));
 
-  // Pack the result tensor
-  arguments.push_back(packTensorData(tensor));
+    // Pack operand tensors
+    content->operands = getTensors(getTensorVar().getAssignment().getRhs());
+    for (auto& operand : content->operands) {
+      content->arguments.push_back(packTensorData(operand));
+    }
+  }
+  else {
+    // Storage may have been reallocated since the last call
+    updateTensorData((taco_tensor_t*)content->arguments[0], *this);
+    for (size_t i = 0; i < content->operands.size(); i++) {
+      updateTensorData((taco_tensor_t*)content->arguments[i+1],
+                       content->operands[i]);
+    }
+  }
+  checkOperandFormats(content->computeFunc, content->operands);
+  return content->arguments;
+}
 
-  // Pack operand tensors
-  auto operands = getTensors(tensor.getTensorVar().getAssignment().getRhs());
-  for (auto& operand : operands) {
-    arguments.push_back(packTensorData(operand));
+void TensorBase::unbindArguments() {
+  for (auto& argument : content->arguments) {
+    freeTensorData((taco_tensor_t*)argument);
+  }
+  content->arguments.clear();
+  content->operands.clear();
+}
+
+/// Returns true iff the format ends in a hashed level, which lowering only
+/// allows in results whose other levels are dense.
+static bool hasHashedLevel(const Format& format) {
+  return format.getOrder() > 0 &&
+         format.getModeTypes().back() == ModeType::Hashed;
+}
+
+/// Returns the number of segments of the hashed last level of a result, which
+/// is the number of positions of its dense levels.
+static size_t getNumHashedSegments(const Storage& storage) {
+  const Index& index = storage.getIndex();
+  size_t numSegments = 1;
+  for (size_t i = 0; i + 1 < storage.getFormat().getOrder(); i++) {
+    numSegments *= index.getModeIndex(i).getIndexArray(0).get(0).getAsIndex();
+  }
+  return numSegments;
+}
+
+/// Allocates the hashed last level of a result with `capacities[s]` slots in
+/// segment s, marks all slots as empty and zeroes the sizes and values.
+static void initHashedLevel(Storage storage, DataType ctype,
+                            const vector<size_t>& capacities) {
+  const Format& format = storage.getFormat();
+  const Index& index = storage.getIndex();
+  const size_t level = format.getOrder() - 1;
+  const size_t numSegments = capacities.size();
+
+  vector<ModeIndex> modeIndices;
+  for (size_t i = 0; i < level; i++) {
+    modeIndices.push_back(index.getModeIndex(i));
+  }
+  vector<size_t> segmentStarts(capacities);
+  segmentStarts.push_back(0);
+  const size_t numSlots = util::parallelExclusiveScan(segmentStarts);
+  taco_uassert(numSlots <= INT_MAX) << "The hashed mode of the result needs "
+      << numSlots << " slots, which exceeds the maximum of " << INT_MAX;
+
+  int* pos = (int*)malloc((numSegments + 1) * sizeof(int));
+  for (size_t s = 0; s <= numSegments; s++) {
+    pos[s] = (int)segmentStarts[s];
   }
+  int* idx = (int*)malloc(numSlots * sizeof(int));
+  std::fill(idx, idx + numSlots, -1);
+  int* size = (int*)calloc(numSegments, sizeof(int));
+  modeIndices.push_back(ModeIndex({Array(type<int>(), pos, numSegments + 1),
+                                   Array(type<int>(), idx, numSlots),
+                                   Array(type<int>(), size, numSegments)}));
+  storage.setIndex(Index(format, modeIndices));
+  storage.setValues(Array(ctype, calloc(numSlots, ctype.getNumBytes()),
+                          numSlots));
+}
 
-  return arguments;
+/// Grows the capacity of the segments of the hashed last level that a kernel
+/// could not insert a coordinate into, which it marks by setting the segment
+/// size to the capacity. Returns true iff any segment overflowed.
+static bool growOverflowedSegments(const Storage& storage,
+                                   vector<size_t>& capacities,
+                                   size_t maxCapacity) {
+  const size_t level = storage.getFormat().getOrder() - 1;
+  const ModeIndex& hashed = storage.getIndex().getModeIndex(level);
+  const int* size = (const int*)hashed.getIndexArray(2).getData();
+  bool overflowed = false;
+  for (size_t s = 0; s < capacities.size(); s++) {
+    if (2 * (size_t)size[s] > capacities[s]) {
+      taco_iassert(capacities[s] < maxCapacity);
+      capacities[s] = std::min(maxCapacity, 4 * capacities[s]);
+      overflowed = true;
+    }
+  }
+  return overflowed;
+}
+
+/// Compacts the hashed last level of a result into a sparse level, whose
+/// segments list the coordinates of the hash table segments in order.
+static Storage compactHashedLevel(const Storage& storage, DataType ctype) {
+  const Format& format = storage.getFormat();
+  const Index& index = storage.getIndex();
+  const size_t level = format.getOrder() - 1;
+  const ModeIndex& hashed = index.getModeIndex(level);
+  const int* pos = (const int*)hashed.getIndexArray(0).getData();
+  const int* idx = (const int*)hashed.getIndexArray(1).getData();
+  const int* size = (const int*)hashed.getIndexArray(2).getData();
+  const char* vals = (const char*)storage.getValues().getData();
+  const size_t numSegments = hashed.getIndexArray(0).getSize() - 1;
+  const size_t csize = ctype.getNumBytes();
+
+  vector<size_t> segmentStarts(size, size + numSegments);
+  const size_t numValues = util::parallelExclusiveScan(segmentStarts);
+  taco_iassert(numValues <= INT_MAX);
+
+  int* newPos = (int*)malloc((numSegments + 1) * sizeof(int));
+  int* newIdx = (int*)malloc(numValues * sizeof(int));
+  char* newVals = (char*)malloc(numValues * csize);
+  newPos[numSegments] = (int)numValues;
+  util::parallelFor(numSegments, [&](size_t, size_t begin, size_t end) {
+    vector<pair<int,size_t>> entries;
+    for (size_t s = begin; s < end; s++) {
+      entries.clear();
+      for (size_t slot = pos[s]; slot < (size_t)pos[s + 1]; slot++) {
+        if (idx[slot] != -1) {
+          entries.push_back({idx[slot], slot});
+        }
+      }
+      std::sort(entries.begin(), entries.end());
+      size_t p = segmentStarts[s];
+      newPos[s] = (int)p;
+      for (auto& entry : entries) {
+        newIdx[p] = entry.first;
+        memcpy(newVals + p * csize, vals + entry.second * csize, csize);
+        p++;
+      }
+    }
+  }, 1 << 8);
+
+  vector<ModeType> modeTypes = format.getModeTypes();
+  modeTypes[level] = ModeType::Sparse;
+  Format sparseFormat(modeTypes, format.getModeOrdering());
+  sparseFormat.setLevelArrayTypes(format.getLevelArrayTypes());
+
+  vector<ModeIndex> modeIndices;
+  for (size_t i = 0; i < level; i++) {
+    modeIndices.push_back(index.getModeIndex(i));
+  }
+  modeIndices.push_back(ModeIndex({Array(type<int>(), newPos, numSegments + 1),
+                                   Array(type<int>(), newIdx, numValues)}));
+  Storage sparseStorage(sparseFormat);
+  sparseStorage.setIndex(Index(sparseFormat, modeIndices));
+  sparseStorage.setValues(Array(ctype, newVals, numValues));
+  return sparseStorage;
+}
+
+void TensorBase::assembleHashed(const string& funcName) {
+  // Segments start small and those that overflow grow until a run fits every
+  // coordinate, so a few heavy segments do not grow the others. A segment
+  // never holds more coordinates than the dimension of the level and is kept
+  // at most half full, so twice the dimension always fits.
+  const int dimension = getDimension(getFormat().getModeOrdering().back());
+  size_t maxCapacity = 1;
+  while (maxCapacity < 2 * (size_t)dimension) {
+    maxCapacity *= 2;
+  }
+  vector<size_t> capacities(getNumHashedSegments(content->storage),
+                            std::min(maxCapacity, (size_t)16));
+  do {
+    initHashedLevel(content->storage, getComponentType(), capacities);
+    auto& arguments = bindArguments();
+    content->module->callFuncPacked(funcName, arguments.data());
+  } while (growOverflowedSegments(content->storage, capacities, maxCapacity));
 }
 
 void TensorBase::assemble() {
   taco_uassert(this->content->assembleFunc.defined())
       << error::assemble_without_compile;
 
-  auto arguments = packArguments(*this);
+  if (hasHashedLevel(getFormat())) {
+    if (!content->assembleWhileCompute) {
+      assembleHashed("assemble");
+    }
+    return;
+  }
+
+  auto& arguments = bindArguments();
   content->module->callFuncPacked("assemble", arguments.data());
 
   if (!content->assembleWhileCompute) {
     taco_tensor_t* tensorData = ((taco_tensor_t*)arguments[0]);
     content->valuesSize = unpackTensorData(*tensorData, *this);
   }
-  for (auto& argument : arguments) freeTensorData((taco_tensor_t*)argument);
 }
 
 void TensorBase::compute() {
   taco_uassert(this->content->computeFunc.defined())
       << error::compute_without_compile;
 
-  auto arguments = packArguments(*this);
+  if (hasHashedLevel(getFormat())) {
+    if (content->assembleWhileCompute) {
+      assembleHashed("compute");
+    }
+    else {
+      auto& arguments = bindArguments();
+      content->module->callFuncPacked("compute", arguments.data());
+    }
+
+    // The kernels and packed arguments describe the hashed level, so they are
+    // dropped along with it
+    content->storage = compactHashedLevel(content->storage, getComponentType());
+    content->valuesSize = content->storage.getValues().getSize();
+    content->tensorVar.setFormat(content->storage.getFormat());
+    content->assembleFunc = Stmt();
+    content->computeFunc = Stmt();
+    unbindArguments();
+    return;
+  }
+
+  auto& arguments = bindArguments();
   this->content->module->callFuncPacked("compute", arguments.data());
 
   if (content->assembleWhileCompute) {
     taco_tensor_t* tensorData = ((taco_tensor_t*)arguments[0]);
     content->valuesSize = unpackTensorData(*tensorData, *this);
   }
-  for (auto& argument : arguments) freeTensorData((taco_tensor_t*)argument);
 }
 
 void TensorBase::evaluate() {
@@ -582,6 +1675,7 @@ void TensorBase::operator=(const IndexExpr& expr) {
 }
 
 void TensorBase::setAssignment(Assignment assignment) {
+  unbindArguments();
   content->tensorVar.setAssignment(makeReductionNotation(assignment));
 }
 
@@ -612,11 +1706,15 @@ void TensorBase::compileSource(std::string source) {
                                        assembleProperties, getAllocSize());
   content->computeFunc  = lower::lower(tensorVar, "compute",
                                        computeProperties, getAllocSize());
+  markIndexTypesCompiled();
+
+  unbindArguments();
 
   stringstream ss;
   CodeGen_C::generateShim(content->assembleFunc, ss);
   ss << endl;
   CodeGen_C::generateShim(content->computeFunc, ss);
+  content->module = make_shared<Module>();
   content->module->setSource(source + "\n" + ss.str());
   content->module->compile();
 }
@@ -779,6 +1877,9 @@ TensorBase dispatchRead(T& file, FileType filetype, Format format, bool pack) {
     case FileType::rb:
       tensor = readRB(file, format, pack);
       break;
+    case FileType::bin:
+      tensor = readBin(file, format, pack);
+      break;
   }
   return tensor;
 }
@@ -799,6 +1900,9 @@ TensorBase read(std::string filename, Format format, bool pack) {
   else if (extension == "rb") {
     tensor = dispatchRead(filename, FileType::rb, format, pack);
   }
+  else if (extension == "bin") {
+    tensor = dispatchRead(filename, FileType::bin, format, pack);
+  }
   else {
     taco_uerror << "File extension not recognized: " << filename << std::endl;
   }
@@ -832,6 +1936,9 @@ void dispatchWrite(T& file, const TensorBase& tensor, FileType filetype) {
     case FileType::rb:
       writeRB(file, tensor);
       break;
+    case FileType::bin:
+      writeBin(file, tensor);
+      break;
   }
 }
 
@@ -852,6 +1959,9 @@ void write(string filename, const TensorBase& tensor) {
   else if (extension == "rb") {
     dispatchWrite(filename, tensor, FileType::rb);
   }
+  else if (extension == "bin") {
+    dispatchWrite(filename, tensor, FileType::bin);
+  }
   else {
     taco_uerror << "File extension not recognized: " << filename << std::endl;
   }
@@ -0,0 +1,143 @@
+#include "taco/util/parallel.h"
+#include "taco/util/env.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+using namespace std;
+
+namespace taco {
+namespace util {
+
+static atomic<size_t> numThreadsOverride(0);
+
+size_t getNumThreads() {
+  static const size_t envNumThreads = getSizeFromEnv("TACO_NUM_THREADS", 0);
+  size_t numThreads = numThreadsOverride;
+  if (numThreads == 0) {
+    numThreads = envNumThreads;
+  }
+  if (numThreads == 0) {
+    numThreads = max(thread::hardware_concurrency(), 1u);
+  }
+  return numThreads;
+}
+
+void setNumThreads(size_t numThreads) {
+  numThreadsOverride = numThreads;
+}
+
+size_t getNumChunks(size_t size, size_t minChunkSize) {
+  size_t numThreads = getNumThreads();
+  size_t numChunks = min(numThreads, size / max(minChunkSize, (size_t)1));
+  return max(numChunks, (size_t)1);
+}
+
+void parallelFor(size_t size, const function<void(size_t,size_t,size_t)>& body,
+                 size_t minChunkSize) {
+  size_t numChunks = getNumChunks(size, minChunkSize);
+  if (numChunks == 1) {
+    body(0, 0, size);
+    return;
+  }
+
+  vector<thread> threads;
+  for (size_t chunk = 1; chunk < numChunks; chunk++) {
+    size_t begin = size * chunk / numChunks;
+    size_t end = size * (chunk + 1) / numChunks;
+    threads.emplace_back(body, chunk, begin, end);
+  }
+  body(0, 0, size / numChunks);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+size_t parallelExclusiveScan(vector<size_t>& v) {
+  size_t numChunks = getNumChunks(v.size());
+  vector<size_t> chunkSums(numChunks);
+  parallelFor(v.size(), [&](size_t chunk, size_t begin, size_t end) {
+    size_t sum = 0;
+    for (size_t i = begin; i < end; i++) {
+      size_t value = v[i];
+      v[i] = sum;
+      sum += value;
+    }
+    chunkSums[chunk] = sum;
+  });
+
+  size_t total = 0;
+  for (auto& chunkSum : chunkSums) {
+    size_t sum = chunkSum;
+    chunkSum = total;
+    total += sum;
+  }
+
+  parallelFor(v.size(), [&](size_t chunk, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      v[i] += chunkSums[chunk];
+    }
+  });
+  return total;
+}
+
+void parallelRadixSort(vector<uint64_t>& keys, vector<size_t>& values,
+                       int numKeyBits) {
+  const int digitBits = 8;
+  const size_t numBuckets = 1 << digitBits;
+  const size_t size = keys.size();
+
+  size_t numChunks = getNumChunks(size);
+  vector<uint64_t> keysTmp(size);
+  vector<size_t> valuesTmp(size);
+  vector<vector<size_t>> offsets(numChunks, vector<size_t>(numBuckets));
+
+  for (int shift = 0; shift < numKeyBits; shift += digitBits) {
+    // Count the occurrences of each digit in each chunk
+    parallelFor(size, [&](size_t chunk, size_t begin, size_t end) {
+      vector<size_t>& counts = offsets[chunk];
+      fill(counts.begin(), counts.end(), 0);
+      for (size_t i = begin; i < end; i++) {
+        counts[(keys[i] >> shift) & (numBuckets - 1)]++;
+      }
+    });
+
+    // Nothing to do if every key has the same digit
+    bool sorted = false;
+    for (size_t bucket = 0; bucket < numBuckets; bucket++) {
+      size_t count = 0;
+      for (size_t chunk = 0; chunk < numChunks; chunk++) {
+        count += offsets[chunk][bucket];
+      }
+      sorted = sorted || (count == size);
+    }
+    if (sorted) {
+      continue;
+    }
+
+    // Each chunk scatters a digit's keys after the same digit's keys from
+    // earlier chunks, which keeps the sort stable
+    size_t offset = 0;
+    for (size_t bucket = 0; bucket < numBuckets; bucket++) {
+      for (size_t chunk = 0; chunk < numChunks; chunk++) {
+        size_t count = offsets[chunk][bucket];
+        offsets[chunk][bucket] = offset;
+        offset += count;
+      }
+    }
+
+    parallelFor(size, [&](size_t chunk, size_t begin, size_t end) {
+      vector<size_t>& positions = offsets[chunk];
+      for (size_t i = begin; i < end; i++) {
+        size_t position = positions[(keys[i] >> shift) & (numBuckets - 1)]++;
+        keysTmp[position] = keys[i];
+        valuesTmp[position] = values[i];
+      }
+    });
+    keys.swap(keysTmp);
+    values.swap(valuesTmp);
+  }
+}
+
+}}
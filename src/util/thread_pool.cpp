@@ -0,0 +1,56 @@
+#include "taco/util/thread_pool.h"
+
+using namespace std;
+
+namespace taco {
+namespace util {
+
+ThreadPool::ThreadPool(size_t numThreads) : stopping(false) {
+  if (numThreads == 0) {
+    numThreads = max(thread::hardware_concurrency(), 1u);
+  }
+  for (size_t i = 0; i < numThreads; i++) {
+    workers.emplace_back([this]() { work(); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    lock_guard<mutex> lock(tasksMutex);
+    stopping = true;
+  }
+  tasksAvailable.notify_all();
+  for (auto& worker : workers) {
+    worker.join();
+  }
+}
+
+size_t ThreadPool::getNumThreads() const {
+  return workers.size();
+}
+
+void ThreadPool::enqueue(function<void()> task) {
+  {
+    lock_guard<mutex> lock(tasksMutex);
+    tasks.push(move(task));
+  }
+  tasksAvailable.notify_one();
+}
+
+void ThreadPool::work() {
+  while (true) {
+    function<void()> task;
+    {
+      unique_lock<mutex> lock(tasksMutex);
+      tasksAvailable.wait(lock, [this]() { return stopping || !tasks.empty(); });
+      if (tasks.empty()) {
+        return;
+      }
+      task = move(tasks.front());
+      tasks.pop();
+    }
+    task();
+  }
+}
+
+}}
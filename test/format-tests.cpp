@@ -72,3 +72,317 @@ TEST(format, dense) {
   A.pack();
   ASSERT_STORAGE_EQUALS({{{3}}, {{3}}}, {0,2,0, 0,0,0, 3,0,4}, A);
 }
+
+TEST(format, singleton) {
+  Format coo({Sparse, Singleton});
+  ASSERT_FALSE(coo.isUnique(0));
+  ASSERT_TRUE(coo.isUnique(1));
+
+  Tensor<double> A = d33a("A", coo);
+  A.pack();
+  ASSERT_STORAGE_EQUALS({{{0,3}, {0,2,2}}, {{1,0,2}}}, {2,3,4}, A);
+  Tensor<double> csr = d33a("csr", CSR);
+  csr.pack();
+  ASSERT_TRUE(equals(csr, A));
+
+  Tensor<double> x = d3a("x", Dense);
+  x.pack();
+  Tensor<double> y("y", {3}, Dense);
+  Tensor<double> expected("expected", {3}, Dense);
+  IndexVar i("i"), j("j");
+  y(i) = A(i,j) * x(j);
+  y.evaluate();
+  expected(i) = csr(i,j) * x(j);
+  expected.evaluate();
+  ASSERT_TRUE(equals(expected, y));
+
+  Tensor<double> B("B", {3,3}, Format({Dense, Dense}));
+  B(i,j) = A(i,j);
+  B.evaluate();
+  Tensor<double> dense = d33a("dense", Format({Dense, Dense}));
+  dense.pack();
+  ASSERT_TRUE(equals(dense, B));
+
+  ASSERT_DEATH(Format({Dense, Singleton}), "must follow a sparse");
+  Tensor<double> C("C", {3,3}, coo);
+  C(i,j) = B(i,j);
+  ASSERT_DEATH(C.evaluate(), "singleton modes");
+}
+
+TEST(format, hashed) {
+  srand(5);
+  Tensor<double> B("B", {30,40}, CSR);
+  Tensor<double> C("C", {40,35}, CSR);
+  B.setDuplicatePolicy(DuplicatePolicy::Sum);
+  C.setDuplicatePolicy(DuplicatePolicy::Sum);
+  for (int k = 0; k < 300; k++) {
+    B.insert({rand() % 30, rand() % 40}, (double)(rand() % 10 + 1));
+    C.insert({rand() % 40, rand() % 35}, (double)(rand() % 10 + 1));
+  }
+  B.pack();
+  C.pack();
+
+  IndexVar i("i"), j("j"), k("k");
+  Tensor<double> D("D", {30,35}, Format({Dense, Dense}));
+  D(i,j) = B(i,k) * C(k,j);
+  D.evaluate();
+  Tensor<double> expected("expected", {30,35}, CSR);
+  D.forEach([&](const int* coordinate, double value) {
+    if (value != 0.0) {
+      expected.insert({coordinate[0], coordinate[1]}, value);
+    }
+  });
+  expected.pack();
+
+  // Rows are inserted out of order and outgrow the initial segments
+  Tensor<double> A("A", {30,35}, Format({Dense, Hashed}));
+  A(i,j) = B(i,k) * C(k,j);
+  A.evaluate();
+  ASSERT_EQ(CSR, A.getFormat());
+  ASSERT_TRUE(equals(expected, A));
+  ASSERT_DEATH(A.compute(), "compile method must be called before compute");
+
+  Tensor<double> E("E", {30,35}, Format({Dense, Hashed}));
+  E(i,j) = B(i,k) * C(k,j);
+  E.compile(true);
+  E.assemble();
+  E.compute();
+  ASSERT_TRUE(equals(expected, E));
+
+  Tensor<double> F("F", {30,35}, Format({Hashed, Dense}));
+  F(i,j) = B(i,k) * C(k,j);
+  ASSERT_DEATH(F.compile(), "must be the last mode");
+}
+
+TEST(format, hashed_heavy_segment) {
+  // A single full row only grows its own segment
+  const int m = 1000, n = 1000;
+  Tensor<double> B("B", {m,n}, CSR);
+  for (int k = 0; k < n; k++) {
+    B.insert({0,k}, 1.0);
+  }
+  for (int r = 1; r < m; r++) {
+    B.insert({r,r}, 2.0);
+  }
+  B.pack();
+
+  IndexVar i("i"), j("j");
+  Tensor<double> A("A", {m,n}, Format({Dense, Hashed}));
+  A(i,j) = B(i,j);
+  A.compile();
+  A.assemble();
+  auto pos = A.getStorage().getIndex().getModeIndex(1).getIndexArray(0);
+  ASSERT_EQ(2048u, pos.get(1).getAsIndex());
+  ASSERT_EQ(size_t(2048 + (m - 1) * 16), pos.get(m).getAsIndex());
+  A.compute();
+  ASSERT_TRUE(equals(B, A));
+}
+
+TEST(format, fixed) {
+  Format ell({Dense, Fixed});
+  Tensor<double> A = d33a("A", ell);
+  A.pack();
+  ASSERT_EQ(2u, A.getFormat().getFixedSize(1));
+  Tensor<double> csr = d33a("csr", CSR);
+  csr.pack();
+
+  // Kernels iterate over segments of the packed size, and accumulate over the
+  // coordinates that pad them
+  Tensor<double> x = d3a("x", Dense);
+  x.pack();
+  IndexVar i("i"), j("j");
+  Tensor<double> y("y", {3}, Dense);
+  y(i) = A(i,j) * x(j);
+  y.evaluate();
+  ASSERT_NE(string::npos, y.getSource().find("(iA + 1) * 2"));
+  Tensor<double> expected("expected", {3}, Dense);
+  expected(i) = csr(i,j) * x(j);
+  expected.evaluate();
+  ASSERT_TRUE(equals(expected, y));
+
+  Tensor<double> B("B", {3,3}, Format({Dense, Dense}));
+  B(i,j) = A(i,j);
+  B.evaluate();
+  Tensor<double> dense = d33a("dense", Format({Dense, Dense}));
+  dense.pack();
+  ASSERT_TRUE(equals(dense, B));
+
+  // Repacking with wider segments invalidates the kernels
+  A.insert({1,0}, 1.0);
+  A.insert({1,1}, 1.0);
+  A.insert({1,2}, 1.0);
+  A.pack();
+  ASSERT_DEATH(y.compute(), "must be recompiled");
+  y.compile();
+  y.assemble();
+  y.compute();
+  ASSERT_DOUBLE_EQ(6.0, ((double*)y.getStorage().getValues().getData())[1]);
+
+  Tensor<double> C("C", {3,3}, ell);
+  C(i,j) = B(i,j);
+  ASSERT_DEATH(C.evaluate(), "fixed modes");
+}
+
+TEST(format, diagonal) {
+  // Convert a tridiagonal matrix with a missing entry from CSR to DIA
+  Tensor<double> csr("csr", {5,5}, CSR);
+  for (int k = 0; k < 5; k++) {
+    if (k > 0) csr.insert({k,k-1}, -1.0);
+    csr.insert({k,k}, 2.0);
+    if (k < 4 && k != 2) csr.insert({k,k+1}, -1.0);
+  }
+  csr.pack();
+  Format dia({Dense, Diagonal});
+  Tensor<double> A("A", {5,5}, dia);
+  for (auto& value : csr) {
+    A.insert({(int)value.first[0], (int)value.first[1]}, value.second);
+  }
+  A.pack();
+  ASSERT_EQ(3u, A.getFormat().getFixedSize(1));
+  ASSERT_STORAGE_EQUALS({{{5}}, {{3}, {-1,0,1}}},
+                        {0,2,-1, -1,2,-1, -1,2,0, -1,2,-1, -1,2,0}, A);
+
+  // Kernels compute coordinates from the offsets instead of loading them
+  Tensor<double> x("x", {5}, Dense);
+  for (int k = 0; k < 5; k++) {
+    x.insert({k}, (double)(k + 1));
+  }
+  x.pack();
+  IndexVar i("i"), j("j");
+  Tensor<double> y("y", {5}, Dense);
+  y(i) = A(i,j) * x(j);
+  y.evaluate();
+  ASSERT_NE(string::npos, y.getSource().find("A2_offsets[(pA2 - iA * 3)]"));
+  Tensor<double> expected("expected", {5}, Dense);
+  expected(i) = csr(i,j) * x(j);
+  expected.evaluate();
+  ASSERT_TRUE(equals(expected, y));
+
+  Tensor<double> B("B", {5,5}, Format({Dense, Dense}));
+  B(i,j) = A(i,j);
+  B.evaluate();
+  Tensor<double> C("C", {5,5}, Format({Dense, Dense}));
+  C(i,j) = csr(i,j);
+  C.evaluate();
+  ASSERT_TRUE(equals(C, B));
+
+  Tensor<double> D("D", {5,5}, dia);
+  D(i,j) = B(i,j);
+  ASSERT_DEATH(D.evaluate(), "diagonal modes");
+  ASSERT_DEATH(Format({Sparse, Diagonal}), "first mode is dense");
+}
+
+TEST(format, bitmap) {
+  Format dbitmap({Dense, Bitmap});
+  Tensor<double> A = d33a("A", dbitmap);
+  A.pack();
+  // Bits 1, 6 and 8 are set in the first word, and only their values stored
+  ASSERT_STORAGE_EQUALS({{{3}}, {{3}, {(1<<1) | (1<<6) | (1<<8)}, {0,3}}},
+                        {2,3,4}, A);
+
+  Tensor<double> csr = d33a("csr", CSR);
+  csr.pack();
+  Tensor<double> x = d3a("x", Dense);
+  x.pack();
+  IndexVar i("i"), j("j");
+  Tensor<double> y("y", {3}, Dense);
+  y(i) = A(i,j) * x(j);
+  y.evaluate();
+  Tensor<double> expected("expected", {3}, Dense);
+  expected(i) = csr(i,j) * x(j);
+  expected.evaluate();
+  ASSERT_TRUE(equals(expected, y));
+
+  // Intersections locate into the bitmap instead of merging with it, and
+  // unions skip the positions that neither operand stores
+  Tensor<double> S = d33b("S", CSR);
+  S.pack();
+  Tensor<double> B("B", {3,3}, Format({Dense, Dense}));
+  B(i,j) = A(i,j) * S(i,j);
+  B.evaluate();
+  ASSERT_EQ(string::npos, B.getSource().find("while"));
+  ASSERT_NE(string::npos, B.getSource().find("A2_bitmap"));
+  ASSERT_NE(string::npos, B.getSource().find("__builtin_popcountll(A2_bitmap"));
+  Tensor<double> expectedB("expectedB", {3,3}, Format({Dense, Dense}));
+  expectedB(i,j) = csr(i,j) * S(i,j);
+  expectedB.evaluate();
+  ASSERT_TRUE(equals(expectedB, B));
+
+  Tensor<double> C("C", {3,3}, Format({Dense, Dense}));
+  C(i,j) = A(i,j) + A(i,j);
+  C.evaluate();
+  Tensor<double> expectedC("expectedC", {3,3}, Format({Dense, Dense}));
+  expectedC(i,j) = csr(i,j) + csr(i,j);
+  expectedC.evaluate();
+  ASSERT_TRUE(equals(expectedC, C));
+
+  // Unions with operands that store every value read zeros where unset
+  Tensor<double> E = d33b("E", Format({Dense, Dense}));
+  E.pack();
+  Tensor<double> F("F", {3,3}, Format({Dense, Dense}));
+  F(i,j) = A(i,j) + E(i,j);
+  F.evaluate();
+  Tensor<double> expectedF("expectedF", {3,3}, Format({Dense, Dense}));
+  expectedF(i,j) = csr(i,j) + E(i,j);
+  expectedF.evaluate();
+  ASSERT_TRUE(equals(expectedF, F));
+
+  Tensor<double> D("D", {3,3}, dbitmap);
+  D(i,j) = A(i,j);
+  ASSERT_DEATH(D.evaluate(), "bitmap modes");
+
+  Tensor<double> G("G", {3,3}, Format({Bitmap, Sparse}));
+  G.insert({0,1}, 1.0);
+  G.pack();
+  Tensor<double> H("H", {3,3}, Format({Dense, Dense}));
+  H(i,j) = G(i,j);
+  ASSERT_DEATH(H.evaluate(), "Only dense modes can follow the bitmap mode");
+}
+
+TEST(format, bitmap_words) {
+  // Rows span several words, which start in the middle of rows
+  const int m = 50, n = 300;
+  Format dbitmap({Dense, Bitmap});
+  Tensor<double> A("A", {m,n}, dbitmap);
+  Tensor<double> csr("csr", {m,n}, CSR);
+  Tensor<double> dense("dense", {m,n}, Format({Dense, Dense}));
+  for (int r = 0; r < m; r++) {
+    for (int c = (r * 7) % 5; c < n; c += 1 + (r + c) % 9) {
+      A.insert({r,c}, (double)(r * n + c));
+      csr.insert({r,c}, (double)(r * n + c));
+    }
+    dense.insert({r,(r * 13) % n}, 1.0);
+  }
+  A.pack();
+  csr.pack();
+  dense.pack();
+  ASSERT_EQ(csr.getStorage().getValues().getSize(),
+            A.getStorage().getValues().getSize());
+  ASSERT_EQ(size_t((m * n + 63) / 64),
+            A.getStorage().getIndex().getModeIndex(1).getIndexArray(1)
+                .getSize());
+  ASSERT_TRUE(equals(csr, A));
+  ASSERT_TRUE(equals(csr.transpose({1,0}, CSR), A.transpose({1,0}, CSR)));
+
+  Tensor<double> x("x", {n}, Dense);
+  for (int c = 0; c < n; c++) {
+    x.insert({c}, (double)(c % 4));
+  }
+  x.pack();
+  IndexVar i("i"), j("j");
+  Tensor<double> y("y", {m}, Dense);
+  y(i) = A(i,j) * x(j);
+  y.evaluate();
+  Tensor<double> expectedY("expectedY", {m}, Dense);
+  expectedY(i) = csr(i,j) * x(j);
+  expectedY.evaluate();
+  ASSERT_TRUE(equals(expectedY, y));
+
+  Tensor<double> B("B", {m,n}, Format({Dense, Dense}));
+  B(i,j) = A(i,j) + dense(i,j);
+  B.evaluate();
+  Tensor<double> expectedB("expectedB", {m,n}, Format({Dense, Dense}));
+  expectedB(i,j) = csr(i,j) + dense(i,j);
+  expectedB.evaluate();
+  ASSERT_TRUE(equals(expectedB, B));
+}
@@ -1,6 +1,15 @@
 #include "test.h"
 
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+
 #include "taco/tensor.h"
+#include "taco/storage/file_io_mtx.h"
+#include "taco/util/env.h"
+#include "taco/util/parallel.h"
 
 using namespace taco;
 
@@ -127,3 +136,127 @@ TEST(io, mtxsymmetric) {
 
   ASSERT_TRUE(equals(expected, tensor));
 }
+
+TEST(io, bin) {
+  Format dcsc({Sparse, Sparse}, {1, 0});
+  TensorBase expected(Float64, {32,32}, dcsc);
+  expected.insert({0, 0}, 101.0);
+  expected.insert({1, 0}, 102.0);
+  expected.insert({5, 2}, 307.1);
+  expected.insert({31, 31}, 1.5);
+  expected.pack();
+
+  std::string filename = util::getTmpdir() + "io-bin.bin";
+  write(filename, expected);
+
+  TensorBase tensor = read(filename, dcsc);
+  ASSERT_EQ(dcsc, tensor.getFormat());
+  ASSERT_TRUE(equals(expected, tensor));
+
+  // The arrays point into the mapped file
+  ASSERT_NE(expected.getStorage().getValues().getData(),
+            tensor.getStorage().getValues().getData());
+  ASSERT_EQ(0u, (size_t)tensor.getStorage().getValues().getData() % 64);
+
+  std::ifstream stream(filename, std::ios::binary);
+  TensorBase streamed = read(stream, FileType::bin, dcsc);
+  ASSERT_TRUE(equals(expected, streamed));
+
+  // Mapped tensors can be computed with like any other tensor
+  Format dcm({Dense, Dense}, {1, 0});
+  Tensor<double> a({32,32}, dcm);
+  IndexVar i, j;
+  a(i,j) = tensor(i,j) + tensor(i,j);
+  a.evaluate();
+  Tensor<double> doubled({32,32}, dcm);
+  doubled.insert({0, 0}, 202.0);
+  doubled.insert({1, 0}, 204.0);
+  doubled.insert({5, 2}, 614.2);
+  doubled.insert({31, 31}, 3.0);
+  doubled.pack();
+  ASSERT_TRUE(equals(doubled, a));
+
+  ASSERT_DEATH(read(filename, CSR), "stored as");
+  std::remove(filename.c_str());
+}
+
+TEST(io, tns_parallel) {
+  const int n = 60000;
+  std::stringstream file;
+  std::map<std::vector<int>,double> expected;
+  for (int k = 0; k < n; k++) {
+    if (k % 1000 == 0) {
+      file << "# comment" << std::endl << std::endl;
+    }
+    std::vector<int> coord = {k / 1000, k % 1000, k % 7};
+    char value[32];
+    snprintf(value, sizeof(value), (k % 2 == 0) ? "%g" : "%.17g",
+             (k % 3 == 0) ? k * 1e-3 : -k / 3.0);
+    file << coord[0]+1 << " " << coord[1]+1 << " " << coord[2]+1 << " "
+         << value << std::endl;
+    expected.insert({coord, strtod(value, nullptr)});
+  }
+
+  util::setNumThreads(4);
+  Tensor<double> tensor = read(file, FileType::tns, Sparse);
+  util::setNumThreads(0);
+  ASSERT_EQ(std::vector<int>({60, 1000, 7}), tensor.getDimensions());
+
+  size_t numValues = 0;
+  for (auto val = tensor.beginTyped<int>(); val != tensor.endTyped<int>();
+       ++val) {
+    std::vector<int> coord = {val->first[0], val->first[1], val->first[2]};
+    ASSERT_EQ(expected.at(coord), val->second);
+    numValues++;
+  }
+  ASSERT_EQ(expected.size(), numValues);
+}
+
+TEST(io, mtxcompressed) {
+  std::string general =
+      "%%MatrixMarket matrix coordinate real general\n"
+      "% rows are out of order\n"
+      "4 5 6\n"
+      "3 5 3.5\n"
+      "1 2 1.0\n"
+      "3 1 3.1\n"
+      "4 4 4.25\n"
+      "1 1 0.5\n"
+      "3 3 -3.3\n";
+  std::string symmetric =
+      "%%MatrixMarket matrix coordinate real symmetric\n"
+      "3 3 3\n"
+      "3 1 2.0\n"
+      "2 2 1.0\n"
+      "3 2 7.5\n";
+  std::string duplicates =
+      "%%MatrixMarket matrix coordinate real general\n"
+      "2 2 3\n"
+      "2 1 1.0\n"
+      "1 2 2.0\n"
+      "2 1 4.0\n";
+  for (auto& file : {general, symmetric, duplicates}) {
+    for (auto& format : {CSR, CSC}) {
+      std::stringstream stream(file);
+      TensorBase tensor = read(stream, FileType::mtx, format);
+      ASSERT_EQ(format, tensor.getFormat());
+
+      std::stringstream expectedStream(file);
+      TensorBase expected = read(expectedStream, FileType::mtx, format, false);
+      expected.setDuplicatePolicy(DuplicatePolicy::First);
+      expected.pack();
+      ASSERT_TRUE(equals(expected, tensor));
+    }
+  }
+
+  // Duplicates are combined as the caller asks
+  for (auto& format : {CSR, CSC}) {
+    std::stringstream stream(duplicates);
+    TensorBase tensor = readMTX(stream, format, true, DuplicatePolicy::Sum);
+    TensorBase expected(Float64, {2, 2}, format);
+    expected.insert({1, 0}, 5.0);
+    expected.insert({0, 1}, 2.0);
+    expected.pack();
+    ASSERT_TRUE(equals(expected, tensor));
+  }
+}
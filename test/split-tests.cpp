@@ -51,3 +51,132 @@ TEST(split, spmspm) {
   ASSERT_TENSOR_EQ(E,A);
 }
 */
+
+static Tensor<double> randomMatrix(std::string name, std::vector<int> dims,
+                                   Format format, int nnzPerRow) {
+  Tensor<double> M(name, dims, format);
+  for (int i = 0; i < dims[0]; i++) {
+    for (int k = 0; k < nnzPerRow; k++) {
+      M.insert({i, rand() % dims[1]}, (double)(rand() % 10));
+    }
+  }
+  M.pack();
+  return M;
+}
+
+TEST(split, tile) {
+  srand(31);
+  Tensor<double> B = randomMatrix("B", {70, 50}, CSR, 3);
+  Tensor<double> C = randomMatrix("C", {50, 90}, Format({Dense,Dense}), 90);
+
+  IndexVar i("i"), j("j"), k("k"), j0("j0"), j1("j1");
+  Tensor<double> expected("expected", {70, 90}, Format({Dense,Dense}));
+  expected(i,j) = B(i,k) * C(k,j);
+  expected.evaluate();
+
+  // Tile the columns of the result so that a block of C stays in cache
+  // while the rows of B are streamed through
+  Tensor<double> A("A", {70, 90}, Format({Dense,Dense}));
+  A(i,j) = B(i,k) * C(k,j);
+  Schedule schedule;
+  schedule.split(j, j0, j1, 32);
+  schedule.reorder({j0, i, k, j1});
+  A.setSchedule(schedule);
+  A.compile();
+  ASSERT_NE(std::string::npos, A.getSource().find("j0 += 32"));
+  ASSERT_LT(A.getSource().find("j0 += 32"), A.getSource().find("for (int32_t i"));
+  A.assemble();
+  A.compute();
+  ASSERT_TENSOR_EQ(expected, A);
+}
+
+TEST(split, unroll) {
+  srand(37);
+  Tensor<double> B = randomMatrix("B", {30, 45}, Format({Dense,Dense}), 45);
+  Tensor<double> c("c", {45}, Format({Dense}));
+  for (int j = 0; j < 45; j++) {
+    c.insert({j}, (double)(rand() % 10));
+  }
+  c.pack();
+
+  IndexVar i("i"), j("j"), i0("i0"), i1("i1");
+  Tensor<double> expected("expected", {30}, Format({Dense}));
+  expected(i) = B(i,j) * c(j);
+  expected.evaluate();
+
+  Tensor<double> a("a", {30}, Format({Dense}));
+  a(i) = B(i,j) * c(j);
+  Schedule schedule;
+  schedule.split(i, i0, i1, 8);
+  schedule.unroll(j, 4);
+  schedule.parallelize(i0, false);
+  schedule.parallelize(i1, false);
+  a.setSchedule(schedule);
+  a.compile();
+  ASSERT_EQ(std::string::npos, a.getSource().find("#pragma omp"));
+  ASSERT_NE(std::string::npos, a.getSource().find("jB += 4"));
+  a.assemble();
+  a.compute();
+  ASSERT_TENSOR_EQ(expected, a);
+}
+
+TEST(split, reorder_conflict) {
+  Tensor<double> A("A", {4, 4}, Format({Dense,Dense}));
+  Tensor<double> B("B", {4, 4}, CSR);
+  IndexVar i("i"), j("j");
+  A(i,j) = B(i,j);
+
+  // The columns of a CSR matrix can only be iterated inside its rows
+  Schedule schedule;
+  schedule.reorder({j, i});
+  A.setSchedule(schedule);
+  ASSERT_DEATH(A.compile(), "conflicts with the order of the modes");
+}
+
+TEST(split, auto_reorder) {
+  srand(41);
+  Format csf({Dense,Sparse,Sparse});
+  Tensor<double> B("B", {10, 40, 40}, csf);
+  Tensor<double> C("C", {10, 40, 40}, Format({Dense,Dense,Dense}));
+  for (int i = 0; i < 10; i++) {
+    for (int n = 0; n < 3; n++) {
+      B.insert({i, rand() % 40, rand() % 40}, (double)(rand() % 10));
+    }
+    for (int k = 0; k < 40; k++) {
+      for (int l = 0; l < 40; l++) {
+        C.insert({i, k, l}, (double)(rand() % 10));
+      }
+    }
+  }
+  B.pack();
+  C.pack();
+
+  IndexVar i("i"), j("j"), k("k"), l("l");
+  Tensor<double> expected("expected", {10}, Format({Dense}));
+  expected(i) = B(i,j,l) * C(i,k,l);
+  expected.evaluate();
+
+  // The few rows of each slice of B should be iterated outside of the columns
+  // of C, rather than once per column
+  Tensor<double> a("a", {10}, Format({Dense}));
+  a(i) = B(i,j,l) * C(i,k,l);
+  Schedule schedule;
+  schedule.autoReorder();
+  a.setSchedule(schedule);
+  a.compile();
+  std::string source = a.getSource();
+  ASSERT_NE(std::string::npos, source.find("for (int32_t kC"));
+  ASSERT_LT(source.find("for (int32_t pB2"), source.find("for (int32_t kC"));
+  ASSERT_TRUE(schedule.getLoopOrder().empty());
+  a.assemble();
+  a.compute();
+  ASSERT_TENSOR_EQ(expected, a);
+
+  // The schedule can be shared with an expression over other variables
+  IndexVar m("m"), n("n");
+  Tensor<double> b("b", {10}, Format({Dense}));
+  b(m) = B(m,n,l) * C(m,k,l);
+  b.setSchedule(schedule);
+  b.evaluate();
+  ASSERT_TENSOR_EQ(expected, b);
+}
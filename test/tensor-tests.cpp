@@ -2,8 +2,16 @@
 #include "taco/tensor.h"
 #include "test_tensors.h"
 
+#include <atomic>
 #include <vector>
 #include "taco/util/collections.h"
+#include "taco/util/parallel.h"
+#include "codegen/kernel_cache.h"
+
+#include <dirent.h>
+#include <fstream>
+#include <utime.h>
+#include <sys/stat.h>
 
 using namespace taco;
 
@@ -65,6 +73,37 @@ TEST(tensor, duplicates) {
   }
 }
 
+TEST(tensor, duplicate_policies) {
+  map<DuplicatePolicy,double> expected = {{DuplicatePolicy::First, 42.0},
+                                          {DuplicatePolicy::Last,  1.0},
+                                          {DuplicatePolicy::Sum,   46.0},
+                                          {DuplicatePolicy::Max,   42.0},
+                                          {DuplicatePolicy::Min,   1.0}};
+  for (auto& policy : expected) {
+    Tensor<double> a("a", {5,5}, Format({Sparse, Sparse}));
+    a.setDuplicatePolicy(policy.first);
+    a.insert({1,2}, 42.0);
+    a.insert({2,2}, 10.0);
+    a.insert({1,2}, 3.0);
+    a.insert({1,2}, 1.0);
+    a.pack();
+    map<vector<int>,double> vals = {{{1,2}, policy.second}, {{2,2}, 10.0}};
+    size_t numVals = 0;
+    for (auto val = a.beginTyped<int>(); val != a.endTyped<int>(); ++val) {
+      ASSERT_TRUE(util::contains(vals, val->first));
+      ASSERT_EQ(vals.at(val->first), val->second);
+      numVals++;
+    }
+    ASSERT_EQ(vals.size(), numVals);
+  }
+
+  Tensor<double> b("b", {5,5}, Format({Sparse, Sparse}));
+  b.setDuplicatePolicy(DuplicatePolicy::Error);
+  b.insert({1,2}, 42.0);
+  b.insert({1,2}, 1.0);
+  ASSERT_DEATH(b.pack(), "Duplicate coordinate");
+}
+
 TEST(tensor, transpose) {
   TensorData<double> testData = TensorData<double>({5, 3, 2}, {
     {{0,0,0}, 0.0},
@@ -96,3 +135,603 @@ TEST(tensor, transpose) {
   ASSERT_TRUE(equals(tensor.transpose({2,0,1}, Format({Sparse, Sparse, Dense}, {2, 1, 0})), transposedTensor2));
   ASSERT_TRUE(equals(tensor.transpose({0,1,2}), tensor));
 }
+
+TEST(tensor, kernel_cache) {
+  Format csr({Dense, Sparse});
+  Tensor<double> B1("B1", {3,3}, csr), c1("c1", {3}, Format({Dense}));
+  Tensor<double> B2("B2", {3,3}, csr), c2("c2", {3}, Format({Dense}));
+  B1.insert({0,1}, 2.0);
+  B1.insert({2,2}, 3.0);
+  B2.insert({1,0}, 4.0);
+  c1.insert({1}, 1.0);
+  c1.insert({2}, 2.0);
+  c2.insert({0}, 5.0);
+  B1.pack();
+  B2.pack();
+  c1.pack();
+  c2.pack();
+
+  IndexVar i("i"), j("j"), k("k"), l("l");
+  Tensor<double> a1("a1", {3}, Format({Dense}));
+  Tensor<double> a2("a2", {3}, Format({Dense}));
+  a1(i) = B1(i,j) * c1(j);
+  a2(k) = B2(k,l) * c2(l);
+  a1.compile();
+  a2.compile();
+  ASSERT_EQ(a1.getSource(), a2.getSource());
+
+  a1.assemble();
+  a1.compute();
+  a2.assemble();
+  a2.compute();
+
+  Tensor<double> expected1("expected1", {3}, Format({Dense}));
+  expected1.insert({0}, 2.0);
+  expected1.insert({2}, 6.0);
+  expected1.pack();
+  ASSERT_TRUE(equals(expected1, a1));
+
+  Tensor<double> expected2("expected2", {3}, Format({Dense}));
+  expected2.insert({1}, 20.0);
+  expected2.pack();
+  ASSERT_TRUE(equals(expected2, a2));
+
+  // Different dimensions and formats must not share kernels
+  Tensor<double> B3("B3", {4,3}, csr), c3("c3", {3}, Format({Dense}));
+  Tensor<double> a3("a3", {4}, Format({Dense}));
+  a3(i) = B3(i,j) * c3(j);
+  a3.compile();
+  ASSERT_NE(a1.getSource(), a3.getSource());
+
+  Tensor<double> B4("B4", {3,3}, Format({Sparse, Sparse}));
+  Tensor<double> a4("a4", {3}, Format({Dense}));
+  a4(i) = B4(i,j) * c1(j);
+  a4.compile();
+  ASSERT_NE(a1.getSource(), a4.getSource());
+}
+
+TEST(tensor, persistent_kernel_cache) {
+  char cachedirTemplate[] = "/tmp/taco_cache_test_XXXXXX";
+  string cachedir = mkdtemp(cachedirTemplate);
+  setenv("TACO_CACHE_DIR", cachedir.c_str(), 1);
+
+  auto countLibraries = [&]() {
+    int count = 0;
+    DIR* dir = opendir(cachedir.c_str());
+    while (struct dirent* entry = readdir(dir)) {
+      string name = entry->d_name;
+      count += (name.size() > 3 && name.substr(name.size() - 3) == ".so");
+    }
+    closedir(dir);
+    return count;
+  };
+
+  // A temporary file left behind by a process that died while compiling is
+  // evicted, while one that another process is still writing is kept. A
+  // malformed cache size falls back to the default.
+  auto exists = [&](string name) {
+    struct stat st;
+    return stat((cachedir + "/" + name).c_str(), &st) == 0;
+  };
+  string orphan = "taco_0123456789abcdef.so.1.0.tmp";
+  string inProgress = "taco_fedcba9876543210.so.2.0.tmp";
+  ofstream(cachedir + "/" + orphan) << "orphan";
+  ofstream(cachedir + "/" + inProgress) << "in progress";
+  struct utimbuf old;
+  old.actime = old.modtime = time(nullptr) - 2 * 60 * 60;
+  utime((cachedir + "/" + orphan).c_str(), &old);
+  setenv("TACO_CACHE_SIZE", "lots", 1);
+
+  IndexVar i("i");
+  Tensor<double> b("b", {7}, Format({Dense}));
+  b.insert({3}, 2.0);
+  b.pack();
+  Tensor<double> expected("expected", {7}, Format({Dense}));
+  expected.insert({3}, 4.0);
+  expected.pack();
+  for (int run = 0; run < 2; run++) {
+    // Force a fresh module so that the library is looked up on disk
+    ir::KernelCache::getInstance().clear();
+    Tensor<double> a("a", {7}, Format({Dense}));
+    a(i) = b(i) * b(i);
+    a.evaluate();
+    ASSERT_EQ(1, countLibraries());
+    ASSERT_TRUE(equals(expected, a));
+  }
+  ASSERT_FALSE(exists(orphan));
+  ASSERT_TRUE(exists(inProgress));
+  unsetenv("TACO_CACHE_SIZE");
+  unsetenv("TACO_CACHE_DIR");
+
+  DIR* dir = opendir(cachedir.c_str());
+  while (struct dirent* entry = readdir(dir)) {
+    remove((cachedir + "/" + entry->d_name).c_str());
+  }
+  closedir(dir);
+  rmdir(cachedir.c_str());
+}
+
+TEST(tensor, compile_async) {
+  IndexVar i("i");
+  vector<Tensor<double>> bs, as;
+  vector<TensorBase> tensors;
+  for (int n = 1; n <= 4; n++) {
+    Tensor<double> b("b", {n+20}, Format({Sparse}));
+    b.insert({n}, (double)n);
+    b.pack();
+    Tensor<double> a("a", {n+20}, Format({Dense}));
+    a(i) = b(i) + b(i);
+    bs.push_back(b);
+    as.push_back(a);
+    tensors.push_back(a);
+  }
+  compile(tensors);
+  for (int n = 1; n <= 4; n++) {
+    as[n-1].assemble();
+    as[n-1].compute();
+    Tensor<double> expected("expected", {n+20}, Format({Dense}));
+    expected.insert({n}, 2.0*n);
+    expected.pack();
+    ASSERT_TRUE(equals(expected, as[n-1]));
+  }
+
+  Tensor<double> c("c", {21}, Format({Sparse}));
+  c(i) = bs[0](i) * bs[0](i);
+  shared_future<void> compilation = c.compileAsync();
+  c.assemble();
+  c.compute();
+  ASSERT_TRUE(compilation.wait_for(chrono::seconds(0)) == future_status::ready);
+}
+
+TEST(tensor, repeated_compute) {
+  Tensor<double> B("B", {3,3}, Format({Dense, Sparse}));
+  Tensor<double> c("c", {3}, Format({Dense}));
+  B.insert({0,1}, 2.0);
+  B.insert({2,2}, 3.0);
+  B.pack();
+  c.insert({1}, 1.0);
+  c.pack();
+
+  IndexVar i("i"), j("j");
+  Tensor<double> a("a", {3}, Format({Dense}));
+  a(i) = B(i,j) * c(j);
+  a.compile();
+  a.assemble();
+  a.compute();
+  a.compute();
+
+  Tensor<double> expected("expected", {3}, Format({Dense}));
+  expected.insert({0}, 2.0);
+  expected.pack();
+  ASSERT_TRUE(equals(expected, a));
+
+  // Repacking reallocates the operand's storage
+  c.insert({2}, 2.0);
+  c.pack();
+  a.assemble();
+  a.compute();
+  Tensor<double> expected2("expected2", {3}, Format({Dense}));
+  expected2.insert({2}, 6.0);
+  expected2.pack();
+  ASSERT_TRUE(equals(expected2, a));
+}
+
+TEST(tensor, pack_parallel) {
+  const int n = 50000;
+  vector<Format> formats = {Format({Dense, Sparse}),
+                            Format({Sparse, Sparse}),
+                            Format({Dense, Sparse}, {1,0})};
+  for (auto& format : formats) {
+    srand(7);
+    map<vector<int>,double> expected;
+    Tensor<double> parallel("parallel", {1000, 900}, format);
+    for (int k = 0; k < n; k++) {
+      vector<int> coord = {rand() % 1000, rand() % 900};
+      double value = (double)(rand() % 100);
+      if (!util::contains(expected, coord)) {
+        expected.insert({coord, value});
+      }
+      parallel.insert(coord, value);
+    }
+
+    util::setNumThreads(4);
+    parallel.pack();
+    util::setNumThreads(0);
+
+    size_t numValues = 0;
+    for (auto val = parallel.beginTyped<int>(); val != parallel.endTyped<int>();
+         ++val) {
+      vector<int> coord = {val->first[0], val->first[1]};
+      ASSERT_TRUE(util::contains(expected, coord));
+      ASSERT_EQ(expected.at(coord), val->second);
+      numValues++;
+    }
+    ASSERT_EQ(expected.size(), numValues);
+  }
+}
+
+TEST(tensor, parallel_sparse_result) {
+  Format csr({Dense, Sparse});
+  Tensor<double> B("B", {200, 150}, csr), C("C", {200, 150}, csr);
+  srand(11);
+  for (int k = 0; k < 2000; k++) {
+    // Leave every tenth row empty
+    int row = rand() % 200;
+    if (row % 10 != 0) {
+      B.insert({row, rand() % 150}, (double)(rand() % 100));
+    }
+    C.insert({rand() % 200, rand() % 150}, (double)(rand() % 100));
+  }
+  B.pack();
+  C.pack();
+
+  // Assembly counts the rows of the result, then fills them in parallel
+  IndexVar i("i"), j("j");
+  Tensor<double> A("A", {200, 150}, csr);
+  A(i,j) = B(i,j) + C(i,j);
+  A.compile();
+  std::string source = A.getSource();
+  ASSERT_EQ(std::string::npos, source.find("realloc"));
+  ASSERT_NE(std::string::npos, source.find("int32_t pA2 = A2_pos[iB];"));
+  size_t assemble = source.find("int assemble");
+  size_t compute = source.find("int compute");
+  ASSERT_NE(std::string::npos,
+            source.substr(assemble, compute - assemble).find("#pragma omp"));
+  ASSERT_NE(std::string::npos, source.substr(compute).find("#pragma omp"));
+  A.assemble();
+  A.compute();
+
+  Tensor<double> expected("expected", {200, 150}, csr);
+  expected(i,j) = B(i,j) + C(i,j);
+  expected.compile(true);
+  expected.assemble();
+  expected.compute();
+  ASSERT_TRUE(equals(expected, A));
+}
+
+TEST(tensor, parallel_sparse_result_sparse_rows) {
+  // Rows the operands do not store are skipped by the root loop, so they must
+  // be empty in the result
+  Format csr({Dense, Sparse});
+  Format dcsr({Sparse, Sparse});
+  Tensor<double> B("B", {200, 150}, dcsr), C("C", {200, 150}, dcsr);
+  srand(13);
+  for (int k = 0; k < 3000; k++) {
+    int row = rand() % 200;
+    if (row % 3 != 0) {
+      B.insert({row, rand() % 150}, (double)(rand() % 100));
+    }
+    C.insert({rand() % 200, rand() % 150}, (double)(rand() % 100));
+  }
+  B.pack();
+  C.pack();
+
+  IndexVar i("i"), j("j");
+  Tensor<double> A("A", {200, 150}, csr);
+  A(i,j) = B(i,j) * C(i,j);
+  A.compile();
+  A.assemble();
+  A.compute();
+
+  map<vector<int>,double> cvals;
+  for (auto val = C.beginTyped<int>(); val != C.endTyped<int>(); ++val) {
+    cvals[{val->first[0], val->first[1]}] = val->second;
+  }
+  Tensor<double> expected("expected", {200, 150}, csr);
+  for (auto val = B.beginTyped<int>(); val != B.endTyped<int>(); ++val) {
+    vector<int> coord = {val->first[0], val->first[1]};
+    if (util::contains(cvals, coord)) {
+      expected.insert(coord, val->second * cvals.at(coord));
+    }
+  }
+  expected.pack();
+  ASSERT_TRUE(equals(expected, A));
+
+  const int* pos = (const int*)A.getStorage().getIndex().getModeIndex(1)
+                                .getIndexArray(0).getData();
+  for (int row = 0; row < 200; row += 3) {
+    ASSERT_EQ(pos[row], pos[row + 1]);
+  }
+}
+
+TEST(tensor, parallel_reduction) {
+  Format dv({Dense});
+  Tensor<double> A("A", {120, 90}, CSR);
+  Tensor<double> x("x", {120}, dv), z("z", {120}, dv);
+  std::vector<double> xvals(120), zvals(120), yvals(90, 0.0);
+  srand(17);
+  for (int k = 0; k < 120; k++) {
+    xvals[k] = (double)(rand() % 100);
+    zvals[k] = (double)(rand() % 100);
+    x.insert({k}, xvals[k]);
+    z.insert({k}, zvals[k]);
+  }
+  for (int k = 0; k < 120; k++) {
+    // One nonzero per row keeps the reference free of duplicate coordinates
+    int col = rand() % 90;
+    double val = (double)(rand() % 100);
+    A.insert({k, col}, val);
+    yvals[col] += val * xvals[k];
+  }
+  A.pack();
+  x.pack();
+  z.pack();
+
+  // Each thread accumulates into a private copy of the result
+  IndexVar i("i"), j("j");
+  Tensor<double> a("a");
+  a = x(i) * z(i);
+  a.compile();
+  ASSERT_NE(std::string::npos, a.getSource().find("reduction(+:ta)"));
+  a.assemble();
+  a.compute();
+  double dot = 0.0;
+  for (int k = 0; k < 120; k++) {
+    dot += xvals[k] * zvals[k];
+  }
+  ASSERT_DOUBLE_EQ(dot, ((double*)a.getStorage().getValues().getData())[0]);
+
+  // Threads add into the result vector atomically
+  Tensor<double> y("y", {90}, dv);
+  y(j) = A(i,j) * x(i);
+  y.compile();
+  std::string source = y.getSource();
+  ASSERT_EQ(std::string::npos, source.find("reduction(+:y_vals"));
+  size_t compute = source.find("int compute");
+  size_t parallel = source.find("#pragma omp parallel for", compute);
+  size_t atomic = source.find("#pragma omp atomic", compute);
+  ASSERT_NE(std::string::npos, parallel);
+  ASSERT_NE(std::string::npos, atomic);
+  ASSERT_LT(parallel, atomic);
+  ASSERT_EQ(std::string::npos,
+            source.substr(0, compute).find("#pragma omp atomic"));
+  y.assemble();
+  y.compute();
+  double* yresult = (double*)y.getStorage().getValues().getData();
+  for (int k = 0; k < 90; k++) {
+    ASSERT_DOUBLE_EQ(yvals[k], yresult[k]);
+  }
+}
+
+TEST(tensor, parallel_reduction_large_result) {
+  // Private copies of a result this large would overflow the thread stacks,
+  // so threads add into the result atomically. Every thread adds into y(0).
+  const char* cflags = getenv("TACO_CFLAGS");
+  std::string savedCflags = (cflags != nullptr) ? cflags : "";
+  setenv("TACO_CFLAGS", "-O3 -ffast-math -std=c99 -fopenmp", 1);
+
+  const int n = 2000000;
+  Format dv({Dense});
+  Tensor<double> A("A", {n, n}, CSR);
+  Tensor<double> x("x", {n}, dv);
+  for (int k = 0; k < n; k += 1000) {
+    A.insert({k, n - 1 - k}, 2.0);
+    x.insert({k}, (double)(k % 7));
+    A.insert({k + 1, 0}, 1.0);
+    x.insert({k + 1}, 1.0);
+  }
+  A.pack();
+  x.pack();
+
+  IndexVar i("i"), j("j");
+  Tensor<double> y("y", {n}, dv);
+  y(j) = A(i,j) * x(i);
+  y.compile();
+  ASSERT_EQ(std::string::npos, y.getSource().find("reduction(+:y_vals"));
+  ASSERT_NE(std::string::npos, y.getSource().find("#pragma omp atomic"));
+  y.assemble();
+  y.compute();
+  double* yresult = (double*)y.getStorage().getValues().getData();
+  for (int k = 0; k < n; k += 1000) {
+    ASSERT_DOUBLE_EQ(2.0 * (k % 7), yresult[n - 1 - k]);
+  }
+  ASSERT_DOUBLE_EQ(n / 1000, yresult[0]);
+
+  if (cflags != nullptr) {
+    setenv("TACO_CFLAGS", savedCflags.c_str(), 1);
+  }
+  else {
+    unsetenv("TACO_CFLAGS");
+  }
+}
+
+TEST(tensor, workspace) {
+  srand(23);
+  Tensor<double> B("B", {30,40}, CSR);
+  Tensor<double> C("C", {40,35}, CSR);
+  B.setDuplicatePolicy(DuplicatePolicy::Sum);
+  C.setDuplicatePolicy(DuplicatePolicy::Sum);
+  for (int k = 0; k < 300; k++) {
+    B.insert({rand() % 30, rand() % 40}, (double)(rand() % 10 + 1));
+    C.insert({rand() % 40, rand() % 35}, (double)(rand() % 10 + 1));
+  }
+  B.pack();
+  C.pack();
+
+  IndexVar i("i"), j("j"), k("k");
+  Tensor<double> D("D", {30,35}, Format({Dense, Dense}));
+  D(i,j) = B(i,k) * C(k,j);
+  D.evaluate();
+  Tensor<double> expected("expected", {30,35}, CSR);
+  D.forEach([&](const int* coordinate, double value) {
+    if (value != 0.0) {
+      expected.insert({coordinate[0], coordinate[1]}, value);
+    }
+  });
+  expected.pack();
+
+  // Rows are scattered into a dense workspace and gathered in sorted order
+  Tensor<double> A("A", {30,35}, CSR);
+  A(i,j) = B(i,k) * C(k,j);
+  A.compile();
+  ASSERT_NE(std::string::npos, A.getSource().find("w[jC] = w[jC] +"));
+  A.assemble();
+  A.compute();
+  ASSERT_TRUE(equals(expected, A));
+
+  Tensor<double> E("E", {30,35}, CSR);
+  E(i,j) = B(i,k) * C(k,j);
+  E.compile(true);
+  E.assemble();
+  E.compute();
+  ASSERT_TRUE(equals(expected, E));
+}
+
+TEST(tensor, adopt) {
+  // [0 1 0]
+  // [0 0 0]
+  // [2 0 3]
+  int rowptr[] = {0, 1, 1, 3};
+  int colidx[] = {1, 0, 2};
+  double vals[] = {1.0, 2.0, 3.0};
+  Tensor<double> A("A", {3,3}, CSR);
+  A.adopt({{}, {rowptr, colidx}}, vals);
+  ASSERT_EQ(vals, A.getStorage().getValues().getData());
+
+  Tensor<double> x("x", {3}, Format({Dense}));
+  x.insert({0}, 1.0);
+  x.insert({1}, 2.0);
+  x.insert({2}, 3.0);
+  x.pack();
+
+  IndexVar i("i"), j("j");
+  Tensor<double> y("y", {3}, Format({Dense}));
+  y(i) = A(i,j) * x(j);
+  y.evaluate();
+
+  Tensor<double> expected("expected", {3}, Format({Dense}));
+  expected.insert({0}, 2.0);
+  expected.insert({2}, 11.0);
+  expected.pack();
+  ASSERT_TRUE(equals(expected, y));
+
+  // Doubly compressed rows
+  int pos0[] = {0, 2};
+  int idx0[] = {0, 2};
+  int pos1[] = {0, 1, 3};
+  Tensor<double> B("B", {3,3}, DCSR);
+  B.adopt({{pos0, idx0}, {pos1, colidx}}, vals);
+  ASSERT_TRUE(equals(A, B));
+
+  int unsorted[] = {1, 2, 0};
+  Tensor<double> C("C", {3,3}, CSR);
+  ASSERT_DEATH(C.adopt({{}, {rowptr, unsorted}}, vals), "not sorted");
+  int outOfBounds[] = {1, 0, 3};
+  ASSERT_DEATH(C.adopt({{}, {rowptr, outOfBounds}}, vals), "out of bounds");
+
+  // Index arrays of the format's own index types
+  Format narrow({Dense, Sparse});
+  narrow.setLevelArrayTypes({{Int32}, {Int64, Int16}});
+  long long rowptr64[] = {0, 1, 1, 3};
+  int16_t colidx16[] = {1, 0, 2};
+  Tensor<double> D("D", {3,3}, narrow);
+  D.adoptArrays({{}, {storage::Array(Int64, rowptr64, 4, storage::Array::UserOwns),
+                      storage::Array(Int16, colidx16, 3, storage::Array::UserOwns)}},
+                vals);
+  Tensor<double> z("z", {3}, Format({Dense}));
+  z(i) = D(i,j) * x(j);
+  z.evaluate();
+  ASSERT_TRUE(equals(expected, z));
+
+  int16_t unsorted16[] = {1, 2, 0};
+  ASSERT_DEATH(D.adoptArrays({{}, {storage::Array(Int64, rowptr64, 4,
+                                                  storage::Array::UserOwns),
+                                   storage::Array(Int16, unsorted16, 3,
+                                                  storage::Array::UserOwns)}},
+                             vals), "not sorted");
+  ASSERT_DEATH(D.adopt({{}, {rowptr, colidx}}, vals), "type");
+  ASSERT_DEATH(D.adoptArrays({{}, {storage::Array(Int64, rowptr64, 3,
+                                                  storage::Array::UserOwns),
+                                   storage::Array(Int16, colidx16, 3,
+                                                  storage::Array::UserOwns)}},
+                             vals), "needs 4");
+}
+
+TEST(tensor, for_each) {
+  Format narrow({Sparse, Dense, Sparse}, {2,0,1});
+  narrow.setLevelArrayTypes({{Int64, Int16}, {Int32}, {Int32, Int8}});
+  vector<Format> formats = {Format({Sparse, Sparse, Sparse}),
+                            Format({Dense, Sparse, Dense}),
+                            narrow};
+  for (auto& format : formats) {
+    srand(11);
+    Tensor<double> a("a", {60, 50, 40}, format);
+    for (int k = 0; k < 20000; k++) {
+      a.insert({rand() % 60, rand() % 50, rand() % 40}, (double)(rand() % 100));
+    }
+    a.pack();
+
+    vector<pair<vector<int>,double>> expected;
+    for (auto val = a.beginTyped<int>(); val != a.endTyped<int>(); ++val) {
+      expected.push_back({val->first, val->second});
+    }
+    ASSERT_EQ(expected.size(), a.getNumStoredValues());
+
+    size_t numValues = 0;
+    a.forEach([&](const int* coordinate, double value) {
+      ASSERT_EQ(expected[numValues].first,
+                vector<int>(coordinate, coordinate + 3));
+      ASSERT_EQ(expected[numValues].second, value);
+      numValues++;
+    });
+    ASSERT_EQ(expected.size(), numValues);
+
+    util::setNumThreads(4);
+    std::atomic<size_t> numParallelValues(0);
+    a.forEach([&](const int*, double) {
+      numParallelValues++;
+    }, true);
+    vector<vector<int>> coordinates;
+    vector<double> values;
+    a.exportCOO(&coordinates, &values);
+    util::setNumThreads(0);
+
+    ASSERT_EQ(expected.size(), numParallelValues);
+    ASSERT_EQ(3u, coordinates.size());
+    ASSERT_EQ(expected.size(), values.size());
+    for (size_t p = 0; p < expected.size(); p++) {
+      for (size_t m = 0; m < 3; m++) {
+        ASSERT_EQ(expected[p].first[m], coordinates[m][p]);
+      }
+      ASSERT_EQ(expected[p].second, values[p]);
+    }
+  }
+}
+
+TEST(tensor, block) {
+  srand(7);
+  Tensor<double> A("A", {10, 11}, CSR);
+  for (int k = 0; k < 40; k++) {
+    A.insert({rand() % 10, rand() % 11}, (double)(rand() % 10 + 1));
+  }
+  A.pack();
+  Tensor<double> x("x", {11}, Format({Dense}));
+  for (int j = 0; j < 11; j++) {
+    x.insert({j}, (double)(j + 1));
+  }
+  x.pack();
+
+  Tensor<double> Ab = A.block({3,3}, BCSR);
+  ASSERT_EQ(vector<int>({4,4,3,3}), Ab.getDimensions());
+  ASSERT_EQ(0u, Ab.getNumStoredValues() % 9);
+  Tensor<double> xb = x.block({3}, Format({Dense, Dense}));
+
+  IndexVar i("i"), j("j"), ib("ib"), jb("jb"), ii("ii"), jj("jj");
+  Tensor<double> y("y", {10}, Format({Dense}));
+  y(i) = A(i,j) * x(j);
+  y.evaluate();
+  Tensor<double> yb("yb", {4,3}, Format({Dense, Dense}));
+  yb(ib,ii) = Ab(ib,jb,ii,jj) * xb(jb,jj);
+  yb.evaluate();
+
+  // The loops over the fixed-size blocks are unrolled
+  ASSERT_EQ(std::string::npos, yb.getSource().find("for (int32_t ii"));
+  ASSERT_EQ(std::string::npos, yb.getSource().find("for (int32_t jj"));
+  ASSERT_NE(std::string::npos, yb.getSource().find("for (int32_t ib"));
+
+  Tensor<double> expected = y.block({3}, Format({Dense, Dense}));
+  ASSERT_TRUE(equals(expected, yb));
+
+  ASSERT_DEATH(A.block({3}, BCSR), "block dimensions");
+  ASSERT_DEATH(A.block({3,3}, CSR), "must have a format of order 4");
+}
@@ -45,7 +45,7 @@ TYPED_TEST_P(VectorTensorTest, types) {
   ASSERT_EQ(t, a.getComponentType());
   ASSERT_EQ(1u, a.getOrder());
   ASSERT_EQ(5,  a.getDimension(0));
-  map<vector<int>,TypeParam> vals = {{{0}, 1.0}, {{2}, 2.0}};
+  map<vector<int>,TypeParam> vals = {{{0}, (TypeParam) 1.0}, {{2}, (TypeParam) 2.0}};
   for (auto& val : vals) {
     a.insert(val.first, val.second);
   }
@@ -422,3 +422,189 @@ TEST(tensor_types, coordinate_types) {
   }
 
 }
+
+TEST(tensor_types, coordinate_types_compute) {
+  TensorData<double> testData = TensorData<double>({5, 3, 2}, {
+    {{0,0,0}, 1.0},
+    {{0,1,1}, 3.0},
+    {{2,0,0}, 4.0},
+    {{2,0,1}, 5.0},
+    {{4,2,0}, 6.0},
+  });
+
+  Format format = Format({Sparse, Sparse, Sparse});
+  format.setLevelArrayTypes({{Int64, Int16}, {Int64, Int32}, {Int64, Int32}});
+  Tensor<double> a = testData.makeTensor("a", format);
+  a.pack();
+
+  // Assemble a result with 64-bit positions
+  Tensor<double> b("b", {5, 3, 2}, format);
+  b(i,j,k) = a(i,j,k) + a(i,j,k);
+  b.evaluate();
+  ASSERT_NE(std::string::npos, b.getSource().find("int64_t init_alloc_size"));
+  const storage::Index& index = b.getStorage().getIndex();
+  ASSERT_EQ(Int64, index.getModeIndex(0).getIndexArray(0).getType());
+  ASSERT_EQ(Int16, index.getModeIndex(0).getIndexArray(1).getType());
+  ASSERT_EQ(Int64, index.getModeIndex(2).getIndexArray(0).getType());
+  ASSERT_EQ(Int32, index.getModeIndex(2).getIndexArray(1).getType());
+
+  Tensor<double> a32 = testData.makeTensor("a32", Sparse);
+  a32.pack();
+  Tensor<double> b32("b32", {5, 3, 2}, Sparse);
+  b32(i,j,k) = a32(i,j,k) + a32(i,j,k);
+  b32.evaluate();
+  ASSERT_TRUE(equals(b32, b));
+
+  // Reduce a 64-bit operand into a dense result
+  Tensor<double> c("c", {5}, Dense);
+  c(i) = a(i,j,k);
+  c.evaluate();
+  Tensor<double> c32("c32", {5}, Dense);
+  c32.insert({0}, 4.0);
+  c32.insert({2}, 9.0);
+  c32.insert({4}, 6.0);
+  c32.pack();
+  ASSERT_TRUE(equals(c32, c));
+}
+
+TEST(tensor_types, narrow_index_types) {
+  Tensor<double> a("a", {100, 300}, CSR);
+  a.setNarrowIndexTypes(true);
+  a.insert({0, 0}, 1.0);
+  a.insert({0, 299}, 2.0);
+  a.insert({42, 7}, 3.0);
+  a.insert({99, 150}, 4.0);
+  a.pack();
+
+  // The pos array is narrowed to the 4 entries, the idx array to the dimension
+  const storage::Index& index = a.getStorage().getIndex();
+  ASSERT_EQ(Int8, index.getModeIndex(1).getIndexArray(0).getType());
+  ASSERT_EQ(Int16, index.getModeIndex(1).getIndexArray(1).getType());
+  ASSERT_EQ(Int8, a.getFormat().getLevelArrayTypes()[1][0]);
+
+  Tensor<double> a32("a32", {100, 300}, CSR);
+  a32.insert({0, 0}, 1.0);
+  a32.insert({0, 299}, 2.0);
+  a32.insert({42, 7}, 3.0);
+  a32.insert({99, 150}, 4.0);
+  a32.pack();
+
+  Tensor<double> x("x", {300}, Dense);
+  for (int j = 0; j < 300; j++) {
+    x.insert({j}, (double)j);
+  }
+  x.pack();
+
+  Tensor<double> y("y", {100}, Dense);
+  y(i) = a(i,j) * x(j);
+  y.evaluate();
+  Tensor<double> y32("y32", {100}, Dense);
+  y32(i) = a32(i,j) * x(j);
+  y32.evaluate();
+  ASSERT_TRUE(equals(y32, y));
+
+  // Results are bounded by their dimensions since their size is not known yet
+  Tensor<double> b("b", {100, 300}, CSR);
+  b.setNarrowIndexTypes(true);
+  ASSERT_EQ(Int16, b.getFormat().getLevelArrayTypes()[1][0]);
+  ASSERT_EQ(Int16, b.getFormat().getLevelArrayTypes()[1][1]);
+  b(i,j) = a(i,j) + a(i,j);
+  b.evaluate();
+  ASSERT_EQ(Int16, b.getStorage().getIndex().getModeIndex(1)
+                    .getIndexArray(0).getType());
+  Tensor<double> b32("b32", {100, 300}, CSR);
+  b32(i,j) = a32(i,j) + a32(i,j);
+  b32.evaluate();
+  ASSERT_TRUE(equals(b32, b));
+
+  b.setNarrowIndexTypes(false);
+  ASSERT_EQ(Int32, b.getFormat().getLevelArrayTypes()[1][0]);
+}
+
+TEST(tensor_types, narrow_index_types_packed) {
+  // Narrowing the types of a packed tensor converts its index arrays
+  Tensor<double> A("A", {4, 4}, CSR);
+  A.insert({0, 1}, 1.0);
+  A.insert({1, 2}, 2.0);
+  A.insert({3, 3}, 3.0);
+  A.pack();
+  A.setNarrowIndexTypes(true);
+  ASSERT_EQ(Int8, A.getStorage().getIndex().getModeIndex(1)
+                   .getIndexArray(1).getType());
+  Tensor<double> x("x", {4}, Dense);
+  for (int j = 0; j < 4; j++) {
+    x.insert({j}, 1.0);
+  }
+  x.pack();
+  Tensor<double> y("y", {4}, Dense);
+  y(i) = A(i,j) * x(j);
+  y.evaluate();
+  Tensor<double> expected("expected", {4}, Dense);
+  expected.insert({0}, 1.0);
+  expected.insert({1}, 2.0);
+  expected.insert({3}, 3.0);
+  expected.pack();
+  ASSERT_TRUE(equals(expected, y));
+
+  // Repacking with more entries than the narrowed pos array holds widens it
+  // again, while kernels compiled against the tensor keep its types as long
+  // as the entries fit them
+  Tensor<double> B("B", {200, 200}, CSR);
+  B.setNarrowIndexTypes(true);
+  B.insert({0, 0}, 1.0);
+  B.pack();
+  ASSERT_EQ(Int8, B.getFormat().getLevelArrayTypes()[1][0]);
+  Tensor<double> z("z", {200}, Dense);
+  Tensor<double> w("w", {200}, Dense);
+  for (int j = 0; j < 200; j++) {
+    w.insert({j}, 1.0);
+  }
+  w.pack();
+  z(i) = B(i,j) * w(j);
+  z.compile();
+  B.insert({0, 0}, 1.0);
+  B.insert({5, 7}, 1.0);
+  B.pack();
+  ASSERT_EQ(Int8, B.getFormat().getLevelArrayTypes()[1][0]);
+  z.assemble();
+  z.compute();
+  ASSERT_EQ(1.0, ((double*)z.getStorage().getValues().getData())[5]);
+
+  for (int k = 0; k < 200; k++) {
+    B.insert({k, k}, 1.0);
+  }
+  B.pack();
+  ASSERT_EQ(Int16, B.getFormat().getLevelArrayTypes()[1][0]);
+  ASSERT_EQ(200u, B.getStorage().getIndex().getSize());
+  ASSERT_DEATH(z.compute(), "packed with different types");
+}
+
+TEST(tensor_types, coordinate_types_fixed) {
+  TensorData<double> testData = TensorData<double>({4, 300}, {
+    {{0,1},   1.0},
+    {{0,299}, 2.0},
+    {{2,0},   3.0},
+    {{3,7},   4.0},
+    {{3,200}, 5.0},
+  });
+
+  Format format = Format({Dense, Fixed});
+  format.setLevelArrayTypes({{Int32}, {Int8, Int16}});
+  Tensor<double> tensor = testData.makeTensor("a", format);
+  tensor.pack();
+
+  const storage::ModeIndex& modeIndex =
+      tensor.getStorage().getIndex().getModeIndex(1);
+  ASSERT_EQ(Int8, modeIndex.getIndexArray(0).getType());
+  ASSERT_EQ(Int16, modeIndex.getIndexArray(1).getType());
+  ASSERT_EQ(2u, modeIndex.getIndexArray(0).get(0).getAsIndex());
+  ASSERT_EQ(8u, modeIndex.getIndexArray(1).getSize());
+
+  // Segments shorter than the fixed size repeat their last coordinate
+  const std::vector<int> idx = {1, 299, 0, 0, 0, 0, 7, 200};
+  const std::vector<double> vals = {1.0, 2.0, 0.0, 0.0, 3.0, 0.0, 4.0, 5.0};
+  for (size_t p = 0; p < idx.size(); p++) {
+    ASSERT_EQ((size_t)idx[p], modeIndex.getIndexArray(1).get(p).getAsIndex());
+    ASSERT_EQ(vals[p], ((double*)tensor.getStorage().getValues().getData())[p]);
+  }
+}
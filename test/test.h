@@ -79,7 +79,9 @@ void ASSERT_STORAGE_EQUALS(vector<vector<vector<int>>> expectedIndices,
         break;
       }
       case ModeType::Sparse:
-      case ModeType::Fixed: {
+      case ModeType::Fixed:
+      case ModeType::Hashed:
+      case ModeType::Diagonal: {
         taco_iassert(expectedIndices[i].size() == 2);
         ASSERT_EQ(2u, modeIndex.numIndexArrays());
         auto pos = modeIndex.getIndexArray(0);
@@ -90,6 +92,31 @@ void ASSERT_STORAGE_EQUALS(vector<vector<vector<int>>> expectedIndices,
                         {(int*)idx.getData(), idx.getSize()});
         break;
       }
+      case ModeType::Bitmap: {
+        taco_iassert(expectedIndices[i].size() == 3);
+        ASSERT_EQ(3u, modeIndex.numIndexArrays());
+        auto size = modeIndex.getIndexArray(0);
+        ASSERT_ARRAY_EQ(expectedIndices[i][0],
+                        {(int*)size.getData(), size.getSize()});
+        // The bitmap words and the ranks have their own types
+        for (size_t j = 1; j < 3; j++) {
+          auto array = modeIndex.getIndexArray(j);
+          vector<int> elements;
+          for (size_t k = 0; k < array.getSize(); k++) {
+            elements.push_back((int)array.get(k).getAsIndex());
+          }
+          ASSERT_VECTOR_EQ(expectedIndices[i][j], elements);
+        }
+        break;
+      }
+      case ModeType::Singleton: {
+        taco_iassert(expectedIndices[i].size() == 1);
+        ASSERT_EQ(1u, modeIndex.numIndexArrays());
+        auto idx = modeIndex.getIndexArray(0);
+        ASSERT_ARRAY_EQ(expectedIndices[i][0],
+                        {(int*)idx.getData(), idx.getSize()});
+        break;
+      }
     }
   }
 